@@ -0,0 +1,95 @@
+#include "bench.h"
+#include "bitboard/bbutils.h"
+#include "globals.h"
+#include "search.h"
+#include "tables.h"
+#include "threads.h"
+#include "timeman.h"
+#include "transposition.h"
+#include "util.h"
+#include <stdio.h>
+
+// Fixed positions searched by bench, a mix of openings, middlegames and endgames
+static const char* bench_fens[] = {
+    START_FEN,
+    "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+    "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+    "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+    "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+    "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+    "r1bqkb1r/pppp1ppp/2n2n2/1B2p3/4P3/5N2/PPPP1PPP/RNBQK2R w KQkq - 4 4",
+    "4rrk1/pp1n3p/3q2pQ/2p1pb2/2PP4/2P3N1/P2B2PP/4RRK1 b - - 7 19",
+    "r3r1k1/2p2ppp/p1p1bn2/8/1q2P3/2NPQN2/PPP3PP/R4RK1 b - - 2 15",
+    "r1bbk1nr/pp3p1p/2n5/1N4p1/2Np1B2/8/PPP2PPP/2KR1B1R w kq - 0 13",
+    "r1bq1rk1/ppp1nppp/4n3/3p3Q/3P4/1BP1B3/PP1N2PP/R4RK1 w - - 1 16",
+    "4r1k1/r1q2ppp/ppp2n2/4P3/5Rb1/1N1BQ3/PPP3PP/R5K1 w - - 1 17",
+    "2rqkb1r/ppp2p2/2npb1p1/1N1Nn2p/2P1PP2/8/PP2B1PP/R1BQK2R b KQ - 0 11",
+    "6k1/6p1/6Pp/ppp5/3pn2P/1P3K2/1PP2P2/8 b - - 3 54",
+    "1r3k2/4q3/2Pp3b/3Bp3/2Q2p2/1p1P2P1/1P2KP2/3N4 w - - 0 1",
+    "5k2/7R/4P2p/5K2/p1r2P1p/8/8/8 b - - 0 1",
+    "8/8/8/8/5kp1/P7/8/1K1N4 w - - 0 1",
+    "8/3k4/8/8/8/4B3/4KB2/2B5 w - - 0 1",
+};
+#define BENCH_POSITIONS (i32)(sizeof(bench_fens) / sizeof(bench_fens[0]))
+
+/*
+ * Searches every bench position to depth from an empty TT and history,
+ * prints the nodes and time of each and the total nodes, which are the
+ * signature of the search, and the aggregate nps
+ * The Threads and Hash settings and the position are restored afterwards
+ * Called from the IO Thread or the command line, returns the total nodes
+ */
+u64 bench(i32 depth, i32 threads, i32 hash_mb){
+    stopSearch();
+    wait_search_threads();
+
+    ThreadData *saved_td = malloc(sizeof(ThreadData));
+    if(saved_td) *saved_td = copy_global_td();
+    u32 saved_threads = get_search_thread_count();
+    i32 saved_hash_mb = tt_size_mb();
+
+    set_search_thread_count(threads);
+    if(init_tt(hash_mb)){
+        printf("info string Warning failed to create transposition table for bench\n");
+        set_search_thread_count(saved_threads);
+        free(saved_td);
+        return 0;
+    }
+
+    SearchParameters params = {0};
+    params.depth = MAX(1, MIN(depth, MAX_DEPTH - 1));
+
+    u64 total_nodes = 0, total_time = 0;
+    for(i32 i = 0; i < BENCH_POSITIONS; i++){
+        tt_clear();
+        clearHistory();
+        set_global_position(fen_to_position((char*)bench_fens[i]));
+
+        u64 start = tm_now();
+        start_search(params);
+        wait_search_threads();
+        u64 elapsed = tm_now() - start;
+        u64 nodes = get_search_nodes();
+
+        printf("info string bench position %d/%d nodes %" PRIu64 " time %" PRIu64 "\n",
+               i + 1, BENCH_POSITIONS, nodes, elapsed);
+        fflush(stdout);
+        total_nodes += nodes;
+        total_time += elapsed;
+    }
+
+    printf("\n===========================\n");
+    printf("Total time (ms) : %" PRIu64 "\n", total_time);
+    printf("Nodes searched  : %" PRIu64 "\n", total_nodes);
+    printf("Nodes/second    : %" PRIu64 "\n", total_nodes * 1000 / MAX(total_time, 1));
+    fflush(stdout);
+
+    set_search_thread_count(saved_threads);
+    init_tt(saved_hash_mb);
+    if(saved_td){
+        set_global_position(saved_td->pos); // Drops the PV of the last bench search
+        set_global_td(*saved_td);
+        free(saved_td);
+    }
+    return total_nodes;
+}
@@ -0,0 +1,8 @@
+#pragma once
+#include "types.h"
+
+#define BENCH_DEPTH   8  // Defaults for bench [depth] [threads] [hash]
+#define BENCH_THREADS 1
+#define BENCH_HASH_MB 16
+
+u64 bench(i32 depth, i32 threads, i32 hash_mb);
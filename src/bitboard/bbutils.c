@@ -14,16 +14,13 @@
 #include <string.h>
 #include <stdlib.h>
 
-u64 betweenMask[64][64];
-u64 rankMask[64], fileMask[64], NESWMask[64], NWSEMask[64];
-
 static void updateBit(u64* bitboard, i32 square) {
     *bitboard |= (1ULL << square);
 }
 
 Position fen_to_position(char* FEN) {
     Position pos = {0};
-    memset(pos.charBoard, 0, sizeof(pos.charBoard));
+    memset(pos.board, NO_PIECE, sizeof(pos.board));
     i32 square = 56; // Start at A8
 
     while (*FEN && *FEN != ' ') {
@@ -32,22 +29,11 @@ Position fen_to_position(char* FEN) {
         } else if (*FEN >= '1' && *FEN <= '8') {
             square += *FEN - '0'; // Skip empty squares
         } else {
-            pos.charBoard[square] = *FEN;
-            if(isupper(*FEN)) updateBit(&pos.color[1], square);
-            else updateBit(&pos.color[0], square);
-            switch (*FEN) {
-                case 'P': updateBit(&pos.pawn[1], square); break;
-                case 'N': updateBit(&pos.knight[1], square); break;
-                case 'B': updateBit(&pos.bishop[1], square); break;
-                case 'R': updateBit(&pos.rook[1], square); break;
-                case 'Q': updateBit(&pos.queen[1], square); break;
-                case 'K': updateBit(&pos.king[1], square); break;
-                case 'p': updateBit(&pos.pawn[0], square); break;
-                case 'n': updateBit(&pos.knight[0], square); break;
-                case 'b': updateBit(&pos.bishop[0], square); break;
-                case 'r': updateBit(&pos.rook[0], square); break;
-                case 'q': updateBit(&pos.queen[0], square); break;
-                case 'k': updateBit(&pos.king[0], square); break;
+            i32 piece = pieceToIndex[*FEN & 0x7F];
+            if(indexToPiece[piece] == *FEN){ // Skip unknown characters
+                pos.board[square] = piece;
+                updateBit(&pos.pieces[piece], square);
+                updateBit(&pos.color[PIECE_COLOR(piece)], square);
             }
             square++;
         }
@@ -95,33 +81,19 @@ Position fen_to_position(char* FEN) {
 
     sscanf(FEN, "%d", &pos.fullmove_number);
 
-    setAttackMasks(&pos);
-
-    //Check Flag
-    if(pos.attack_mask[0] & pos.king[1]) pos.flags |= IN_CHECK;
-    if(pos.attack_mask[1] & pos.king[0]) pos.flags |= IN_CHECK;
-
-    //Double Check Flag
-    if(pos.flags & IN_CHECK){
-       i32 kign_sq = getlsb(pos.king[1]);
-       u64 attackers = getAttackers(&pos, kign_sq, 0);
-       attackers &= attackers - 1; // Allow underflow
-       if(attackers) pos.flags |= IN_D_CHECK;
-       
-       kign_sq = getlsb(pos.king[0]);
-       attackers = getAttackers(&pos, kign_sq, WHITE_TURN);
-       attackers &= attackers - 1; // Allow underflow
-       if(attackers) pos.flags |= IN_D_CHECK;
-       
-    }
+    //Check Flags, attack masks and pins are generated when first needed
+    i32 turn = pos.flags & WHITE_TURN;
+    pos.checkers = getAttackers(&pos, getlsb(pos.king[turn]), !turn);
+    if(pos.checkers) pos.flags |= IN_CHECK;
+    if(pos.checkers & (pos.checkers - 1)) pos.flags |= IN_D_CHECK;
+    pos.cached = 0;
 
-    pos.pinned = generatePinnedPieces(&pos);
+    init_eval_accumulators(&pos);
 
     pos.stage = calculateStage(&pos);
 
-    pos.material_eval = eval_material(&pos);
-
     pos.hash = hashPosition(&pos);
+    pos.pawn_hash = hashPawns(&pos);
 
     return pos;
 }
@@ -132,7 +104,7 @@ i32 PositionToFen(Position pos, char* FEN) {
         i32 emptyCount = 0;
         for (i32 file = 0; file < 8; file++) {
             i32 square = rank * 8 + file;
-            char piece = pos.charBoard[square];
+            char piece = indexToPiece[pos.board[square]];
             if (piece == 0) {
                 emptyCount++;
             } else {
@@ -205,80 +177,6 @@ i64 get_perft_fen_depth(const char *fen, int depth) {
 
 
 
-void generateBetweenMasks() {
-    for (i32 sq1 = 0; sq1 < 64; sq1++) {
-        i32 rank1 = sq1 / 8;
-        i32 file1 = sq1 % 8;
-
-        for (i32 sq2 = 0; sq2 < 64; sq2++) {
-            i32 rank2 = sq2 / 8;
-            i32 file2 = sq2 % 8;
-
-            if (sq1 == sq2) {
-                betweenMask[sq1][sq2] = 0;
-                continue;
-            }
-
-            u64 mask = 0;
-            
-            if (rank1 == rank2) {
-                for (i32 f = 1; f < abs(file2 - file1); f++) {
-                    i32 file = file1 + f * ((file2 > file1) ? 1 : -1);
-                    mask |= 1ULL << (rank1 * 8 + file);
-                }
-            } else if (file1 == file2) { 
-                for (i32 r = 1; r < abs(rank2 - rank1); r++) {
-                    i32 rank = rank1 + r * ((rank2 > rank1) ? 1 : -1);
-                    mask |= 1ULL << (rank * 8 + file1);
-                }
-            } else if (abs(rank1 - rank2) == abs(file1 - file2)) { 
-                for (i32 i = 1; i < abs(rank2 - rank1); i++) {
-                    i32 rank = rank1 + i * ((rank2 > rank1) ? 1 : -1);
-                    i32 file = file1 + i * ((file2 > file1) ? 1 : -1);
-                    mask |= 1ULL << (rank * 8 + file);
-                }
-            }
-
-            betweenMask[sq1][sq2] = mask;
-        }
-    }
-}
-
-void generateRankMasks() {
-    for (i32 sq = 0; sq < 64; ++sq) {
-        i32 rank = sq / 8;
-        rankMask[sq] = 0xFFULL << (rank * 8);
-    }
-}
-
-void generateFileMasks() {
-    for (i32 sq = 0; sq < 64; ++sq) {
-        i32 file = sq % 8;
-        fileMask[sq] = 0x0101010101010101ULL << file;
-    }
-}
-
-void generateDiagonalMasks() {
-    for (i32 sq = 0; sq < 64; ++sq) {
-        i32 rank = sq / 8;
-        i32 file = sq % 8;
-        NESWMask[sq] = 0;
-        NWSEMask[sq] = 0;
-
-        // Northeast-Southwest Diagonal
-        for (i32 r = rank, f = file; r < 8 && f < 8; ++r, ++f)
-            NESWMask[sq] |= (1ULL << (r * 8 + f));
-        for (i32 r = rank, f = file; r >= 0 && f >= 0; --r, --f)
-            NESWMask[sq] |= (1ULL << (r * 8 + f));
-
-        // Northwest-Southeast Diagonal
-        for (i32 r = rank, f = file; r < 8 && f >= 0; ++r, --f)
-            NWSEMask[sq] |= (1ULL << (r * 8 + f));
-        for (i32 r = rank, f = file; r >= 0 && f < 8; --r, ++f)
-            NWSEMask[sq] |= (1ULL << (r * 8 + f));
-    }
-}
-
 void printDebug(Position position){
     char fen[128];
     PositionToFen(position, fen);
@@ -356,7 +254,7 @@ void printPosition(Position position, char verbose){
             i32 square = rank * 8 + file;
             u64 mask = 1ULL << square;
 
-            if (position.attack_mask[1] & mask) printf("A ");
+            if (get_attack_mask(&position, 1) & mask) printf("A ");
             else printf(". ");
 
             if (file == 7) printf(" |  ");
@@ -368,7 +266,7 @@ void printPosition(Position position, char verbose){
             i32 square = rank * 8 + file;
             u64 mask = 1ULL << square;
 
-            if (position.attack_mask[0] & mask) printf("a ");
+            if (get_attack_mask(&position, 0) & mask) printf("a ");
             else printf(". ");
 
             if (file == 7) printf(" |  ");
@@ -380,7 +278,7 @@ void printPosition(Position position, char verbose){
             i32 square = rank * 8 + file;
             u64 mask = 1ULL << square;
 
-            if (position.pinned & mask) printf("X ");
+            if (get_pinned(&position) & mask) printf("X ");
             else printf(". ");
 
             if (file == 7) printf(" |  ");
@@ -403,7 +301,7 @@ void printPosition(Position position, char verbose){
         for (i32 file = 0; file < 8; file++) {
             i32 square = rank * 8 + file;
 
-            if (position.charBoard[square]) printf("%c ",position.charBoard[square]);
+            if (position.board[square] != NO_PIECE) printf("%c ", indexToPiece[position.board[square]]);
             else printf(". ");
             
             if (file == 7) printf(" |\n");
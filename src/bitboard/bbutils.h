@@ -65,13 +65,9 @@
 
 #endif
 
-extern u64 betweenMask[64][64];
-extern u64 rankMask[64], fileMask[64], NESWMask[64], NWSEMask[64];
-
-void generateBetweenMasks();
-void generateRankMasks();
-void generateFileMasks();
-void generateDiagonalMasks();
+// Generated by tools/gentables.c into tables_gen.c
+extern const u64 betweenMask[64][64];
+extern const u64 rankMask[64], fileMask[64], NESWMask[64], NWSEMask[64];
 
 void printBB(u64 BB);
 Position fen_to_position(char* FEN);
@@ -20,96 +20,11 @@
 #include "../types.h"
 
 
-#define B_FILE_MASK         0x0202020202020202ULL
-#define W_SHORT_CASTLE_MASK 0x0000000000000060ULL
-#define W_LONG_CASTLE_MASK  0x000000000000000EULL
-#define B_SHORT_CASTLE_MASK 0x6000000000000000ULL 
-#define B_LONG_CASTLE_MASK  0x0E00000000000000ULL
-
-static void generateKingMoveMasks(void);
-static void generateKnightMoveMasks(void);
-static void generatePawnMoveMasks(void);
-
-static u64 kingMoves[64];
-static u64 knightMoves[64];
-static u64 pawnMoves[64][8]; // sq-0 single move white sq-1 double move white sq-2 attack-left white sq-3 attack-right white 
-                                  // sq-4 -> sq-7 same for black
-
-void generateMasks(void){
-    generateKingMoveMasks();
-    generateKnightMoveMasks();
-    generatePawnMoveMasks();
-    generateBetweenMasks();
-    generateRankMasks();
-    generateFileMasks();
-    generateDiagonalMasks();
-}
-
-
-static void generateKingMoveMasks(void) {
-    for (i32 square = 0; square < 64; square++) {
-        i32 rank = square / 8;
-        i32 file = square % 8;
-
-        kingMoves[square] = 0ULL;
-        if (rank > 0) {
-            kingMoves[square] |= 1ULL << (square - 8);
-            if (file > 0) kingMoves[square] |= 1ULL << (square - 9);
-            if (file < 7) kingMoves[square] |= 1ULL << (square - 7);
-        }
-        if (rank < 7) {
-            kingMoves[square] |= 1ULL << (square + 8);
-            if (file > 0) kingMoves[square] |= 1ULL << (square + 7); // Down-Left
-            if (file < 7) kingMoves[square] |= 1ULL << (square + 9); // Down-Right
-        }
-        if (file > 0) kingMoves[square] |= 1ULL << (square - 1); // Left
-        if (file < 7) kingMoves[square] |= 1ULL << (square + 1); // Right
-    }
-}
-
-static void setKnightMove(i32 square, i32 r, i32 f) {
-    if (r >= 0 && r < 8 && f >= 0 && f < 8)
-        knightMoves[square] |= 1ULL << (r * 8 + f);
-}
-
-static void generateKnightMoveMasks(void) {
-    for (i32 square = 0; square < 64; square++) {
-        i32 rank = square / 8;
-        i32 file = square % 8;
-
-        knightMoves[square] = 0ULL;
-
-        setKnightMove(square, rank - 2, file - 1);
-        setKnightMove(square, rank - 2, file + 1);
-        setKnightMove(square, rank - 1, file - 2);
-        setKnightMove(square, rank - 1, file + 2);
-        setKnightMove(square, rank + 1, file - 2);
-        setKnightMove(square, rank + 1, file + 2);
-        setKnightMove(square, rank + 2, file - 1);
-        setKnightMove(square, rank + 2, file + 1);
-    }
-}
-
-void generatePawnMoveMasks(void){
-    for (i32 square = 0; square < 64; square++) {
-        i32 rank = square / 8;
-        i32 file = square % 8;
-
-        u64 position = setBit(0ULL, square);
-
-        // For White Pawns
-        pawnMoves[square][0] = (rank < 7) ?  northOne(position) : 0ULL;
-        pawnMoves[square][1] = (rank == 1) ? northTwo(position) : 0ULL;
-        pawnMoves[square][2] = (file > 0 && rank < 7) ? noWeOne(position) : 0ULL;
-        pawnMoves[square][3] = (file < 7 && rank < 7) ? noEaOne(position) : 0ULL;
-
-        // For Black Pawns
-        pawnMoves[square][4] = (rank > 0) ?  southOne(position) : 0ULL;
-        pawnMoves[square][5] = (rank == 6) ? southTwo(position) : 0ULL;
-        pawnMoves[square][6] = (file > 0 && rank > 0) ? soWeOne(position) : 0ULL;
-        pawnMoves[square][7] = (file < 7 && rank > 0) ? soEaOne(position) : 0ULL;
-    }
-}
+// Generated by tools/gentables.c into tables_gen.c
+extern const u64 kingMoves[64];
+extern const u64 knightMoves[64];
+extern const u64 pawnMoves[64][8]; // sq-0 single move white sq-1 double move white sq-2 attack-left white sq-3 attack-right white 
+                                   // sq-4 -> sq-7 same for black
 
 //All Attacks
 u64 generateAttacks(Position* position, i32 turn){
@@ -173,6 +88,10 @@ u64 getBishopMovesAppend(u64 bishops, u64 ownPieces, u64 oppPieces, Move* moveLi
     return getBishopMovesCheckAppend(bishops, ownPieces, oppPieces, ~(0x0ULL), moveList, idx);
 }
 
+u64 getBishopTargetMovesAppend(u64 bishops, u64 ownPieces, u64 oppPieces, u64 targets, Move* moveList, i32* idx) {
+    return getBishopMovesCheckAppend(bishops, ownPieces, oppPieces, targets, moveList, idx);
+}
+
 //Rook
 u64 getRookAttacks(u64 rooks, u64 ownPieces, u64 oppPieces) {
     u64 moves = 0ULL;
@@ -221,6 +140,10 @@ u64 getRookMovesAppend(u64 rooks, u64 ownPieces, u64 oppPieces, Move* moveList,
     return getRookMovesCheckAppend(rooks, ownPieces, oppPieces, ~(0x0ULL), moveList, idx);
 }
 
+u64 getRookTargetMovesAppend(u64 rooks, u64 ownPieces, u64 oppPieces, u64 targets, Move* moveList, i32* idx) {
+    return getRookMovesCheckAppend(rooks, ownPieces, oppPieces, targets, moveList, idx);
+}
+
 /*
 * The worst piece in chess (in many ways) is below here.
 */
@@ -237,224 +160,19 @@ u64 pawnAttacks(u64 square, char turn){
 
 
 u64 getPawnAttacks(u64 pawns, char turn){
-    u64 moves = 0ULL;
-    i32 pawn_mask_idx = (turn & TURN_MASK) ? 0 : 4;
-
-    while (pawns) {
-        i32 square = getlsb(pawns);
-
-        moves |= pawnMoves[square][pawn_mask_idx + 2];
-        moves |= pawnMoves[square][pawn_mask_idx + 3];
-
-        pawns &= pawns - 1;
-    }
-
-    return moves;
+    return (turn & TURN_MASK) ? pawnAttacksSet(pawns, WHITE) : pawnAttacksSet(pawns, BLACK);
 }
 
 u64 getPawnMovesAppend(u64 pawns, u64 ownPieces, u64 oppPieces,  u64 enPassant, char flags, Move* moveList, i32* idx) {
-    u64 all_moves = 0ULL;
-    u64 occ =  0ULL;
-    char turn = (flags & WHITE_TURN);
-    i32 pawn_mask_idx = turn ? 0 : 4;
-
-    while (pawns) {
-        u64 q_moves = 0ULL;         //Quiet
-        u64 dp_moves = 0ULL;        //Double Pawn
-        u64 cap_moves = 0ULL;       //Captures
-        u64 ep_moves = 0ULL;        //En Passants
-
-        i32 square = getlsb(pawns);
-        i32 rank = square / 8;
-        char promotion = turn ? (rank == 6) : (rank == 1);
-        char can_double = turn ? (rank == 1) : (rank == 6);
-
-        //Single Step
-        occ = (oppPieces | ownPieces) & pawnMoves[square][pawn_mask_idx + 0];
-        if(!occ) q_moves |= pawnMoves[square][pawn_mask_idx + 0];
-        
-        //Double Step
-        if(occ == 0 && can_double){
-            occ = (oppPieces | ownPieces) & pawnMoves[square][pawn_mask_idx + 1];
-            if(!occ) dp_moves |= pawnMoves[square][pawn_mask_idx + 1];
-        }
-
-        //Capture Left
-        occ = (oppPieces) & pawnMoves[square][pawn_mask_idx + 2];
-        if(occ) cap_moves |= pawnMoves[square][pawn_mask_idx + 2];
-
-        occ = (enPassant) & pawnMoves[square][pawn_mask_idx + 2];
-        if(occ) ep_moves |= pawnMoves[square][pawn_mask_idx + 2];
-
-        //Capture Right
-        occ = (oppPieces) & pawnMoves[square][pawn_mask_idx + 3];
-        if(occ) cap_moves |= pawnMoves[square][pawn_mask_idx + 3];
-
-        occ = (enPassant) & pawnMoves[square][pawn_mask_idx + 3];
-        if(occ) ep_moves |= pawnMoves[square][pawn_mask_idx + 3];
-
-        all_moves |= q_moves | dp_moves | cap_moves | ep_moves;
-
-        while(q_moves){
-            i32 move_sq = getlsb(q_moves);
-            if (promotion) {
-                Move baseMove = create_move(square, move_sq, QUIET);
-                moveList[*idx] = SET_QUEEN_PROMOTION(baseMove);
-                (*idx)++;
-                moveList[*idx] = SET_ROOK_PROMOTION(baseMove);
-                (*idx)++;
-                moveList[*idx] = SET_BISHOP_PROMOTION(baseMove);
-                (*idx)++;
-                moveList[*idx] = SET_KNIGHT_PROMOTION(baseMove);
-                (*idx)++;
-            } else {
-                moveList[*idx] = create_move(square, move_sq, QUIET);
-                (*idx)++;
-            }
-            q_moves &= q_moves - 1;
-        }
-
-        while(cap_moves){
-            i32 move_sq = getlsb(cap_moves);
-            if (promotion) {
-                Move baseMove = create_move(square, move_sq, CAPTURE);
-                moveList[*idx] = SET_QUEEN_PROMO_CAPTURE(baseMove);
-                (*idx)++;
-                moveList[*idx] = SET_ROOK_PROMO_CAPTURE(baseMove);
-                (*idx)++;
-                moveList[*idx] = SET_BISHOP_PROMO_CAPTURE(baseMove);
-                (*idx)++;
-                moveList[*idx] = SET_KNIGHT_PROMO_CAPTURE(baseMove);
-                (*idx)++;
-            } else {
-                moveList[*idx] = create_move(square, move_sq, CAPTURE);
-                (*idx)++;
-            }
-            cap_moves &= cap_moves - 1;
-        }
-
-        while(dp_moves){
-            i32 move_sq = getlsb(dp_moves);
-            moveList[*idx] = create_move(square, move_sq, DOUBLE_PAWN_PUSH);
-            (*idx)++;
-            dp_moves &= dp_moves - 1;
-        }
-
-        while(ep_moves){
-            i32 move_sq = getlsb(ep_moves);
-            moveList[*idx] = create_move(square, move_sq, EP_CAPTURE);
-            (*idx)++;
-            ep_moves &= ep_moves - 1;
-        }
-
-        pawns &= pawns - 1;
-    }
-
-    return all_moves;
+    if(flags & WHITE_TURN) return pawnMovesAppend(pawns, ownPieces, oppPieces, enPassant, ~0ULL, moveList, idx, WHITE);
+    return pawnMovesAppend(pawns, ownPieces, oppPieces, enPassant, ~0ULL, moveList, idx, BLACK);
 }
 
+/* Captures, and pushes which give check */
 u64 getPawnThreatMovesAppend(u64 pawns, u64 ownPieces, u64 oppPieces,  u64 enPassant, char flags, i32 opp_king_square, Move* moveList, i32* idx) {
-    u64 all_moves = 0ULL;
-    u64 occ =  0ULL;
-    char turn = (flags & WHITE_TURN);
-    i32 pawn_mask_idx = turn ? 0 : 4;
-
-    i32 opp_pawn_mask_idx = turn ? 4 : 0;
-    u64 check_squares = pawnMoves[opp_king_square][opp_pawn_mask_idx + 2] | pawnMoves[opp_king_square][opp_pawn_mask_idx + 3];
-
-    while (pawns) {
-        u64 q_moves = 0ULL;         //Quiet
-        u64 dp_moves = 0ULL;        //Double Pawn
-        u64 cap_moves = 0ULL;       //Captures
-        u64 ep_moves = 0ULL;        //En Passants
-
-        i32 square = getlsb(pawns);
-        i32 rank = square / 8;
-        char promotion = turn ? (rank == 6) : (rank == 1);
-        char can_double = turn ? (rank == 1) : (rank == 6);
-
-        //Single Step
-        occ = (oppPieces | ownPieces) & pawnMoves[square][pawn_mask_idx + 0];
-        if(!occ) q_moves |= (pawnMoves[square][pawn_mask_idx + 0] & check_squares);
-        
-        //Double Step
-        if(occ == 0 && can_double){
-            occ = (oppPieces | ownPieces) & pawnMoves[square][pawn_mask_idx + 1];
-            if(!occ) dp_moves |= (pawnMoves[square][pawn_mask_idx + 1] & check_squares);
-        }
-
-        //Capture Left
-        occ = (oppPieces) & pawnMoves[square][pawn_mask_idx + 2];
-        if(occ) cap_moves |= pawnMoves[square][pawn_mask_idx + 2];
-
-        occ = (enPassant) & pawnMoves[square][pawn_mask_idx + 2];
-        if(occ) ep_moves |= pawnMoves[square][pawn_mask_idx + 2];
-
-        //Capture Right
-        occ = (oppPieces) & pawnMoves[square][pawn_mask_idx + 3];
-        if(occ) cap_moves |= pawnMoves[square][pawn_mask_idx + 3];
-
-        occ = (enPassant) & pawnMoves[square][pawn_mask_idx + 3];
-        if(occ) ep_moves |= pawnMoves[square][pawn_mask_idx + 3];
-
-        all_moves |= q_moves | dp_moves | cap_moves | ep_moves;
-
-        while(q_moves){
-            i32 move_sq = getlsb(q_moves);
-            if (promotion) {
-                Move baseMove = create_move(square, move_sq, QUIET);
-                moveList[*idx] = SET_QUEEN_PROMOTION(baseMove);
-                (*idx)++;
-                moveList[*idx] = SET_ROOK_PROMOTION(baseMove);
-                (*idx)++;
-                moveList[*idx] = SET_BISHOP_PROMOTION(baseMove);
-                (*idx)++;
-                moveList[*idx] = SET_KNIGHT_PROMOTION(baseMove);
-                (*idx)++;
-            } else {
-                moveList[*idx] = create_move(square, move_sq, QUIET);
-                (*idx)++;
-            }
-            q_moves &= q_moves - 1;
-        }
-
-        while(cap_moves){
-            i32 move_sq = getlsb(cap_moves);
-            if (promotion) {
-                Move baseMove = create_move(square, move_sq, CAPTURE);
-                moveList[*idx] = SET_QUEEN_PROMO_CAPTURE(baseMove);
-                (*idx)++;
-                moveList[*idx] = SET_ROOK_PROMO_CAPTURE(baseMove);
-                (*idx)++;
-                moveList[*idx] = SET_BISHOP_PROMO_CAPTURE(baseMove);
-                (*idx)++;
-                moveList[*idx] = SET_KNIGHT_PROMO_CAPTURE(baseMove);
-                (*idx)++;
-            } else {
-                moveList[*idx] = create_move(square, move_sq, CAPTURE);
-                (*idx)++;
-            }
-            cap_moves &= cap_moves - 1;
-        }
-
-        while(dp_moves){
-            i32 move_sq = getlsb(dp_moves);
-            moveList[*idx] = create_move(square, move_sq, DOUBLE_PAWN_PUSH);
-            (*idx)++;
-            dp_moves &= dp_moves - 1;
-        }
-
-        while(ep_moves){
-            i32 move_sq = getlsb(ep_moves);
-            moveList[*idx] = create_move(square, move_sq, EP_CAPTURE);
-            (*idx)++;
-            ep_moves &= ep_moves - 1;
-        }
-
-        pawns &= pawns - 1;
-    }
-
-    return all_moves;
+    u64 opp_king = 1ULL << opp_king_square;
+    if(flags & WHITE_TURN) return pawnMovesAppend(pawns, ownPieces, oppPieces, enPassant, pawnAttacksSet(opp_king, BLACK), moveList, idx, WHITE);
+    return pawnMovesAppend(pawns, ownPieces, oppPieces, enPassant, pawnAttacksSet(opp_king, WHITE), moveList, idx, BLACK);
 }
 
 
@@ -573,7 +291,7 @@ u64 getKingAttacks(u64 kings) {
 u64 getKingMoves(Position* pos, Turn turn, i32* count) {
     u64 kings = pos->king[turn];
     u64 ownPieces = pos->color[turn];
-    u64 oppAttackMask = pos->attack_mask[!turn];
+    u64 oppAttackMask = get_attack_mask(pos, !turn);
     u64 all_moves = 0ULL;
 
     i32 square = getlsb(kings);
@@ -628,32 +346,8 @@ u64 getKingThreatMovesAppend(u64 kings, u64 ownPieces, u64 oppPieces, u64 oppAtt
 }
 
 void getCastleMovesAppend(u64 pieces, u64 attack_mask, char flags, Move* moveList, i32* idx){
-    if(flags & WHITE_TURN){
-        if ((flags & W_SHORT_CASTLE) && !((pieces | attack_mask) & W_SHORT_CASTLE_MASK)) {
-            Move move = create_move(4, 6, KING_CASTLE);
-            moveList[*idx] = move;
-            (*idx)++;
-        }
-
-        if ((flags & W_LONG_CASTLE) && !((pieces | (attack_mask & ~B_FILE_MASK)) & W_LONG_CASTLE_MASK)) {
-            Move move = create_move(4, 2, QUEEN_CASTLE);
-            moveList[*idx] = move;
-            (*idx)++;
-        }
-    }
-    else{
-        if ((flags & B_SHORT_CASTLE) && !((pieces | attack_mask) & B_SHORT_CASTLE_MASK)) {
-            Move move = create_move(60, 62, KING_CASTLE);
-            moveList[*idx] = move;
-            (*idx)++;
-        }
-
-        if ((flags & B_LONG_CASTLE) && !((pieces | (attack_mask & ~B_FILE_MASK)) & B_LONG_CASTLE_MASK)) {
-            Move move = create_move(60, 58, QUEEN_CASTLE);
-            moveList[*idx] = move;
-            (*idx)++;
-        }
-    }
+    if(flags & WHITE_TURN) castleMovesAppend(pieces, attack_mask, flags, moveList, idx, WHITE);
+    else                   castleMovesAppend(pieces, attack_mask, flags, moveList, idx, BLACK);
 }
 
 /*
@@ -697,20 +391,79 @@ u64 getXRayAttackers(Position* pos, i32 square, i32 attackerColor, u64 removed){
     return attackers & ~removed;
 }
 
+/*
+* Returns the absolutely pinned pieces of turn, which must be the side to move
+*/
+FORCE_INLINE u64 pinnedPiecesColor(Position* pos, const i32 turn){
+    u64 pos_pinners;
+    i32 k_square = getlsb(pos->king[turn]);
+
+    //Contains all the initial pieces
+    u64 all_pieces = pos->color[0] | pos->color[1];  
+
+    // The pieces belonging to white which become pinned
+    u64 pinned = pos->color[turn];  
+
+    // A attack masks
+    u64 d_attack_mask, h_attack_mask, attack_mask = 0ULL;
+
+    u64 pin_directions = 0ULL;
+    u64 ep_pawn_square = 0ULL;
+
+    // Make sure ep_pawn_square is the same row as the k_square
+    // if white turn => king must be row 5
+    // if black turn => king must be row 4
+    if((pos->en_passant != 0) && (k_square / 8 == (turn ? 4 : 3))){ //If can capture en-passant
+        ep_pawn_square = pawnPush(pos->en_passant, !turn);
+    }
+    
+    // Get a bb of squares being attacked by the king
+    attack_mask |= rookAttacks(all_pieces & ~ep_pawn_square, k_square);  
+    attack_mask |= bishopAttacks(all_pieces, k_square);
+
+    // The pinned white pieces now contains the ones with a ray to the king
+    pinned &= attack_mask; 
+
+    // Now get all pieces under attack as if king is queen again and these are the possible pinners
+    h_attack_mask = rookAttacks(all_pieces & ~pinned & ~ep_pawn_square, k_square);
+    pos_pinners = h_attack_mask & (pos->queen[!turn] | pos->rook[!turn]);
+    while(pos_pinners){
+        i32 pinner_sq = getlsb(pos_pinners);
+        pin_directions |= betweenMask[k_square][pinner_sq];
+        pos_pinners &= pos_pinners - 1;
+    }
+
+    d_attack_mask = bishopAttacks(all_pieces & ~pinned, k_square);
+    pos_pinners = d_attack_mask & (pos->queen[!turn] | pos->bishop[!turn]);
+    while(pos_pinners){
+        i32 pinner_sq = getlsb(pos_pinners);
+        pin_directions |= betweenMask[k_square][pinner_sq];
+        pos_pinners &= pos_pinners - 1;
+    }
+
+    // Only keep the pieces that are actually pinned
+    pinned &= pin_directions; 
+    return pinned;
+}
+
+u64 generatePinnedPieces(Position* pos){
+    return (pos->flags & WHITE_TURN) ? pinnedPiecesColor(pos, WHITE) : pinnedPiecesColor(pos, BLACK);
+}
+
 /*
 * Here be ye function to get moves for white when they are in check!
 */
 void getCheckMovesAppend(Position* pos, Move* moveList, i32* idx){
     i32 turn = pos->flags & WHITE_TURN;
     i32 king_sq = getlsb(pos->king[turn]);
-    u64 checker_mask = getAttackers(pos, king_sq, !turn);
+    u64 checker_mask = pos->checkers;
     i32 checker_sq = getlsb(checker_mask);
     i32 pawn_mask_idx = turn ? 0 : 4;
     u64 ownPieces = pos->color[turn];
     u64 oppPieces = pos->color[!turn];
     u64 between_squares = betweenMask[king_sq][checker_sq];
 
-    u64 upin = ~pos->pinned; //If in check, only unpinned pieces can moves (i believe havent proven though)
+    u64 upin = ~get_pinned(pos); //If in check, only unpinned pieces can moves (i believe havent proven though)
 
     
     if(pos->en_passant){
@@ -741,7 +494,7 @@ void getCheckMovesAppend(Position* pos, Move* moveList, i32* idx){
         pawns &= pawns - 1;
     }
 
-    getKingMovesAppend(    pos->king[turn] & upin, ownPieces, oppPieces, pos->attack_mask[!turn], moveList, idx);
+    getKingMovesAppend(    pos->king[turn] & upin, ownPieces, oppPieces, get_attack_mask(pos, !turn), moveList, idx);
 
     getKnightMovesAppend(pos->knight[turn] & upin, ~(between_squares | checker_mask), checker_mask, moveList, idx);
 
@@ -911,14 +664,14 @@ static void getPinnedPawnThreatMovesAppend(i32 king_rank, i32 king_file, u64 pin
 
 void getPinnedMovesAppend(Position* pos, Move* moveList, i32* size){
     i32 turn = pos->flags & WHITE_TURN;
-    u64 pinned = pos->pinned;
+    u64 pinned = get_pinned(pos);
     i32 king_sq = getlsb(pos->king[turn]);
     i32 king_rank = king_sq / 8;
     i32 king_file = king_sq % 8;
 
     //King does his thang
-    getKingMovesAppend(pos->king[turn], pos->color[turn],  pos->color[!turn], pos->attack_mask[!turn], moveList, size);
-    getCastleMovesAppend(pos->color[0] | pos->color[1], pos->attack_mask[!turn], pos->flags, moveList, size);
+    getKingMovesAppend(pos->king[turn], pos->color[turn],  pos->color[!turn], get_attack_mask(pos, !turn), moveList, size);
+    getCastleMovesAppend(pos->color[0] | pos->color[1], get_attack_mask(pos, !turn), pos->flags, moveList, size);
 
     //Pinned Knights Cannot Move
     u64 pinned_knights = pos->knight[turn] & pinned;
@@ -947,13 +700,13 @@ void getPinnedMovesAppend(Position* pos, Move* moveList, i32* size){
 
 void getPinnedThreatMovesAppend(Position* pos, u64 r_check_squares, u64 b_check_squares, i32 opp_king_sq, Move* moveList, i32* size){
     i32 turn = pos->flags & TURN_MASK;
-    u64 pinned = pos->pinned;
+    u64 pinned = get_pinned(pos);
     i32 king_sq = getlsb(pos->king[turn]);
     i32 king_rank = king_sq / 8;
     i32 king_file = king_sq % 8;
 
     //King does his thang
-    getKingThreatMovesAppend(pos->king[turn], pos->color[turn],  pos->color[!turn], pos->attack_mask[!turn], moveList, size);
+    getKingThreatMovesAppend(pos->king[turn], pos->color[turn],  pos->color[!turn], get_attack_mask(pos, !turn), moveList, size);
 
     //Pinned Knights Cannot Move
     u64 pinned_knights = pos->knight[turn] & pinned;
@@ -11,8 +11,13 @@
 #include <stdio.h>
 #include "bbutils.h"
 #include "../types.h"
+#include "../util.h"
 
-void generateMasks(void);
+#define B_FILE_MASK         0x0202020202020202ULL
+#define W_SHORT_CASTLE_MASK 0x0000000000000060ULL
+#define W_LONG_CASTLE_MASK  0x000000000000000EULL
+#define B_SHORT_CASTLE_MASK 0x6000000000000000ULL 
+#define B_LONG_CASTLE_MASK  0x0E00000000000000ULL
 
 u64 knightAttacks(i32 square);
 u64 getKnightAttacks(u64 knights);
@@ -23,10 +28,12 @@ u64 getKnightThreatMovesAppend(u64 knights, u64 ownPieces, u64 oppPieces, i32 op
 u64 getBishopAttacks(u64 bishops, u64 ownPieces, u64 oppPieces);
 u64 getBishopMovesAppend(u64 bishops, u64 ownPieces, u64 oppPieces, Move* moveList, i32* idx);
 u64 getBishopThreatMovesAppend(u64 bishops, u64 ownPieces, u64 oppPieces, u64 checkSquares, Move* moveList, i32* idx);
+u64 getBishopTargetMovesAppend(u64 bishops, u64 ownPieces, u64 oppPieces, u64 targets, Move* moveList, i32* idx);
 
 u64 getRookAttacks(u64 rooks, u64 ownPieces, u64 oppPieces);
 u64 getRookMovesAppend(u64 rooks, u64 ownPieces, u64 oppPieces, Move* moveList, i32* idx);
 u64 getRookThreatMovesAppend(u64 rooks, u64 ownPieces, u64 oppPieces, u64 checkSquares, Move* moveList, i32* idx);
+u64 getRookTargetMovesAppend(u64 rooks, u64 ownPieces, u64 oppPieces, u64 targets, Move* moveList, i32* idx);
 
 u64 pawnAttacks(u64 square, char turn);
 u64 getPawnAttacks(u64 pawns, char flags);
@@ -50,9 +57,119 @@ u64 getAttackers(Position* pos, i32 square, i32 attackerColor);
 u64 getXRayAttackers(Position* pos, i32 square, i32 attackerColor, u64 removed);
 
 u64 generateAttacks(Position* position, i32 turn);
+u64 generatePinnedPieces(Position* pos);
 
-static inline void setAttackMasks(Position* pos){
-    pos->attack_mask[1] = generateAttacks(pos, 1);
-    pos->attack_mask[0] = generateAttacks(pos, 0);
+/*
+ * Color templates, turn must be a constant WHITE or BLACK at the call site so
+ * every shift, rank and castle square below folds into a constant
+ */
+FORCE_INLINE u64 pawnPush(u64 pawns, const i32 turn){
+    return turn ? pawns << 8 : pawns >> 8;
+}
+
+FORCE_INLINE u64 pawnAttacksWest(u64 pawns, const i32 turn){
+    return turn ? noWeOne(pawns) : soWeOne(pawns);
+}
+
+FORCE_INLINE u64 pawnAttacksEast(u64 pawns, const i32 turn){
+    return turn ? noEaOne(pawns) : soEaOne(pawns);
+}
+
+FORCE_INLINE u64 pawnAttacksSet(u64 pawns, const i32 turn){
+    return pawnAttacksWest(pawns, turn) | pawnAttacksEast(pawns, turn);
+}
+
+/* Appends a move to every target square, from the square offset behind it */
+FORCE_INLINE void appendPawnTargets(u64 targets, i32 offset, i32 flags, Move* moveList, i32* idx){
+    while(targets){
+        i32 to = getlsb(targets);
+        moveList[(*idx)++] = create_move(to - offset, to, flags);
+        targets &= targets - 1;
+    }
+}
+
+FORCE_INLINE void appendPawnPromotions(u64 targets, i32 offset, i32 capture, Move* moveList, i32* idx){
+    while(targets){
+        i32 to = getlsb(targets);
+        moveList[(*idx)++] = create_move(to - offset, to, QUEEN_PROMOTION  | capture);
+        moveList[(*idx)++] = create_move(to - offset, to, ROOK_PROMOTION   | capture);
+        moveList[(*idx)++] = create_move(to - offset, to, BISHOP_PROMOTION | capture);
+        moveList[(*idx)++] = create_move(to - offset, to, KNIGHT_PROMOTION | capture);
+        targets &= targets - 1;
+    }
+}
+
+/*
+ * Set-wise pawn moves for one color, pushes are limited to pushTargets
+ * Returns every square a pawn can move to
+ */
+FORCE_INLINE u64 pawnMovesAppend(u64 pawns, u64 ownPieces, u64 oppPieces, u64 enPassant, u64 pushTargets, Move* moveList, i32* idx, const i32 turn){
+    const u64 promo_rank  = turn ? 0xFF00000000000000ULL : 0x00000000000000FFULL;
+    const u64 double_rank = turn ? 0x0000000000FF0000ULL : 0x0000FF0000000000ULL; // Where a single push from the start lands
+    const i32 up   = turn ?  8 : -8;
+    const i32 west = turn ?  7 : -9;
+    const i32 east = turn ?  9 : -7;
+
+    u64 empty   = ~(ownPieces | oppPieces);
+    u64 single  = pawnPush(pawns, turn) & empty;
+    u64 dbl     = pawnPush(single & double_rank, turn) & empty & pushTargets;
+    u64 west_bb = pawnAttacksWest(pawns, turn);
+    u64 east_bb = pawnAttacksEast(pawns, turn);
+    u64 cap_w   = west_bb & oppPieces;
+    u64 cap_e   = east_bb & oppPieces;
+    u64 ep_w    = west_bb & enPassant;
+    u64 ep_e    = east_bb & enPassant;
+    single &= pushTargets;
+
+    appendPawnPromotions(single & promo_rank, up,   QUIET,   moveList, idx);
+    appendPawnPromotions(cap_w  & promo_rank, west, CAPTURE, moveList, idx);
+    appendPawnPromotions(cap_e  & promo_rank, east, CAPTURE, moveList, idx);
+
+    appendPawnTargets(cap_w  & ~promo_rank, west, CAPTURE, moveList, idx);
+    appendPawnTargets(cap_e  & ~promo_rank, east, CAPTURE, moveList, idx);
+    appendPawnTargets(ep_w, west, EP_CAPTURE, moveList, idx);
+    appendPawnTargets(ep_e, east, EP_CAPTURE, moveList, idx);
+    appendPawnTargets(single & ~promo_rank, up, QUIET, moveList, idx);
+    appendPawnTargets(dbl, 2 * up, DOUBLE_PAWN_PUSH, moveList, idx);
+
+    return single | dbl | cap_w | cap_e | ep_w | ep_e;
+}
+
+FORCE_INLINE void castleMovesAppend(u64 pieces, u64 attack_mask, char flags, Move* moveList, i32* idx, const i32 turn){
+    const i32 king_sq    = turn ? 4 : 60;
+    const u8  short_flag = turn ? W_SHORT_CASTLE : B_SHORT_CASTLE;
+    const u8  long_flag  = turn ? W_LONG_CASTLE  : B_LONG_CASTLE;
+    const u64 short_mask = turn ? W_SHORT_CASTLE_MASK : B_SHORT_CASTLE_MASK;
+    const u64 long_mask  = turn ? W_LONG_CASTLE_MASK  : B_LONG_CASTLE_MASK;
+
+    if((flags & short_flag) && !((pieces | attack_mask) & short_mask)){
+        moveList[(*idx)++] = create_move(king_sq, king_sq + 2, KING_CASTLE);
+    }
+    if((flags & long_flag) && !((pieces | (attack_mask & ~B_FILE_MASK)) & long_mask)){
+        moveList[(*idx)++] = create_move(king_sq, king_sq - 2, QUEEN_CASTLE);
+    }
+}
+
+/*
+ * Squares attacked by color, generated the first time they are needed after a move
+ */
+static inline u64 get_attack_mask(Position* pos, i32 color){
+    u8 cached_bit = color ? WHITE_ATTACKS_CACHED : BLACK_ATTACKS_CACHED;
+    if(!(pos->cached & cached_bit)){
+        pos->attack_mask[color] = generateAttacks(pos, color);
+        pos->cached |= cached_bit;
+    }
+    return pos->attack_mask[color];
+}
+
+/*
+ * Pinned pieces of the side to move, generated the first time they are needed after a move
+ */
+static inline u64 get_pinned(Position* pos){
+    if(!(pos->cached & PINNED_CACHED)){
+        pos->pinned = generatePinnedPieces(pos);
+        pos->cached |= PINNED_CACHED;
+    }
+    return pos->pinned;
 }
 #endif /* bitboard_h */
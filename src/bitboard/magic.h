@@ -4,7 +4,46 @@
 #include <stdint.h>
 #include "../types.h"
 
-i32 generateMagics(void);
-u64 bishopAttacks(u64 occ, i32 sq);
-u64 rookAttacks(u64 occ, i32 sq);
-#endif
\ No newline at end of file
+// Linux builds define USE_PEXT, the PEXT backend is only compiled in when the target has BMI2
+#if defined(USE_PEXT) && defined(__BMI2__)
+#include <immintrin.h>
+#define PEXT_BUILD
+#endif
+
+#define ATTACK_TABLE_SIZE 107648 // One entry per blocker subset, for both sliders on every square
+
+typedef struct {
+    const u64* ptr;
+    u64 mask;
+    u64 magic;
+    i32 shift;
+} SMagic;
+
+// Generated by tools/gentables.c into bitboard/tables_gen.c
+extern const SMagic mBishopTbl[64];
+extern const SMagic mRookTbl[64];
+
+#ifdef PEXT_BUILD
+extern const SMagic mBishopPextTbl[64]; // Indexed by PEXT, magic and shift unused
+extern const SMagic mRookPextTbl[64];
+extern u8 use_pext; // Chosen at startup, FALSE on cpus where PEXT is microcoded
+#endif
+
+void selectSliderBackend(void);
+
+static inline u64 bishopAttacks(u64 occ, i32 sq){
+    #ifdef PEXT_BUILD
+    if(use_pext) return mBishopPextTbl[sq].ptr[_pext_u64(occ, mBishopPextTbl[sq].mask)];
+    #endif
+    const SMagic* m = &mBishopTbl[sq];
+    return m->ptr[((occ & m->mask) * m->magic) >> m->shift];
+}
+
+static inline u64 rookAttacks(u64 occ, i32 sq){
+    #ifdef PEXT_BUILD
+    if(use_pext) return mRookPextTbl[sq].ptr[_pext_u64(occ, mRookPextTbl[sq].mask)];
+    #endif
+    const SMagic* m = &mRookTbl[sq];
+    return m->ptr[((occ & m->mask) * m->magic) >> m->shift];
+}
+#endif
@@ -7,29 +7,134 @@
 #include "bitboard/bbutils.h"
 #include "bitboard/bitboard.h"
 #include "params.h"
+#include <stdlib.h>
+#include <string.h>
+
+const i32 PieceValues[PIECE_COUNT] = {
+    [WHITE_PAWN  ] = PawnValue,   [BLACK_PAWN  ] = PawnValue,
+    [WHITE_KNIGHT] = KnightValue, [BLACK_KNIGHT] = KnightValue,
+    [WHITE_BISHOP] = BishopValue, [BLACK_BISHOP] = BishopValue,
+    [WHITE_ROOK  ] = RookValue,   [BLACK_ROOK  ] = RookValue,
+    [WHITE_QUEEN ] = QueenValue,  [BLACK_QUEEN ] = QueenValue,
+    [WHITE_KING  ] = 0,           [BLACK_KING  ] = 0  // Both sides always have one
+};
 
-/* Returns a material-only based evaluation */
-i32 eval_material(Position* pos){
-    i32 eval = 0;
-    Turn turn = pos->flags & TURN_MASK;
-    eval += KingValue   * (count_bits(pos->king[turn])   - count_bits(pos->king[!turn]));
-    eval += QueenValue  * (count_bits(pos->queen[turn])  - count_bits(pos->queen[!turn]));
-    eval += RookValue   * (count_bits(pos->rook[turn])   - count_bits(pos->rook[!turn]));
-    eval += BishopValue * (count_bits(pos->bishop[turn]) - count_bits(pos->bishop[!turn]));
-    eval += KnightValue * (count_bits(pos->knight[turn]) - count_bits(pos->knight[!turn]));
-    eval += PawnValue   * (count_bits(pos->pawn[turn])   - count_bits(pos->pawn[!turn]));
-    return eval;
+const i32 PiecePhases[PIECE_COUNT] = {
+    [WHITE_KNIGHT] = MINOR_PHASE, [BLACK_KNIGHT] = MINOR_PHASE,
+    [WHITE_BISHOP] = MINOR_PHASE, [BLACK_BISHOP] = MINOR_PHASE,
+    [WHITE_ROOK  ] = ROOK_PHASE,  [BLACK_ROOK  ] = ROOK_PHASE,
+    [WHITE_QUEEN ] = QUEEN_PHASE, [BLACK_QUEEN ] = QUEEN_PHASE
 };
 
+/*
+ * Sums the material, PST, phase and piece counts of every piece, make and unmake move
+ * keep these up to date by delta from here on
+ */
+void init_eval_accumulators(Position* pos){
+    pos->material = 0;
+    pos->psq = 0;
+    pos->phase = 0;
+    pos->piece_count = 0;
+    pos->material_key = 0;
+    for(i32 square = 0; square < 64; square++){
+        u8 piece = pos->board[square];
+        if(piece == NO_PIECE) continue;
+        i32 sign = PIECE_COLOR(piece) == WHITE ? 1 : -1;
+        pos->material       += sign * PieceValues[piece];
+        pos->psq            += sign * (S(PieceValues[piece], PieceValues[piece]) + PST[piece][square]);
+        pos->phase          += PiecePhases[piece];
+        pos->piece_count++;
+        pos->material_key   += 1ULL << MATERIAL_SHIFT(piece);
+    }
+    pos->material_eval = (pos->flags & TURN_MASK) ? pos->material : -pos->material;
+}
+
+/*
+ * Allocates an empty pawn hash table, returns NULL when out of memory
+ */
+PawnTable* pawn_table_alloc(void){
+    return calloc(1, sizeof(PawnTable));
+}
+
+void pawn_table_free(PawnTable* pawn_table){
+    free(pawn_table);
+}
+
+MaterialTable* material_table_alloc(void){
+    return calloc(1, sizeof(MaterialTable));
+}
+
+void material_table_free(MaterialTable* material_table){
+    free(material_table);
+}
+
+EvalTable* eval_table_alloc(void){
+    return calloc(1, sizeof(EvalTable));
+}
+
+void eval_table_free(EvalTable* eval_table){
+    free(eval_table);
+}
 
-void init_eval_data(Position * pos, EvalData* eval_data, Turn turn){
+/*
+ * Fills a material table entry from the piece counts of a material key
+ */
+static void fill_material_entry(u64 key, MaterialEntry* entry){
+    i32 npm[2];
+    memset(entry, 0, sizeof(MaterialEntry));
+    entry->key = key;
+    if(isInsufficientMaterial(key)) entry->flags |= MATERIAL_DRAW;
+
+    for(i32 color = 0; color < 2; color++){
+        i32 pawns   = MATERIAL_COUNT(key, PIECE_INDEX(PAWN,   color));
+        i32 knights = MATERIAL_COUNT(key, PIECE_INDEX(KNIGHT, color));
+        i32 bishops = MATERIAL_COUNT(key, PIECE_INDEX(BISHOP, color));
+        i32 rooks   = MATERIAL_COUNT(key, PIECE_INDEX(ROOK,   color));
+        i32 queens  = MATERIAL_COUNT(key, PIECE_INDEX(QUEEN,  color));
+        npm[color] = knights * KnightValue + bishops * BishopValue + rooks * RookValue + queens * QueenValue;
+
+        // Knights are worth more and rooks less with more pawns on the board
+        i32 adjust = knights * KnightAdjust[MIN(pawns, 8)] + rooks * RookAdjust[MIN(pawns, 8)];
+        entry->imbalance += color == WHITE ? S(adjust, adjust) : -S(adjust, adjust);
+    }
+
+    // Without pawns a side needs more than a minor piece up to win
+    for(i32 color = 0; color < 2; color++){
+        entry->scale[color] = SCALE_NORMAL;
+        if(MATERIAL_COUNT(key, PIECE_INDEX(PAWN, color)) || npm[color] - npm[!color] > BishopValue) continue;
+        if(npm[color] < RookValue)          entry->scale[color] = SCALE_NO_WIN;
+        else if(npm[!color] <= BishopValue) entry->scale[color] = SCALE_HARD_TO_WIN;
+        else                                entry->scale[color] = SCALE_DRAWISH;
+    }
+}
+
+/*
+ * Returns the material entry of the position, from the table when it holds it
+ * Without a table the entry is computed into scratch
+ */
+static MaterialEntry* probe_material_entry(Position * pos, MaterialTable* material_table, MaterialEntry* scratch){
+    u64 key = pos->material_key;
+    if(!material_table){
+        fill_material_entry(key, scratch);
+        return scratch;
+    }
+    // Both kings are always counted so no key is 0, the key of an empty entry
+    MaterialEntry* entry = &material_table->entry[(key * 0x9E3779B97F4A7C15ULL) >> (64 - MATERIAL_TABLE_BITS)];
+    if(entry->key != key) fill_material_entry(key, entry);
+    return entry;
+}
+
+FORCE_INLINE void init_eval_data(Position * pos, EvalData* eval_data, const Turn turn){
     // Get the safety region for the king
     eval_data->king_area[turn] = KingAreaMask[getlsb(pos->king[turn])];
 }
 
-void eval_pawns(Position * pos, EvalData* eval_data, Turn turn){
-    const PieceIndex piece = turn ? WHITE_PAWN : BLACK_PAWN;
-    eval_data->pawn_count[turn] = 0;
+/*
+ * Pawn structure terms of one side, these only depend on where the pawns are
+ * so they are stored in the pawn hash table entry
+ */
+FORCE_INLINE void eval_pawn_structure(Position * pos, PawnEntry* entry, const Turn turn){
+    Score score = 0;
 
     // Iterate through the pawns
     u64 pieces = pos->pawn[turn];
@@ -37,27 +142,15 @@ void eval_pawns(Position * pos, EvalData* eval_data, Turn turn){
         i32 square = getlsb(pieces);
         u32 file = square % 8;
         u32 promo_square = turn ? A8 + file : A1 + file;
-        u64 attacks = pawnAttacks(square, turn);
-
-        // Material Value
-        eval_data->eval[PHASE_MG][turn] += PawnValue;
-        eval_data->eval[PHASE_EG][turn] += PawnValue;
 
-        // PST
-        eval_data->eval[PHASE_MG][turn] += PST[PHASE_MG][piece][square];
-        eval_data->eval[PHASE_EG][turn] += PST[PHASE_EG][piece][square];
-
-        // Passed Pawn Bonus
-        if((PassedPawnMask[turn][square] & pos->pawn[!turn])){
-            eval_data->eval[PHASE_MG][turn] += PassedPawnBonus[PHASE_MG];
-            eval_data->eval[PHASE_EG][turn] += PassedPawnBonus[PHASE_EG];
-        }
+        // Pawns getting the passed pawn bonus, the rule the eval was tuned with
+        // gives it to pawns with an enemy pawn in front of them or on a neighbouring file
+        if(PassedPawnMask[turn][square] & pos->pawn[!turn]) entry->passed[turn] |= 1ULL << square;
 
         // Doubled Pawn Penalty
         // Applied for the pawn in the back
         if(!(betweenMask[square][promo_square] & pos->pawn[turn])){
-            eval_data->eval[PHASE_MG][turn] += DoubledPawnPenalty[PHASE_MG];
-            eval_data->eval[PHASE_EG][turn] += DoubledPawnPenalty[PHASE_EG];
+            score += DoubledPawnPenalty;
         }
 
         // Isolated pawn penalty
@@ -65,50 +158,89 @@ void eval_pawns(Position * pos, EvalData* eval_data, Turn turn){
         if(     ( file == 0 && !(fileMask[file + 1] & pos->pawn[turn]) )
             ||  ( file == 7 && !(fileMask[file - 1] & pos->pawn[turn]) )
             ||  ( !(fileMask[file + 1] & pos->pawn[turn] || fileMask[file - 1] & pos->pawn[turn]) ) ){
-            eval_data->eval[PHASE_MG][turn] += IsolatedPawnPenalty[PHASE_MG];
-            eval_data->eval[PHASE_EG][turn] += IsolatedPawnPenalty[PHASE_EG];
+            score += IsolatedPawnPenalty;
         }
 
-        // Update King safety data
-        eval_data->attack_units[turn] += count_bits(eval_data->king_area[!turn] & attacks) * ATTACK_UNIT_PAWN;
-
         // Update evaluation data
-        eval_data->pawn_attacks[turn] |= attacks;
-        eval_data->pawn_count[turn]++;
         if(is_square_light(square))
-            eval_data->light_pawn_count[turn]++;
+            entry->light_count[turn]++;
         else
-            eval_data->dark_pawn_count[turn]++;
+            entry->dark_count[turn]++;
 
         pieces &= pieces - 1;
     }
+    entry->attacks[turn] = pawnAttacksSet(pos->pawn[turn], turn);
+
+    // Passed Pawn Bonus
+    score += count_bits(entry->passed[turn]) * PassedPawnBonus;
 
     // Count the rammed pawns by shifting the pawn bitboard one move
     // forward relative to the pawn type and comparing with enemy pawns
     // we dont need to use masks because pawns cant be on those rows
     pieces = pos->pawn[turn];
-    pieces = turn ? northOne(pieces) : southOne(pieces);
+    pieces = pawnPush(pieces, turn);
     i32 rammed_cnt = count_bits(pieces & pos->pawn[!turn]);
-    eval_data->eval[PHASE_MG][turn] += rammed_cnt * RammedPawnPenalty[PHASE_MG];
-    eval_data->eval[PHASE_EG][turn] += rammed_cnt * RammedPawnPenalty[PHASE_EG];
+    score += rammed_cnt * RammedPawnPenalty;
 
     // Bonus for connected pawns
     // Calculate from looking at the pawns that attack friendly pawns
-    i32 connected_cnt = count_bits(eval_data->pawn_attacks[turn] & pos->pawn[turn]);
-    eval_data->eval[PHASE_MG][turn] += connected_cnt * ConnectedPawnBonus[PHASE_MG];
-    eval_data->eval[PHASE_EG][turn] += connected_cnt * ConnectedPawnBonus[PHASE_EG];
+    i32 connected_cnt = count_bits(entry->attacks[turn] & pos->pawn[turn]);
+    score += connected_cnt * ConnectedPawnBonus;
+
+    entry->score += turn ? score : -score;
+}
+
+/*
+ * Fills a pawn hash table entry for the pawns of the position
+ */
+static void fill_pawn_entry(Position * pos, PawnEntry* entry){
+    memset(entry, 0, sizeof(PawnEntry));
+    entry->key = pos->pawn_hash;
+    eval_pawn_structure(pos, entry, WHITE);
+    eval_pawn_structure(pos, entry, BLACK);
+}
+
+/*
+ * Returns the pawn structure entry of the position, from the table when it holds it
+ * Without a table the entry is computed into scratch
+ */
+static PawnEntry* probe_pawn_entry(Position * pos, PawnTable* pawn_table, PawnEntry* scratch){
+    if(!pawn_table){
+        fill_pawn_entry(pos, scratch);
+        return scratch;
+    }
+    // A zeroed entry is already correct for a position without pawns, whose key is 0
+    PawnEntry* entry = &pawn_table->entry[pos->pawn_hash & (PAWN_TABLE_ENTRIES - 1)];
+    if(entry->key != pos->pawn_hash) fill_pawn_entry(pos, entry);
+    #ifdef DEBUG
+    else{
+        fill_pawn_entry(pos, scratch);
+        if(memcmp(scratch, entry, sizeof(PawnEntry))){
+            printf("Pawn hash table entry does not match the pawns of the position!\n");
+            printPosition(*pos, TRUE);
+            fflush(stdout);
+            while(1);
+        }
+    }
+    #endif
+    return entry;
+}
+
+FORCE_INLINE void eval_pawns(Position * pos, EvalData* eval_data, const Turn turn){
+    // Update King safety data, every pawn attack on the area counts once
+    // which the west and east attacks of all pawns give without overlaps
+    u64 area = eval_data->king_area[!turn];
+    i32 area_attacks = count_bits(area & pawnAttacksWest(pos->pawn[turn], turn)) + count_bits(area & pawnAttacksEast(pos->pawn[turn], turn));
+    eval_data->attack_units[turn] += area_attacks * ATTACK_UNIT_PAWN;
 
     // Penalty for hanging pawns
-    i32 hanging_cnt = count_bits(~pos->attack_mask[turn] & pos->pawn[turn]);
-    eval_data->eval[PHASE_MG][turn] += hanging_cnt * PawnHangingPenalty[PHASE_MG];
-    eval_data->eval[PHASE_EG][turn] += hanging_cnt * PawnHangingPenalty[PHASE_EG];
+    i32 hanging_cnt = count_bits(~get_attack_mask(pos, turn) & pos->pawn[turn]);
+    eval_data->eval[turn] += hanging_cnt * PawnHangingPenalty;
 
     return;
 }
 
-void eval_knights(Position * pos, EvalData* eval_data, Turn turn){
-    const PieceIndex piece = turn ? WHITE_KNIGHT : BLACK_KNIGHT;
-
+FORCE_INLINE void eval_knights(Position * pos, EvalData* eval_data, const Turn turn){
     // Update evaluation attack mask
     eval_data->knight_attacks[turn] = getKnightAttacks(pos->knight[turn]);
    
@@ -116,56 +248,39 @@ void eval_knights(Position * pos, EvalData* eval_data, Turn turn){
     while (pieces) {
         i32 square = getlsb(pieces);
 
-        // Knight material value
-        // Changes with the number of pawns we have
-        eval_data->eval[PHASE_MG][turn] += KnightValue + KnightAdjust[eval_data->pawn_count[turn]];
-        eval_data->eval[PHASE_EG][turn] += KnightValue + KnightAdjust[eval_data->pawn_count[turn]];
-
-        // PST Values
-        eval_data->eval[PHASE_MG][turn] += PST[PHASE_MG][piece][square];
-        eval_data->eval[PHASE_EG][turn] += PST[PHASE_EG][piece][square];
-
         // Calculate the knight mobility by looking at
         // where it can move thats not under attack by opponenet
         // first we filter out moves where it attacks friendly
         // and then and it with the inverse opponent attack mask
         u64 knight_moves = knightAttacks(square) & ~pos->color[turn];
-        i32 mobility = count_bits(knight_moves & ~pos->attack_mask[!turn]);
-        eval_data->eval[PHASE_MG][turn] += KnightMobility[PHASE_MG][mobility];
-        eval_data->eval[PHASE_EG][turn] += KnightMobility[PHASE_EG][mobility];
+        i32 mobility = count_bits(knight_moves & ~get_attack_mask(pos, !turn));
+        eval_data->eval[turn] += KnightMobility[mobility];
 
         // Update King safety data
         eval_data->attack_units[turn] += count_bits(eval_data->king_area[!turn] & knight_moves) * ATTACK_UNIT_KNIGHT;
 
-        // Update the phase
-        eval_data->phase_value += MINOR_PHASE;
-
         pieces &= pieces - 1;
     }
 
     // Knight outpost bonus
     // it an outpost if not attacked by enemy pawns
     // and is in an outpost square, bonus for knights protected by pawn
-    u64 outpost_knights = pos->knight[turn] & ~eval_data->pawn_attacks[!turn] & KnightOutpostMask[turn];
+    u64 outpost_knights = pos->knight[turn] & ~eval_data->pawns->attacks[!turn] & KnightOutpostMask[turn];
     u32 outpost_count = count_bits(outpost_knights);
-    u32 extra_outpost_count = count_bits(outpost_knights & eval_data->pawn_attacks[turn]);
+    u32 extra_outpost_count = count_bits(outpost_knights & eval_data->pawns->attacks[turn]);
 
-    eval_data->eval[PHASE_MG][turn] += OutpostKnightBonus[PHASE_MG] * outpost_count;
-    eval_data->eval[PHASE_EG][turn] += OutpostKnightBonus[PHASE_EG] * outpost_count;
+    eval_data->eval[turn] += OutpostKnightBonus * outpost_count;
 
-    eval_data->eval[PHASE_MG][turn] += OutpostKnightExtraBonus[PHASE_MG] * extra_outpost_count;
-    eval_data->eval[PHASE_EG][turn] += OutpostKnightExtraBonus[PHASE_EG] * extra_outpost_count;
+    eval_data->eval[turn] += OutpostKnightExtraBonus * extra_outpost_count;
 
     // Penalty for hanging knights
-    i32 handing_cnt = count_bits(~pos->attack_mask[turn] & pos->knight[turn]);
-    eval_data->eval[PHASE_MG][turn] += KnightHangingPenalty[PHASE_MG] * handing_cnt;
-    eval_data->eval[PHASE_EG][turn] += KnightHangingPenalty[PHASE_EG] * handing_cnt;
+    i32 handing_cnt = count_bits(~get_attack_mask(pos, turn) & pos->knight[turn]);
+    eval_data->eval[turn] += KnightHangingPenalty * handing_cnt;
 
     return;
 }
 
-void eval_bishops(Position * pos, EvalData* eval_data, Turn turn){
-    const PieceIndex piece = turn ? WHITE_BISHOP : BLACK_BISHOP;
+FORCE_INLINE void eval_bishops(Position * pos, EvalData* eval_data, const Turn turn){
     i32 light_bishops = 0, dark_bishops = 0;
 
     // Update evaluation attack mask
@@ -175,181 +290,125 @@ void eval_bishops(Position * pos, EvalData* eval_data, Turn turn){
     while (pieces) {
         i32 square = getlsb(pieces);
 
-        // Material Value
-        eval_data->eval[PHASE_MG][turn] += BishopValue;
-        eval_data->eval[PHASE_EG][turn] += BishopValue;
-
-        // PST Values
-        eval_data->eval[PHASE_MG][turn] += PST[PHASE_MG][piece][square];
-        eval_data->eval[PHASE_EG][turn] += PST[PHASE_EG][piece][square];
-
         // Calculate the bishop mobility by looking at
         // where it can move thats not under attack by opponenet
         // first we filter out moves where it attacks friendly
         // and then and it with the inverse opponent attack mask
         u64 bishop_moves = bishopAttacks(pos->color[turn] | pos->color[!turn], square) & ~pos->color[turn];
-        i32 mobility = count_bits(bishop_moves & ~pos->attack_mask[!turn]);
-        eval_data->eval[PHASE_MG][turn] += BishopMobility[PHASE_MG][mobility];
-        eval_data->eval[PHASE_EG][turn] += BishopMobility[PHASE_EG][mobility];
+        i32 mobility = count_bits(bishop_moves & ~get_attack_mask(pos, !turn));
+        eval_data->eval[turn] += BishopMobility[mobility];
         
         // Here we do some square color evaluation,
         // if the bishop is on the same square as a majority
         // of its own pawns it gets penalized
         if(is_square_light(square)){
             light_bishops++;
-            if(eval_data->light_pawn_count[turn] > eval_data->dark_pawn_count[turn] + 1){
-                eval_data->eval[PHASE_MG][turn] += BishopPawnWeakPenalty[PHASE_MG];
-                eval_data->eval[PHASE_EG][turn] += BishopPawnWeakPenalty[PHASE_EG];
+            if(eval_data->pawns->light_count[turn] > eval_data->pawns->dark_count[turn] + 1){
+                eval_data->eval[turn] += BishopPawnWeakPenalty;
             }
         }
         else{
             dark_bishops++;
-            if(eval_data->dark_pawn_count[turn] > eval_data->light_pawn_count[turn] + 1){
-                eval_data->eval[PHASE_MG][turn] += BishopPawnWeakPenalty[PHASE_MG];
-                eval_data->eval[PHASE_EG][turn] += BishopPawnWeakPenalty[PHASE_EG];
+            if(eval_data->pawns->dark_count[turn] > eval_data->pawns->light_count[turn] + 1){
+                eval_data->eval[turn] += BishopPawnWeakPenalty;
             }
         }
 
         // Update King safety data
         eval_data->attack_units[turn] += count_bits(eval_data->king_area[!turn] & bishop_moves) * ATTACK_UNIT_BISHOP;
 
-        // Update the phase
-        eval_data->phase_value += MINOR_PHASE;
-
         pieces &= pieces - 1;
     }
 
     // Give a bonus if there are bishops on opposite colors
     if (light_bishops >= 1 && dark_bishops >= 1){
-        eval_data->eval[PHASE_MG][turn] += OppositeBishopBonus[PHASE_MG];
-        eval_data->eval[PHASE_EG][turn] += OppositeBishopBonus[PHASE_EG];
+        eval_data->eval[turn] += OppositeBishopBonus;
     } 
 
     // Bishop outpost bonus
     // it an outpost if not attacked by enemy pawns
     // and is in an outpost square, bonus for knights protected by pawn
-    u64 outpost_bishops = pos->bishop[turn] & ~eval_data->pawn_attacks[!turn] & BishopOutpostMask[turn];
+    u64 outpost_bishops = pos->bishop[turn] & ~eval_data->pawns->attacks[!turn] & BishopOutpostMask[turn];
     i32 outpost_cnt = count_bits(outpost_bishops);
-    i32 extra_outpost_cnt = count_bits(outpost_bishops & eval_data->pawn_attacks[turn]);
-    eval_data->eval[PHASE_MG][turn] += OutpostBishopBonus[PHASE_MG] * outpost_cnt;
-    eval_data->eval[PHASE_EG][turn] += OutpostBishopBonus[PHASE_EG] * outpost_cnt;
-    eval_data->eval[PHASE_MG][turn] += OutpostBishopExtraBonus[PHASE_MG] * extra_outpost_cnt;
-    eval_data->eval[PHASE_EG][turn] += OutpostBishopExtraBonus[PHASE_EG] * extra_outpost_cnt;
+    i32 extra_outpost_cnt = count_bits(outpost_bishops & eval_data->pawns->attacks[turn]);
+    eval_data->eval[turn] += OutpostBishopBonus * outpost_cnt;
+    eval_data->eval[turn] += OutpostBishopExtraBonus * extra_outpost_cnt;
 
     // Penalty for hanging bishops
-    i32 hanging_cnt = count_bits(~pos->attack_mask[turn] & pos->bishop[turn]);
-    eval_data->eval[PHASE_MG][turn] += BishopHangingPenalty[PHASE_MG] * hanging_cnt;
-    eval_data->eval[PHASE_EG][turn] += BishopHangingPenalty[PHASE_EG] * hanging_cnt;
+    i32 hanging_cnt = count_bits(~get_attack_mask(pos, turn) & pos->bishop[turn]);
+    eval_data->eval[turn] += BishopHangingPenalty * hanging_cnt;
 
     return;
 }
 
-void eval_rooks(Position * pos, EvalData* eval_data, Turn turn){
-    const PieceIndex piece = turn ? WHITE_ROOK : BLACK_ROOK;
-
+FORCE_INLINE void eval_rooks(Position * pos, EvalData* eval_data, const Turn turn){
     // Update evaluation attack mask
     eval_data->rook_attacks[turn] = getRookAttacks(pos->rook[turn], pos->color[turn], pos->color[!turn]);
 
-    // PST Values
     u64 pieces = pos->rook[turn];
     while (pieces) {
         i32 square = getlsb(pieces);
 
-        // Rook material value
-        // Changes with the number of pawns we have
-        eval_data->eval[PHASE_MG][turn] += RookValue + RookAdjust[eval_data->pawn_count[turn]];
-        eval_data->eval[PHASE_EG][turn] += RookValue + RookAdjust[eval_data->pawn_count[turn]];
-
-        // PST Values
-        eval_data->eval[PHASE_MG][turn] += PST[PHASE_MG][piece][square];
-        eval_data->eval[PHASE_EG][turn] += PST[PHASE_EG][piece][square];
-
         // Calculate the rook mobility by looking at
         // where it can move thats not under attack by opponenet
         u64 rook_moves = rookAttacks(pos->color[turn] | pos->color[!turn], square) & ~pos->color[turn];
-        i32 mobility = count_bits(rook_moves & ~pos->attack_mask[!turn]);
-        eval_data->eval[PHASE_MG][turn] += RookMobility[PHASE_MG][mobility];
-        eval_data->eval[PHASE_EG][turn] += RookMobility[PHASE_EG][mobility];
+        i32 mobility = count_bits(rook_moves & ~get_attack_mask(pos, !turn));
+        eval_data->eval[turn] += RookMobility[mobility];
 
         // Update King safety data
         eval_data->attack_units[turn] += count_bits(eval_data->king_area[!turn] & rook_moves) * ATTACK_UNIT_ROOK;
 
-        // Update the phase
-        eval_data->phase_value += ROOK_PHASE;
-
         pieces &= pieces - 1;
     }
 
     // Connected Rook Bonus
     // Given if one of the rooks is attacking the other
     if(count_bits(eval_data->rook_attacks[turn] & pos->rook[turn]) >= 2){
-        eval_data->eval[PHASE_MG][turn] += ConnectedRookBonus[PHASE_MG];
-        eval_data->eval[PHASE_EG][turn] += ConnectedRookBonus[PHASE_EG];
+        eval_data->eval[turn] += ConnectedRookBonus;
     }
 
     // Double Rook Penalty
     // having two rooks is not that great or something not sure abt this one
     if (count_bits(pos->rook[turn]) >= 2){
-        eval_data->eval[PHASE_MG][turn] += TwoRookPenalty[PHASE_MG];
-        eval_data->eval[PHASE_EG][turn] += TwoRookPenalty[PHASE_EG];
+        eval_data->eval[turn] += TwoRookPenalty;
     }
 
     // Penalty for hanging rooks
-    i32 hanging_cnt = count_bits(~pos->attack_mask[turn] & pos->rook[turn]);
-    eval_data->eval[PHASE_MG][turn] += RookHangingPenalty[PHASE_MG] * hanging_cnt;
-    eval_data->eval[PHASE_EG][turn] += RookHangingPenalty[PHASE_EG] * hanging_cnt;
+    i32 hanging_cnt = count_bits(~get_attack_mask(pos, turn) & pos->rook[turn]);
+    eval_data->eval[turn] += RookHangingPenalty * hanging_cnt;
 
     return;
 }
 
-void eval_queens(Position * pos, EvalData* eval_data, Turn turn){
-    const PieceIndex piece = turn ? WHITE_QUEEN : BLACK_QUEEN;
+FORCE_INLINE void eval_queens(Position * pos, EvalData* eval_data, const Turn turn){
     
     u64 pieces = pos->queen[turn];
     while (pieces) {
         i32 square = getlsb(pieces);
 
-        // Material Value
-        eval_data->eval[PHASE_MG][turn] += QueenValue;
-        eval_data->eval[PHASE_EG][turn] += QueenValue;
-
-        // PST Values
-        eval_data->eval[PHASE_MG][turn] += PST[PHASE_MG][piece][square];
-        eval_data->eval[PHASE_EG][turn] += PST[PHASE_EG][piece][square];
-
         // Calculate the queen mobility by looking at
         // where it can move thats not under attack by opponenet
         u64 queen_moves  = rookAttacks(  pos->color[turn] | pos->color[!turn], square) & ~pos->color[turn];
             queen_moves |= bishopAttacks(pos->color[turn] | pos->color[!turn], square) & ~pos->color[turn];
-        eval_data->eval[PHASE_MG][turn] += QueenMobility[PHASE_MG][count_bits(queen_moves & ~pos->attack_mask[!turn])];
-        eval_data->eval[PHASE_EG][turn] += QueenMobility[PHASE_EG][count_bits(queen_moves & ~pos->attack_mask[!turn])];
+        eval_data->eval[turn] += QueenMobility[count_bits(queen_moves & ~get_attack_mask(pos, !turn))];
 
         // Update King safety data
         eval_data->attack_units[turn] += count_bits(eval_data->king_area[!turn] & queen_moves) * ATTACK_UNIT_QUEEN;
 
-        // Update the phase
-        eval_data->phase_value += QUEEN_PHASE;
-
         pieces &= pieces - 1;
     }
 
     // Penalty for hanging queens
-    i32 hanging_cnt = count_bits(~pos->attack_mask[turn] & pos->queen[turn]);
-    eval_data->eval[PHASE_MG][turn] += QueenHangingPenalty[PHASE_MG] * hanging_cnt;
-    eval_data->eval[PHASE_EG][turn] += QueenHangingPenalty[PHASE_EG] * hanging_cnt;
+    i32 hanging_cnt = count_bits(~get_attack_mask(pos, turn) & pos->queen[turn]);
+    eval_data->eval[turn] += QueenHangingPenalty * hanging_cnt;
 
     return;
 }
 
-void eval_kings(Position * pos, EvalData* eval_data, Turn turn){
-    const PieceIndex piece = turn ? WHITE_KING : BLACK_KING;
+FORCE_INLINE void eval_kings(Position * pos, EvalData* eval_data, const Turn turn){
     const u32 square = getlsb(pos->king[turn]);
     i32 file = square % 8;
 
-    // PST Values
-    eval_data->eval[PHASE_MG][turn] += PST[PHASE_MG][piece][square];
-    eval_data->eval[PHASE_EG][turn] += PST[PHASE_EG][piece][square];
-
     // Mobility
     i32 move_count = 0;
     getKingMoves(pos, turn, &move_count);
@@ -361,26 +420,23 @@ void eval_kings(Position * pos, EvalData* eval_data, Turn turn){
     // Penalty for when there are no pawns on a file near the king
     for(i32 i = MAX(0, file-1); i <= MIN(7, file+1); i++){
         if(fileMask[file] & (pos->pawn[turn] | pos->pawn[!turn]) ){
-            eval_data->eval[PHASE_MG][turn] += OpenFileNearKingPenalty[PHASE_MG];
-            eval_data->eval[PHASE_EG][turn] += OpenFileNearKingPenalty[PHASE_EG];
+            eval_data->eval[turn] += OpenFileNearKingPenalty;
         } 
     }
 
     // King gets a bonus or a penalty for the
     // number of friendly pawns in its area
     i32 pawns_near_cnt = count_bits(eval_data->king_area[turn] & pos->pawn[turn]);
-    eval_data->eval[PHASE_MG][turn] += PawnsInKingArea[PHASE_MG][pawns_near_cnt];
+    eval_data->eval[turn] += S(mg_score(PawnsInKingArea[pawns_near_cnt]), 0);
 
     // The king loses eval if its very susceptible to sliding attacks, to do this we
     // look at how it can move as a queen
     u64 virt_moves  = rookAttacks(  pos->color[turn] | pos->color[!turn], square) & ~pos->color[turn];
         virt_moves |= bishopAttacks(pos->color[turn] | pos->color[!turn], square) & ~pos->color[turn];
-    eval_data->eval[PHASE_MG][turn] += VirtualMobility[PHASE_MG][count_bits(virt_moves)];
-    eval_data->eval[PHASE_EG][turn] += VirtualMobility[PHASE_EG][count_bits(virt_moves)];
+    eval_data->eval[turn] += VirtualMobility[count_bits(virt_moves)];
 
-    // Safety information from enemy pieces attacking the kings area
-    eval_data->eval[PHASE_MG][turn] -= SafetyTable[PHASE_MG][eval_data->attack_units[!turn]];
-    eval_data->eval[PHASE_EG][turn] -= SafetyTable[PHASE_EG][eval_data->attack_units[!turn]];
+    // Safety information from enemy pieces attacking the kings area, the table is flat past its end
+    eval_data->eval[turn] -= SafetyTable[MIN(eval_data->attack_units[!turn], 99)];
 
     return;
 }
@@ -388,66 +444,114 @@ void eval_kings(Position * pos, EvalData* eval_data, Turn turn){
 /* 
  * Evaluates a position
  */
-i32 eval_position(Position* pos){
+i32 eval_position(Position* pos, PawnTable* pawn_table, MaterialTable* material_table){
     i32 eval = 0;
     EvalData eval_data = {0};
+    PawnEntry pawn_scratch;
+    MaterialEntry material_scratch;
     Turn turn = pos->flags & TURN_MASK;
 
     // Check for insufficient material
-    if(isInsufficient(pos)) return 0;
+    MaterialEntry* material = probe_material_entry(pos, material_table, &material_scratch);
+    if(material->flags & MATERIAL_DRAW) return 0;
 
     // Set up the evaluation data structure
     init_eval_data(pos, &eval_data, WHITE);
     init_eval_data(pos, &eval_data, BLACK);
 
+    // Material, PST and phase are kept up to date by make and unmake move
+    eval_data.eval[WHITE_TURN] = pos->psq;
+    eval_data.phase_value = pos->phase;
+
+    // Pawn structure comes from the pawn hash table
+    eval_data.pawns = probe_pawn_entry(pos, pawn_table, &pawn_scratch);
+    eval_data.eval[WHITE_TURN] += eval_data.pawns->score + material->imbalance;
+
     // Evaluate pieces
     eval_pawns(pos, &eval_data, WHITE);
     eval_pawns(pos, &eval_data, BLACK);
 
-    // i32 print_mg_score = eval_data.eval[PHASE_MG][WHITE_TURN] - eval_data.eval[PHASE_MG][BLACK_TURN];
-    // i32 print_eg_score = eval_data.eval[PHASE_EG][WHITE_TURN] - eval_data.eval[PHASE_EG][BLACK_TURN];
+    // i32 print_mg_score = mg_score(eval_data.eval[WHITE_TURN] - eval_data.eval[BLACK_TURN]);
+    // i32 print_eg_score = eg_score(eval_data.eval[WHITE_TURN] - eval_data.eval[BLACK_TURN]);
     // printf("after pawns: mg_score %d  eg_score %d \n", print_mg_score, print_eg_score);
 
     eval_knights(pos, &eval_data, WHITE);
     eval_knights(pos, &eval_data, BLACK);
 
-    // print_mg_score = eval_data.eval[PHASE_MG][WHITE_TURN] - eval_data.eval[PHASE_MG][BLACK_TURN];
-    // print_eg_score = eval_data.eval[PHASE_EG][WHITE_TURN] - eval_data.eval[PHASE_EG][BLACK_TURN];
+    // print_mg_score = mg_score(eval_data.eval[WHITE_TURN] - eval_data.eval[BLACK_TURN]);
+    // print_eg_score = eg_score(eval_data.eval[WHITE_TURN] - eval_data.eval[BLACK_TURN]);
     // printf("after knights: mg_score %d  eg_score %d \n", print_mg_score, print_eg_score);
 
     eval_bishops(pos, &eval_data, WHITE);
     eval_bishops(pos, &eval_data, BLACK);
 
-    // print_mg_score = eval_data.eval[PHASE_MG][WHITE_TURN] - eval_data.eval[PHASE_MG][BLACK_TURN];
-    // print_eg_score = eval_data.eval[PHASE_EG][WHITE_TURN] - eval_data.eval[PHASE_EG][BLACK_TURN];
+    // print_mg_score = mg_score(eval_data.eval[WHITE_TURN] - eval_data.eval[BLACK_TURN]);
+    // print_eg_score = eg_score(eval_data.eval[WHITE_TURN] - eval_data.eval[BLACK_TURN]);
     // printf("after bishops: mg_score %d  eg_score %d \n", print_mg_score, print_eg_score);
 
     eval_rooks(pos, &eval_data, WHITE);
     eval_rooks(pos, &eval_data, BLACK);
 
-    // print_mg_score = eval_data.eval[PHASE_MG][WHITE_TURN] - eval_data.eval[PHASE_MG][BLACK_TURN];
-    // print_eg_score = eval_data.eval[PHASE_EG][WHITE_TURN] - eval_data.eval[PHASE_EG][BLACK_TURN];
+    // print_mg_score = mg_score(eval_data.eval[WHITE_TURN] - eval_data.eval[BLACK_TURN]);
+    // print_eg_score = eg_score(eval_data.eval[WHITE_TURN] - eval_data.eval[BLACK_TURN]);
     // printf("after rooks: mg_score %d  eg_score %d \n", print_mg_score, print_eg_score);
 
     eval_queens(pos, &eval_data, WHITE);
     eval_queens(pos, &eval_data, BLACK);
 
-    // print_mg_score = eval_data.eval[PHASE_MG][WHITE_TURN] - eval_data.eval[PHASE_MG][BLACK_TURN];
-    // print_eg_score = eval_data.eval[PHASE_EG][WHITE_TURN] - eval_data.eval[PHASE_EG][BLACK_TURN];
+    // print_mg_score = mg_score(eval_data.eval[WHITE_TURN] - eval_data.eval[BLACK_TURN]);
+    // print_eg_score = eg_score(eval_data.eval[WHITE_TURN] - eval_data.eval[BLACK_TURN]);
     // printf("after queens: mg_score %d  eg_score %d \n", print_mg_score, print_eg_score);
 
     eval_kings(pos, &eval_data, WHITE);
     eval_kings(pos, &eval_data, BLACK);
 
     /* Interpolate the evaluation based on the calculated game phase */
-    i32 mg_score = eval_data.eval[PHASE_MG][WHITE_TURN] - eval_data.eval[PHASE_MG][BLACK_TURN];
-    i32 eg_score = eval_data.eval[PHASE_EG][WHITE_TURN] - eval_data.eval[PHASE_EG][BLACK_TURN];
+    Score score = eval_data.eval[WHITE_TURN] - eval_data.eval[BLACK_TURN];
+    i32 mg = mg_score(score);
+    i32 eg = eg_score(score);
+    eg = eg * material->scale[eg > 0 ? WHITE : BLACK] / SCALE_NORMAL;
 
     i32 mg_weight = MIN(eval_data.phase_value, TOTAL_PHASE_VALUE);
     i32 eg_weight = TOTAL_PHASE_VALUE - mg_weight;
-    eval += ((mg_score * mg_weight) + (eg_score * eg_weight)) / TOTAL_PHASE_VALUE;
+    eval += ((mg * mg_weight) + (eg * eg_weight)) / TOTAL_PHASE_VALUE;
 
-    //printf("at the end: mg_score %d mg_weight %d eg_score %d eg_weight %d\n", mg_score, mg_weight, eg_score, eg_weight);
+    //printf("at the end: mg_score %d mg_weight %d eg_score %d eg_weight %d\n", mg, mg_weight, eg, eg_weight);
     
     return turn ? eval : -eval;
-}
\ No newline at end of file
+}
+
+/*
+ * Evaluates the thread's position through its eval cache, the entry is
+ * keyed by the full hash so a hit is the eval of the same position
+ */
+i32 eval_cached(ThreadData* td){
+    Position* pos = &td->pos;
+    if(!td->eval_table) return eval_position(pos, td->pawn_table, td->material_table);
+
+    EvalEntry* entry = &td->eval_table->entry[pos->hash & EVAL_TABLE_MASK];
+    if(entry->key != pos->hash){
+        entry->key  = pos->hash;
+        entry->eval = eval_position(pos, td->pawn_table, td->material_table);
+    }
+    #ifdef DEBUG
+    else if(entry->eval != eval_position(pos, td->pawn_table, td->material_table)){
+        printf("Eval cache entry does not match the eval of the position!\n");
+        printPosition(*pos, TRUE);
+        fflush(stdout);
+        while(1);
+    }
+    #endif
+    return entry->eval;
+}
+
+/*
+ * Fills the eval cache with an eval already known for the thread's position,
+ * such as the static eval of a TT entry, so eval_cached does not recompute it
+ */
+void eval_cache_store(ThreadData* td, i32 eval){
+    if(!td->eval_table) return;
+    EvalEntry* entry = &td->eval_table->entry[td->pos.hash & EVAL_TABLE_MASK];
+    entry->key  = td->pos.hash;
+    entry->eval = eval;
+}
@@ -10,19 +10,69 @@ enum Phase{
     MINOR_PHASE = 1,
     ROOK_PHASE  = 2,
     QUEEN_PHASE = 4,
-    TOTAL_PHASE_VALUE = 24
+    TOTAL_PHASE_VALUE = 24,
+
+    // Endgame scale factors, out of SCALE_NORMAL
+    SCALE_NORMAL      = 64,
+    SCALE_DRAWISH     = 14, // No pawns and at most a minor piece up
+    SCALE_HARD_TO_WIN = 4,  // As above against at most a minor piece
+    SCALE_NO_WIN      = 0,  // No pawns and less than a rook
+};
+
+typedef enum {
+    MATERIAL_DRAW = 0x01, // Insufficient material for either side to mate
+} MaterialFlag;
+
+#define PAWN_TABLE_ENTRIES (1 << 14) // Entries in each search thread's pawn hash table, a power of two
+
+// Pawn structure of a position, only depends on where the pawns are
+typedef struct {
+    u64 key;          // Pawn hash of the position
+    Score score;      // Pawn structure score of white minus black
+    u64 attacks[2];   // Squares attacked by each side's pawns
+    u64 passed[2];    // Pawns given PassedPawnBonus, see eval_pawn_structure
+    u8 light_count[2];
+    u8 dark_count[2];
+} PawnEntry;
+
+struct PawnTable{
+    PawnEntry entry[PAWN_TABLE_ENTRIES];
+};
+
+#define MATERIAL_TABLE_BITS 13 // Each search thread's material table holds 1 << MATERIAL_TABLE_BITS entries
+
+// Terms which only depend on the count of each piece
+typedef struct {
+    u64 key;         // Material key of the position
+    Score imbalance; // Knight and rook values adjusted for the pawns left, white minus black
+    u8 flags;        // MaterialFlag
+    u8 scale[2];     // Scale of the endgame score when it favours each side
+} MaterialEntry;
+
+struct MaterialTable{
+    MaterialEntry entry[1 << MATERIAL_TABLE_BITS];
+};
+
+#define EVAL_TABLE_BITS 14 // Each search thread's eval cache holds 1 << EVAL_TABLE_BITS entries
+#define EVAL_TABLE_MASK ((1 << EVAL_TABLE_BITS) - 1)
+
+// Static eval of a position from the side to move's view
+typedef struct {
+    u64 key; // Hash of the position
+    i32 eval;
+} EvalEntry;
+
+struct EvalTable{
+    EvalEntry entry[1 << EVAL_TABLE_BITS];
 };
 
 struct EvalData{
-    i32 eval[2][2];
+    Score eval[2]; // Packed score of each side
 
     i32 phase_value;
 
-    u32 pawn_count[2];
-    u32 light_pawn_count[2];
-    u32 dark_pawn_count[2];
+    const PawnEntry* pawns;
 
-    u64 pawn_attacks[2];
     u64 knight_attacks[2];
     u64 bishop_attacks[2];
     u64 rook_attacks[2];
@@ -33,10 +83,46 @@ struct EvalData{
     u64 attack_units[2];
 };
 
-// Evaluation functions for a single position
-i32 eval_position(Position* pos);
+/*
+ * Start loading the eval cache and pawn table entries of a child position,
+ * issued by make_move next to the TT prefetch
+ */
+static inline void eval_table_prefetch(const EvalTable* eval_table, u64 hash){
+#if defined(__GNUC__) || defined(__clang__)
+    if(eval_table) __builtin_prefetch(&eval_table->entry[hash & EVAL_TABLE_MASK]);
+#else
+    (void)eval_table; (void)hash;
+#endif
+}
+
+static inline void pawn_table_prefetch(const PawnTable* pawn_table, u64 pawn_hash){
+#if defined(__GNUC__) || defined(__clang__)
+    if(pawn_table) __builtin_prefetch(&pawn_table->entry[pawn_hash & (PAWN_TABLE_ENTRIES - 1)]);
+#else
+    (void)pawn_table; (void)pawn_hash;
+#endif
+}
+
+// Evaluation functions for a single position, the tables may be NULL
+i32 eval_position(Position* pos, PawnTable* pawn_table, MaterialTable* material_table);
+
+// Static eval of the thread's position, from its eval cache when that holds it
+i32 eval_cached(ThreadData* td);
+void eval_cache_store(ThreadData* td, i32 eval);
+
+// Pawn, material and eval tables, one of each per search thread
+PawnTable* pawn_table_alloc(void);
+void pawn_table_free(PawnTable* pawn_table);
+MaterialTable* material_table_alloc(void);
+void material_table_free(MaterialTable* material_table);
+EvalTable* eval_table_alloc(void);
+void eval_table_free(EvalTable* eval_table);
+
+// Material and game phase value of each piece, the deltas make and unmake move apply
+extern const i32 PieceValues[PIECE_COUNT];
+extern const i32 PiecePhases[PIECE_COUNT];
 
-// Quickly evaluate a position based on the material
-i32 eval_material(Position* pos);
+// Computes the material, PST and phase accumulators of a position from scratch
+void init_eval_accumulators(Position* pos);
 
 
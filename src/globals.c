@@ -11,9 +11,10 @@ _Atomic volatile i32 run_program;
 _Atomic volatile i32 run_get_best_move;
 _Atomic volatile i32 best_move_found;
 
-// Signals
-_Atomic volatile i32 print_pv_info;
-_Atomic volatile i32 print_best_move;
+// Output events waiting for the output thread
+static OutputEvent pending_output = OUTPUT_NONE;
+static pthread_mutex_t mutex_output = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  cond_output  = PTHREAD_COND_INITIALIZER;
 
 // Global Thread Data
 static ThreadData global_td;
@@ -24,6 +25,38 @@ static SearchData global_sd;
 static pthread_mutex_t mutex_global_td = PTHREAD_MUTEX_INITIALIZER;
 static pthread_mutex_t mutex_global_PV = PTHREAD_MUTEX_INITIALIZER;
 
+/*
+ * Queues an event for the output thread and wakes it,
+ * repeated events coalesce so only the latest PV gets printed
+ */
+void post_output_event(OutputEvent event){
+    pthread_mutex_lock(&mutex_output);
+    pending_output |= event;
+    pthread_cond_signal(&cond_output);
+    pthread_mutex_unlock(&mutex_output);
+}
+
+/*
+ * Drops queued events that are no longer valid
+ */
+void clear_output_event(OutputEvent event){
+    pthread_mutex_lock(&mutex_output);
+    pending_output &= ~event;
+    pthread_mutex_unlock(&mutex_output);
+}
+
+/*
+ * Blocks the output thread until an event is posted, returns and clears the pending events
+ */
+OutputEvent wait_output_events(){
+    pthread_mutex_lock(&mutex_output);
+    while(pending_output == OUTPUT_NONE) pthread_cond_wait(&cond_output, &mutex_output);
+    OutputEvent events = pending_output;
+    pending_output = OUTPUT_NONE;
+    pthread_mutex_unlock(&mutex_output);
+    return events;
+}
+
 /*
  * Sets up Initial Global Data Values
  */
@@ -31,8 +64,7 @@ void init_globals(){
     run_program = TRUE;
     run_get_best_move = FALSE;
     best_move_found = FALSE;
-    print_pv_info = FALSE;
-    print_best_move = FALSE;
+    clear_output_event(OUTPUT_PV_INFO | OUTPUT_BEST_MOVE);
 
     pthread_mutex_lock(&mutex_global_td);
     memset(&global_td, 0, sizeof(ThreadData));
@@ -66,7 +98,7 @@ void free_globals(){
  */
 static void reset_global_pv_data(){
     best_move_found = FALSE;
-    print_pv_info = FALSE;
+    clear_output_event(OUTPUT_PV_INFO);
     pthread_mutex_lock(&mutex_global_PV);
     global_sd.depth = 0;
     global_sd.best_move = NO_MOVE;
@@ -77,6 +109,8 @@ static void reset_global_pv_data(){
 
 /*
  * Checks and sees if the Global PV can be updated, and if it can it updates it
+ * A deeper result always wins, at the same depth the higher score wins so the
+ * best of the threads' results is kept
  * Returns true if an update happen, false if an update did not happen
  */
 u8 update_global_pv(u32 depth, Move* pv_array, i32 eval, SearchStats stats){
@@ -84,7 +118,7 @@ u8 update_global_pv(u32 depth, Move* pv_array, i32 eval, SearchStats stats){
 
     pthread_mutex_lock(&mutex_global_PV); // Start Crit Section
 
-    if(depth <= global_sd.depth){ // If new depth is less or same as current exit
+    if(depth < global_sd.depth || (depth == global_sd.depth && eval <= global_sd.eval)){ // If new result is not better exit
         pthread_mutex_unlock(&mutex_global_PV);
         return FALSE;
     }
@@ -98,10 +132,20 @@ u8 update_global_pv(u32 depth, Move* pv_array, i32 eval, SearchStats stats){
     pthread_mutex_unlock(&mutex_global_PV);
 
     best_move_found = TRUE; // Set flag that best move has been found
-    print_pv_info = TRUE;   // Set flag to print new PV
+    post_output_event(OUTPUT_PV_INFO); // Wake the output thread to print the new PV
     return TRUE;
 }
 
+/*
+ * Returns the depth of the Global PV
+ */
+u32 get_global_depth() {
+    pthread_mutex_lock(&mutex_global_PV);
+    u32 depth = global_sd.depth;
+    pthread_mutex_unlock(&mutex_global_PV);
+    return depth;
+}
+
 /*
  * Returns the Global Best Move
  */
@@ -157,9 +201,9 @@ ThreadData copy_global_td(){
 
 
 /*
- * Returns the Global PV Data (ALLOCATES MEMORY IN RETURNED PV ARRAY)
+ * Returns the Global PV Data, the PV is copied into the supplied array of MAX_DEPTH moves
  */
-SearchData get_global_pv_data(){
+SearchData get_global_pv_data(Move *pv_array){
     SearchData data;
 
     pthread_mutex_lock(&mutex_global_PV); // Start Crit Section
@@ -168,10 +212,8 @@ SearchData get_global_pv_data(){
     data.eval = global_sd.eval;
     data.stats = global_sd.stats;
     data.best_move = global_sd.best_move;
-    data.pv_array = malloc(MAX_DEPTH*sizeof(Move));
-    if(data.pv_array){
-        memcpy(data.pv_array, global_sd.pv_array, (MAX_DEPTH)*sizeof(Move));
-    }
+    data.pv_array = pv_array;
+    memcpy(data.pv_array, global_sd.pv_array, (MAX_DEPTH)*sizeof(Move));
 
     pthread_mutex_unlock(&mutex_global_PV);
 
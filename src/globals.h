@@ -9,9 +9,17 @@ extern _Atomic volatile i32 run_program;
 extern _Atomic volatile i32 run_get_best_move;
 extern _Atomic volatile i32 best_move_found;
 
-//Print Signals
-extern _Atomic volatile i32 print_pv_info;
-extern _Atomic volatile i32 print_best_move;
+//Output Events
+typedef enum {
+    OUTPUT_NONE      = 0,
+    OUTPUT_PV_INFO   = 1 << 0, // Print the info line for the global PV
+    OUTPUT_BEST_MOVE = 1 << 1, // Print the global best move
+    OUTPUT_QUIT      = 1 << 2, // Output thread should exit
+} OutputEvent;
+
+void post_output_event(OutputEvent event);
+void clear_output_event(OutputEvent event);
+OutputEvent wait_output_events();
 
 void init_globals();
 void free_globals();
@@ -24,8 +32,9 @@ Position copy_global_position();
 void set_global_td(ThreadData td);
 ThreadData copy_global_td();
 
+u32 get_global_depth();
 Move get_global_best_move();
 
-SearchData get_global_pv_data();
+SearchData get_global_pv_data(Move *pv_array);
 
 #endif // GLOBALS_H
\ No newline at end of file
@@ -1,40 +1,49 @@
 #include "hash.h"
 #include "util.h"
-#include <time.h>
 #include <stdlib.h>
 
 #ifdef DEBUG
 #include <stdio.h>
 #endif
 
-static u64 zobristTable[64][12];
+#ifndef ZOBRIST_SEED
+#define ZOBRIST_SEED 0x5A0B1157C0FFEE01ULL // Build with another seed to check a result does not hinge on the keys
+#endif
+
+static u64 zobristTable[64][PIECE_COUNT];
 static u64 zobristEnPassant[8];
 static u64 zobristCastle[4];
 static u64 zobristTurn;
 
+/*
+ * SplitMix64 from a fixed seed, so the keys, and with them TT behaviour
+ * and search node counts, are the same on every run
+ */
+static u64 zobrist_random(u64 *state){
+    u64 z = (*state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
 void initZobrist(void) {
-    #ifdef __RAND_SEED
-    srand(__RAND_SEED);
-    #else
-    time_t t;
-    srand((unsigned) time(&t));
-    #endif
+    u64 state = ZOBRIST_SEED;
 
     for (i32 square = 0; square < 64; square++) {
         for (i32 piece = 0; piece < 12; piece++) {
-            zobristTable[square][piece] = random_uint64();
+            zobristTable[square][piece] = zobrist_random(&state);
         }
     }
 
     for(i32 i = 0; i < 8; i++){
-        zobristEnPassant[i] = random_uint64();
+        zobristEnPassant[i] = zobrist_random(&state);
     }
 
     for(i32 i = 0; i < 4; i++){
-        zobristCastle[i] = random_uint64();
+        zobristCastle[i] = zobrist_random(&state);
     }
 
-    zobristTurn = random_uint64();
+    zobristTurn = zobrist_random(&state);
 }
 
 #ifdef DEBUG
@@ -68,9 +77,8 @@ u64 hashPosition(Position *pos){
 
     //Hash the board
     for (i32 i = 0; i < 64; i++) { 
-        if (pos->charBoard[i] != 0) { 
-            i32 piece = pieceToIndex[(int)pos->charBoard[i]];
-            hash ^= zobristTable[i][piece];
+        if (pos->board[i] != NO_PIECE) { 
+            hash ^= zobristTable[i][pos->board[i]];
         }
     }
 
@@ -91,6 +99,21 @@ u64 hashPosition(Position *pos){
     return hash;
 }
 
+/**
+ * Hash of the pawns of both sides, the key of the pawn hash table
+ */
+u64 hashPawns(Position *pos){
+    u64 hash = 0;
+    for(i32 color = 0; color < 2; color++){
+        u64 pawns = pos->pawn[color];
+        while(pawns){
+            hash ^= zobristTable[getlsb(pawns)][PIECE_INDEX(PAWN, color)];
+            pawns &= pawns - 1;
+        }
+    }
+    return hash;
+}
+
 /**
  * Removes or adds a piece to/from the hash.
  */
@@ -121,4 +144,74 @@ u64 hash_update_castle(u64 hash, PositionFlag castle){
     if(castle == B_SHORT_CASTLE) hash ^= zobristCastle[2];
     if(castle == B_LONG_CASTLE)  hash ^= zobristCastle[3];
     return hash;
-}
\ No newline at end of file
+}
+
+/**
+ * Returns the hash of the position after the move without making it.
+ * Mirrors the hash updates in _make_move so the child's table entries
+ * can be prefetched before the move is made.
+ */
+u64 hash_after_move(Position *pos, Move move){
+    i32 turn  = pos->flags & WHITE_TURN;
+    i32 from  = GET_FROM(move);
+    i32 to    = GET_TO(move);
+    i32 flags = GET_FLAGS(move);
+    i32 piece = pos->board[from];
+    u64 hash  = pos->hash ^ zobristTurn;
+
+    if(pos->en_passant) hash ^= zobristEnPassant[getlsb(pos->en_passant) % 8];
+
+    if(flags == EP_CAPTURE) hash ^= zobristTable[turn ? to - 8 : to + 8][PIECE_INDEX(PAWN, !turn)];
+    else if(flags & CAPTURE) hash ^= zobristTable[to][pos->board[to]];
+
+    hash ^= zobristTable[from][piece];
+    if(flags & PROMOTION){
+        static const PieceType promo_type[4] = {KNIGHT, BISHOP, ROOK, QUEEN};
+        hash ^= zobristTable[to][PIECE_INDEX(promo_type[flags & 0x3], turn)];
+    }
+    else hash ^= zobristTable[to][piece];
+
+    if(flags == DOUBLE_PAWN_PUSH) hash ^= zobristEnPassant[to % 8];
+    else if(flags == KING_CASTLE || flags == QUEEN_CASTLE){
+        i32 rook = PIECE_INDEX(ROOK, turn);
+        i32 rook_from = flags == KING_CASTLE ? (turn ? 7 : 63) : (turn ? 0 : 56);
+        i32 rook_to   = flags == KING_CASTLE ? (turn ? 5 : 61) : (turn ? 3 : 59);
+        hash ^= zobristTable[rook_from][rook] ^ zobristTable[rook_to][rook];
+    }
+
+    // Castle rights lost by moving or capturing on a king or rook square
+    u8 lost = 0;
+    if(from == 4  || to == 0  || from == 0 ) lost |= W_LONG_CASTLE;
+    if(from == 4  || to == 7  || from == 7 ) lost |= W_SHORT_CASTLE;
+    if(from == 60 || to == 56 || from == 56) lost |= B_LONG_CASTLE;
+    if(from == 60 || to == 63 || from == 63) lost |= B_SHORT_CASTLE;
+    lost &= pos->flags;
+    if(lost & W_SHORT_CASTLE) hash ^= zobristCastle[0];
+    if(lost & W_LONG_CASTLE)  hash ^= zobristCastle[1];
+    if(lost & B_SHORT_CASTLE) hash ^= zobristCastle[2];
+    if(lost & B_LONG_CASTLE)  hash ^= zobristCastle[3];
+
+    return hash;
+}
+
+/**
+ * Returns the pawn hash of the position after the move without making it,
+ * only pawn moves and captures of pawns change it
+ */
+u64 pawn_hash_after_move(Position *pos, Move move){
+    i32 turn  = pos->flags & WHITE_TURN;
+    i32 from  = GET_FROM(move);
+    i32 to    = GET_TO(move);
+    i32 flags = GET_FLAGS(move);
+    i32 piece = pos->board[from];
+    u64 hash  = pos->pawn_hash;
+
+    if(flags == EP_CAPTURE) hash ^= zobristTable[turn ? to - 8 : to + 8][PIECE_INDEX(PAWN, !turn)];
+    else if((flags & CAPTURE) && PIECE_TYPE(pos->board[to]) == PAWN) hash ^= zobristTable[to][pos->board[to]];
+
+    if(PIECE_TYPE(piece) == PAWN){
+        hash ^= zobristTable[from][piece];
+        if(!(flags & PROMOTION)) hash ^= zobristTable[to][piece];
+    }
+    return hash;
+}
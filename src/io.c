@@ -3,14 +3,23 @@
 #include <stdio.h>
 #include <stdbool.h>
 #include <string.h>
+#include <strings.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
+#include <unistd.h>
+#include <errno.h>
 #include "types.h"
 #include "util.h"
 #include "globals.h"
 #include "movement.h"
+#include "perft.h"
+#include "bench.h"
 #include "search.h"
+#include "threads.h"
+#include "transposition.h"
+#include "timeman.h"
+#include "tables.h"
 
 #ifdef DEBUG
 #include "evaluator.h"
@@ -37,6 +46,10 @@ static char* trimWhitespace(char* str) {
 static void processUCI(void) {
     printf("id name CraigEngine\r\n");
     printf("id author John\r\n");
+    printf("option name Hash type spin default %d min %d max %d\r\n", TT_DEFAULT_SIZE_MB, TT_MIN_SIZE_MB, TT_MAX_SIZE_MB);
+    printf("option name Clear Hash type button\r\n");
+    printf("option name Threads type spin default %d min 1 max %d\r\n", DEFAULT_THREADS, MAX_THREADS);
+    printf("option name Move Overhead type spin default %d min 0 max %d\r\n", DEFAULT_MOVE_OVERHEAD, MAX_MOVE_OVERHEAD);
     printf("uciok\r\n");
 }
 
@@ -64,99 +77,136 @@ get_next_token:
     }
 }
 
+/*
+ * Handles "setoption name <id> value <x>"
+ * The search is stopped and joined first since options may resize shared state
+ */
+static void processSetOption(char* input) {
+    char* name = strstr(input, "name ");
+    char* value = strstr(input, " value ");
+    if(name == NULL) return;
+    name += 5;
+    if(value != NULL){
+        *value = '\0';
+        value = trimWhitespace(value + 7);
+    }
+    name = trimWhitespace(name);
+
+    stopSearch();
+    wait_search_threads();
+
+    if (strcasecmp(name, "Hash") == 0 && value != NULL) {
+        if(init_tt(atoi(value))){
+            printf("info string Warning failed to resize transposition table, keeping %d MB\n", tt_size_mb());
+        }
+    }
+    else if (strcasecmp(name, "Threads") == 0 && value != NULL) {
+        set_search_thread_count(atoi(value));
+    }
+    else if (strcasecmp(name, "Move Overhead") == 0 && value != NULL) {
+        tm_set_move_overhead(atoi(value));
+    }
+    else if (strcasecmp(name, "Clear Hash") == 0) {
+        tt_clear();
+    }
+    else {
+        printf("info string Unknown option %s\n", name);
+    }
+}
+
 void processGoCommand(char* input) {
     char* token;
     char* saveptr;
-    u32 wtime = 0; // Initialize with default values
-    u32 winc = 0;
-    u32 btime = 0;
-    u32 binc = 0;
-    u32 movetime = 0;
-    u32 movestogo = 0;
-    u8 infinite = FALSE;
 
-    SearchParameters params;
+    SearchParameters params = {0};
     params.depth = MAX_DEPTH - 1;
 
     token = strtok_r(input, " ", &saveptr);
-    if(token == NULL) infinite = TRUE; // If the user only said "go" then we want to run infinite
+    if(token == NULL) params.infinite = TRUE; // If the user only said "go" then we want to run infinite
     while (token != NULL) {
         if (strncmp(token, "infinite", 8) == 0) {
-            infinite = TRUE;
+            params.infinite = TRUE;
             break;
         } else if (strcmp(token, "wtime") == 0) {
             token = strtok_r(NULL, " ", &saveptr);
             if (token != NULL) {
-                wtime = atol(token);
+                params.time[WHITE] = atol(token);
             }
         } else if (strcmp(token, "winc") == 0) {
             token = strtok_r(NULL, " ", &saveptr);
             if (token != NULL) {
-                winc = atol(token);
+                params.inc[WHITE] = atol(token);
             }
         } else if (strcmp(token, "btime") == 0) {
             token = strtok_r(NULL, " ", &saveptr);
             if (token != NULL) {
-                btime = atol(token);
+                params.time[BLACK] = atol(token);
             }
         } else if (strcmp(token, "binc") == 0) {
             token = strtok_r(NULL, " ", &saveptr);
             if (token != NULL) {
-                binc = atol(token);
+                params.inc[BLACK] = atol(token);
             }
         } else if (strcmp(token, "movetime") == 0) {
             token = strtok_r(NULL, " ", &saveptr);
             if (token != NULL) {
-                movetime = atol(token);
+                params.movetime = atol(token);
             }
         } else if (strcmp(token, "movestogo") == 0) {
             token = strtok_r(NULL, " ", &saveptr);
             if (token != NULL) {
-                movestogo = atol(token);
+                params.movestogo = atol(token);
             }
         }else if (strcmp(token, "depth") == 0) {
             token = strtok_r(NULL, " ", &saveptr);
             if (token != NULL) {
                 params.depth = atol(token);
             }
+        }else if (strcmp(token, "nodes") == 0) {
+            token = strtok_r(NULL, " ", &saveptr);
+            if (token != NULL) {
+                params.nodes = strtoull(token, NULL, 10);
+            }
         }else if (strcmp(token, "perft") == 0) {
             token = strtok_r(NULL, " ", &saveptr);
             if (token != NULL) {
-                ThreadData temp_td = {0};
-                temp_td.pos = copy_global_position();
-                perft(&temp_td, atol(token), TRUE);
+                perft_run(copy_global_position(), atol(token), get_search_thread_count(), TRUE);
             }
             return;
         } else if (strncmp(token, "perft", 5) == 0) {
-            ThreadData temp_td = {0};
-            temp_td.pos = copy_global_position();
-            perft(&temp_td, MAX_DEPTH, TRUE);
+            perft_run(copy_global_position(), MAX_DEPTH, get_search_thread_count(), TRUE);
             return;
         }
         token = strtok_r(NULL, " ", &saveptr);
     }
 
-    if(movetime != 0){
-        params.max_time = movetime;
-        params.rec_time = movetime;
-        params.can_shorten = FALSE;
-    } else if(infinite == TRUE){
-        params.rec_time = 0;
-        params.max_time = 0;
-        params.can_shorten = FALSE;
-    } else{ 
-        params.max_time = calculate_max_search_time(wtime, winc, btime, binc, movestogo, copy_global_position().flags & WHITE_TURN);
-        params.rec_time = calculate_rec_search_time(wtime, winc, btime, binc, movestogo, copy_global_position().flags & WHITE_TURN);
-        params.can_shorten = TRUE;
-    }
-    
     start_search(params);
 }
 
+/*
+ * Handles "bench [depth] [threads] [hash]", missing values use the defaults
+ */
+static void processBench(char* args){
+    i32 values[3] = {BENCH_DEPTH, BENCH_THREADS, BENCH_HASH_MB};
+    char* saveptr;
+    char* token = strtok_r(args, " \r\n", &saveptr);
+    for(i32 i = 0; i < 3 && token != NULL; i++){
+        values[i] = atoi(token);
+        token = strtok_r(NULL, " \r\n", &saveptr);
+    }
+    bench(values[0], values[1], values[2]);
+}
+
 static i32 processInput(char* input){
     if (strncmp(input, "uci", 3) == 0) {
         input += 3;
-        if(strncmp(input, "newgame", 7) == 0) return 0;
+        if(strncmp(input, "newgame", 7) == 0){
+            stopSearch();
+            wait_search_threads();
+            tt_clear();
+            clearHistory(); // So a game's searches do not depend on the games before it
+            return 0;
+        }
         processUCI();
         fflush(stdout);
         return 0;
@@ -186,6 +236,10 @@ static i32 processInput(char* input){
         }
         fflush(stdout);
     }
+    else if (strncmp(input, "setoption", 9) == 0) {
+        processSetOption(input + 9);
+        fflush(stdout);
+    }
     else if (strncmp(input, "go", 2) == 0) {
         processGoCommand(input + 3);
     }
@@ -194,13 +248,20 @@ static i32 processInput(char* input){
         printf("info string Stopping\n");
         #endif
         stopSearch();
-        print_best_move = TRUE;
+        report_best_move();
+    }
+    else if (strncmp(input, "stats", 5) == 0){
+        report_search_stats();
+    }
+    else if (strncmp(input, "bench", 5) == 0){
+        processBench(input + 5);
     }
     else if (strncmp(input, "quit", 4) == 0){
         printf("info string Closing Engine\n");
         fflush(stdout);
         stopSearch();
         run_program = FALSE;
+        post_output_event(OUTPUT_QUIT);
         return 0;
     }
     #ifdef DEBUG
@@ -226,7 +287,7 @@ static i32 processInput(char* input){
         }
         else if (strncmp(input, "eval", 4) == 0){
             Position tempPos = copy_global_position();
-            printf("Eval: %d\n", eval_position(&tempPos));
+            printf("Eval: %d\n", eval_position(&tempPos, NULL, NULL));
         }
         else if (strncmp(input, "play move", 4) == 0){
             printf("Making move: ");
@@ -242,6 +303,43 @@ static i32 processInput(char* input){
     return 0;
 }
 
+/*
+ * Runs a command given on the command line instead of starting the UCI loop
+ *   perft <depth> [threads] [fen]  Threads defaults to the online cores, fen to the start position
+ *   bench [depth] [threads] [hash]
+ * Returns the exit code for main
+ */
+i32 processCommandLine(i32 argc, char** argv){
+    if(strcmp(argv[0], "bench") == 0){
+        bench(argc > 1 ? atoi(argv[1]) : BENCH_DEPTH,
+              argc > 2 ? atoi(argv[2]) : BENCH_THREADS,
+              argc > 3 ? atoi(argv[3]) : BENCH_HASH_MB);
+        return 0;
+    }
+    if(argc >= 2 && strcmp(argv[0], "perft") == 0){
+        i32 depth = atoi(argv[1]);
+        i32 threads = cpu_count();
+        i32 arg = 2;
+        if(arg < argc && strspn(argv[arg], "0123456789") == strlen(argv[arg])){
+            threads = atoi(argv[arg++]);
+        }
+
+        char fen[256] = START_FEN;
+        if(arg < argc){
+            fen[0] = '\0';
+            for(; arg < argc; arg++){
+                strncat(fen, argv[arg], sizeof(fen) - strlen(fen) - 2);
+                strcat(fen, " ");
+            }
+        }
+        perft_run(fen_to_position(fen), depth, MAX(1, MIN(threads, MAX_THREADS)), TRUE);
+        return 0;
+    }
+
+    printf("Usage: craig.engine [perft <depth> [threads] [fen] | bench [depth] [threads] [hash]]\n");
+    return 1;
+}
+
 i32 inputLoop(){
     char input[4096];
     input[4095] = '\0';
@@ -254,25 +352,70 @@ i32 inputLoop(){
             break;
         }
     }
+    run_program = FALSE;
+    post_output_event(OUTPUT_QUIT); // Also wake the output thread when stdin closes
     return 0;
 }
 
+/*
+ * Writes the whole message to stdout with as few write calls as possible
+ * Lines other threads printed through stdio are flushed first so they stay in order
+ */
+static void writeOutput(const char *buf, i32 len){
+    fflush(stdout);
+    while(len > 0){
+        ssize_t written = write(STDOUT_FILENO, buf, len);
+        if(written < 0){
+            if(errno == EINTR) continue;
+            return;
+        }
+        buf += written;
+        len -= written;
+    }
+}
+
+/*
+ * Hash of the score and the moves of a PV, as far as formatPVInfo prints them
+ */
+static u64 pv_info_hash(SearchData data){
+    u64 hash = 0xCBF29CE484222325ULL ^ (u32)data.eval;
+    for(u32 i = 0; i < data.depth && i < MAX_DEPTH; i++){
+        hash = (hash ^ data.pv_array[i]) * 0x100000001B3ULL;
+    }
+    return hash;
+}
+
+/*
+ * Sleeps until the search posts an event, then formats and writes it
+ * Each thread that improves the global PV wakes this loop, a line that
+ * repeats the last printed depth and PV is skipped
+ */
 i32 outputLoop(){
-    while(run_program){
-        if(print_pv_info){
-            SearchData data = get_global_pv_data();
-            printPVInfo(data);
-            print_pv_info = FALSE;
-            free(data.pv_array);
+    char buffer[OUTPUT_BUFFER_SIZE];
+    Move pv_array[MAX_DEPTH];
+    u32 last_depth = 0;
+    u64 last_pv_hash = 0;
+
+    while(TRUE){
+        OutputEvent events = wait_output_events();
+        if(events & OUTPUT_PV_INFO){
+            SearchData data = get_global_pv_data(pv_array);
+            u64 pv_hash = pv_info_hash(data);
+            if(data.depth != last_depth || pv_hash != last_pv_hash){
+                writeOutput(buffer, formatPVInfo(buffer, sizeof(buffer), data));
+                last_depth = data.depth;
+                last_pv_hash = pv_hash;
+            }
         }
-        if(print_best_move){
+        if(events & OUTPUT_BEST_MOVE){
+            last_depth = 0; // The next search starts over
             Move move = get_global_best_move();
-            if(move != NO_MOVE) printBestMove(move);
+            if(move != NO_MOVE) writeOutput(buffer, formatBestMove(buffer, sizeof(buffer), move));
             #ifdef DEBUG
             else printf("NO BEST MOVE FOUND!");
             #endif
-            print_best_move = FALSE;
         }
+        if(events & OUTPUT_QUIT) break;
     }
     return 0;
-}
\ No newline at end of file
+}
@@ -3,4 +3,5 @@
 #include "types.h"
 i32 inputLoop();
 i32 outputLoop();
+i32 processCommandLine(i32 argc, char** argv);
 #endif
\ No newline at end of file
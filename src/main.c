@@ -14,6 +14,7 @@
 #include "tree.h"
 #include "util.h"
 #include "masks.h"
+#include "io.h"
 
 #ifdef RUN_TEST
 #include "tests/bbtests.h"
@@ -22,16 +23,14 @@
 /*
 * Behold the main function
 */
-i32 main(void) {
-    generateMasks();
-    generateMagics();
+i32 main(i32 argc, char** argv) {
+    selectSliderBackend();
     initZobrist();
 
-    if(init_tt(2)){
+    if(init_tt(TT_DEFAULT_SIZE_MB)){
         printf("info string Warning failed to create transposition table, exiting.\n");
         return -1;
     }
-    init_masks();
     init_globals();
 
     printf("info string Finished start up!\n");
@@ -52,8 +51,17 @@ i32 main(void) {
     debug_print_search = 1;
     #endif
 
+    if(argc > 1){
+        i32 result = processCommandLine(argc - 1, argv + 1);
+        stop_thread_pool();
+        free_globals();
+        tt_free();
+        return result;
+    }
+
     launch_threads();
     stopSearch();
+    stop_thread_pool();
     printf("info string All threads have finished.\n");
     free_globals();
     tt_free();
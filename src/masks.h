@@ -2,13 +2,11 @@
 
 #include "types.h"
 
-extern u64 PassedPawnMask[2][64];
+// Generated by tools/gentables.c into bitboard/tables_gen.c
+extern const u64 PassedPawnMask[2][64];
 
-extern u64 KnightOutpostMask[2];
+extern const u64 KingAreaMask[64];
 
-extern u64 KingAreaMask[64];
-
-extern u64 BishopOutpostMask[2];
-
-void init_masks();
+extern const u64 KnightOutpostMask[2];
 
+extern const u64 BishopOutpostMask[2];
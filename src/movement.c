@@ -1,18 +1,22 @@
 #include "movement.h"
-#include <ctype.h>
 #include "./bitboard/magic.h"
 #include "./bitboard/bitboard.h"
 #include "./bitboard/bbutils.h"
 #include "evaluator.h"
 #include "util.h"
 #include "hash.h"
-
-u16 generateLegalMoves(Position* position,  Move* moveList){
+#include "transposition.h"
+#include "params.h"
+
+/*
+ * Move generation for one color, turn is a constant so only one copy of each
+ * branch is compiled into each instantiation
+ */
+FORCE_INLINE u16 generate_legal_moves(Position* position, Move* moveList, const i32 turn){
     i32 size[] = {0};
-    i32 turn = position->flags & WHITE_TURN; //True for white false for black
     u64 ownPos = position->color[turn];
     u64 oppPos = position->color[!turn];
-    u64 oppAttackMask = position->attack_mask[!turn];
+    u64 oppAttackMask = get_attack_mask(position, !turn);
 
     if(position->flags & IN_CHECK){
         if(position->flags & IN_D_CHECK){
@@ -22,11 +26,11 @@ u16 generateLegalMoves(Position* position,  Move* moveList){
             getCheckMovesAppend(position, moveList, size);
         }
     }
-    else if(position->pinned & ownPos){
+    else if(get_pinned(position) & ownPos){
         getPinnedMovesAppend(position, moveList, size);
     }
     else{
-        getCastleMovesAppend(ownPos | oppPos, oppAttackMask, position->flags, moveList, size);
+        castleMovesAppend(ownPos | oppPos, oppAttackMask, position->flags, moveList, size, turn);
 
         getBishopMovesAppend(position->queen[turn],  ownPos, oppPos, moveList, size);
         getRookMovesAppend(  position->queen[turn],  ownPos, oppPos, moveList, size);
@@ -34,18 +38,22 @@ u16 generateLegalMoves(Position* position,  Move* moveList){
         getBishopMovesAppend(position->bishop[turn], ownPos, oppPos, moveList, size);
         getKnightMovesAppend(position->knight[turn], ownPos, oppPos, moveList, size);
         getKingMovesAppend(  position->king[turn],   ownPos, oppPos, oppAttackMask, moveList, size);
-        getPawnMovesAppend(  position->pawn[turn],   ownPos, oppPos, position->en_passant, position->flags, moveList, size);
+        pawnMovesAppend(     position->pawn[turn],   ownPos, oppPos, position->en_passant, ~0ULL, moveList, size, turn);
     }
     return *size;
 }
 
+u16 generateLegalMoves(Position* position,  Move* moveList){
+    if(position->flags & WHITE_TURN) return generate_legal_moves(position, moveList, WHITE);
+    return generate_legal_moves(position, moveList, BLACK);
+}
+
 /* Generate Moves that capture pieces, and put the opponents king in check */
-u16 generateThreatMoves(Position* position,  Move* moveList){
+FORCE_INLINE u16 generate_threat_moves(Position* position, Move* moveList, const i32 turn){
     i32 size[] = {0};
-    i32 turn = position->flags & TURN_MASK;
     u64 ownPos = position->color[turn];
     u64 oppPos = position->color[!turn];
-    u64 oppAttackMask = position->attack_mask[!turn];
+    u64 oppAttackMask = get_attack_mask(position, !turn);
 
     i32 kingSq = getlsb(position->king[!turn]);
     u64 r_check_squares = rookAttacks(  ownPos | oppPos, kingSq) & ~(ownPos | oppPos);
@@ -59,7 +67,7 @@ u16 generateThreatMoves(Position* position,  Move* moveList){
             getCheckMovesAppend(position, moveList, size);
         }
     }
-    else if(position->pinned & ownPos){
+    else if(get_pinned(position) & ownPos){
         getPinnedThreatMovesAppend(position, r_check_squares, b_check_squares, kingSq, moveList, size);
     }
     else{
@@ -69,317 +77,280 @@ u16 generateThreatMoves(Position* position,  Move* moveList){
         getBishopThreatMovesAppend(position->bishop[turn], ownPos, oppPos, b_check_squares, moveList, size);
         getKnightThreatMovesAppend(position->knight[turn], ownPos, oppPos, kingSq, moveList, size);
         getKingThreatMovesAppend(  position->king[turn],   ownPos, oppPos, oppAttackMask, moveList, size);
-        getPawnThreatMovesAppend(  position->pawn[turn],   ownPos, oppPos, position->en_passant, position->flags, kingSq, moveList, size);
+        pawnMovesAppend(           position->pawn[turn],   ownPos, oppPos, position->en_passant, pawnAttacksSet(position->king[!turn], !turn), moveList, size, turn);
     }
     return *size;
 }
 
+u16 generateThreatMoves(Position* position,  Move* moveList){
+    if(position->flags & WHITE_TURN) return generate_threat_moves(position, moveList, WHITE);
+    return generate_threat_moves(position, moveList, BLACK);
+}
 
-static void movePiece(Position *pos, i32 turn, i32 from, i32 to){
-    pos->hash = hash_update_piece(pos->hash, from, pieceToIndex[(int)pos->charBoard[from]]);
-    pos->hash = hash_update_piece(pos->hash, to, pieceToIndex[(int)pos->charBoard[from]]);
-
-    switch(toupper(pos->charBoard[from])){
-        case 'Q':
-            pos->queen[turn] = clearBit(pos->queen[turn], from);
-            pos->queen[turn] = setBit(pos->queen[turn], to);
-            break;
-        case 'K':
-            pos->king[turn] = clearBit(pos->king[turn], from);
-            pos->king[turn] = setBit(pos->king[turn], to);
-            break;
-        case 'N':
-            pos->knight[turn] = clearBit(pos->knight[turn], from);
-            pos->knight[turn] = setBit(pos->knight[turn], to);
-            break;
-        case 'B':
-            pos->bishop[turn] = clearBit(pos->bishop[turn], from);
-            pos->bishop[turn] = setBit(pos->bishop[turn], to);
-            break;
-        case 'R':
-            pos->rook[turn] = clearBit(pos->rook[turn], from);
-            pos->rook[turn] = setBit(pos->rook[turn], to);
-            break;
-        case 'P':
-            pos->pawn[turn] = clearBit(pos->pawn[turn], from);
-            pos->pawn[turn] = setBit(pos->pawn[turn], to);
-            pos->halfmove_clock = 0;
-            break;
-    }
+/*
+ * Split generation for the move picker, captures and promotions first and the rest once they
+ * run out. Only valid out of check with no pinned pieces, positions with either use generateLegalMoves.
+ * Each keeps the order generateLegalMoves gives its moves in
+ */
+FORCE_INLINE u16 generate_noisy_moves(Position* position, Move* moveList, const i32 turn){
+    const u64 promo_rank = turn ? 0xFF00000000000000ULL : 0x00000000000000FFULL;
+    i32 size[] = {0};
+    u64 ownPos = position->color[turn];
+    u64 oppPos = position->color[!turn];
 
-    pos->charBoard[to] = pos->charBoard[from];
-    pos->charBoard[from] = 0;
+    getBishopTargetMovesAppend(position->queen[turn],  ownPos, oppPos, oppPos, moveList, size);
+    getRookTargetMovesAppend(  position->queen[turn],  ownPos, oppPos, oppPos, moveList, size);
+    getRookTargetMovesAppend(  position->rook[turn],   ownPos, oppPos, oppPos, moveList, size);
+    getBishopTargetMovesAppend(position->bishop[turn], ownPos, oppPos, oppPos, moveList, size);
+    getKnightMovesAppend(      position->knight[turn], ~oppPos, oppPos, moveList, size);
+    getKingThreatMovesAppend(  position->king[turn],   ownPos, oppPos, get_attack_mask(position, !turn), moveList, size);
+    pawnMovesAppend(           position->pawn[turn],   ownPos, oppPos, position->en_passant, promo_rank, moveList, size, turn);
+    return *size;
+}
 
-    pos->color[turn] = clearBit(pos->color[turn], from);
-    pos->color[turn] = setBit(pos->color[turn], to);
+FORCE_INLINE u16 generate_quiet_moves(Position* position, Move* moveList, const i32 turn){
+    const u64 promo_rank = turn ? 0xFF00000000000000ULL : 0x00000000000000FFULL;
+    i32 size[] = {0};
+    u64 ownPos = position->color[turn];
+    u64 oppPos = position->color[!turn];
+    u64 occupied = ownPos | oppPos;
+    u64 oppAttackMask = get_attack_mask(position, !turn);
+
+    castleMovesAppend(occupied, oppAttackMask, position->flags, moveList, size, turn);
+
+    getBishopTargetMovesAppend(position->queen[turn],  ownPos, oppPos, ~oppPos, moveList, size);
+    getRookTargetMovesAppend(  position->queen[turn],  ownPos, oppPos, ~oppPos, moveList, size);
+    getRookTargetMovesAppend(  position->rook[turn],   ownPos, oppPos, ~oppPos, moveList, size);
+    getBishopTargetMovesAppend(position->bishop[turn], ownPos, oppPos, ~oppPos, moveList, size);
+    getKnightMovesAppend(      position->knight[turn], occupied, 0ULL, moveList, size);
+    getKingMovesAppend(        position->king[turn],   occupied, 0ULL, oppAttackMask, moveList, size);
+    pawnMovesAppend(           position->pawn[turn],   occupied, 0ULL, 0ULL, ~promo_rank, moveList, size, turn);
+    return *size;
+}
+
+u16 generateNoisyMoves(Position* position,  Move* moveList){
+    if(position->flags & WHITE_TURN) return generate_noisy_moves(position, moveList, WHITE);
+    return generate_noisy_moves(position, moveList, BLACK);
 }
 
-static void unmovePiece(Position *pos, i32 turn, i32 from, i32 to){
-    switch(toupper(pos->charBoard[from])){
-        case 'Q':
-            pos->queen[!turn] = clearBit(pos->queen[!turn], from);
-            pos->queen[!turn] = setBit(pos->queen[!turn], to);
-            break;
-        case 'K':
-            pos->king[!turn] = clearBit(pos->king[!turn], from);
-            pos->king[!turn] = setBit(pos->king[!turn], to);
-            break;
-        case 'N':
-            pos->knight[!turn] = clearBit(pos->knight[!turn], from);
-            pos->knight[!turn] = setBit(pos->knight[!turn], to);
-            break;
-        case 'B':
-            pos->bishop[!turn] = clearBit(pos->bishop[!turn], from);
-            pos->bishop[!turn] = setBit(pos->bishop[!turn], to);
-            break;
-        case 'R':
-            pos->rook[!turn] = clearBit(pos->rook[!turn], from);
-            pos->rook[!turn] = setBit(pos->rook[!turn], to);
-            break;
-        case 'P':
-            pos->pawn[!turn] = clearBit(pos->pawn[!turn], from);
-            pos->pawn[!turn] = setBit(pos->pawn[!turn], to);
-            break;
+u16 generateQuietMoves(Position* position,  Move* moveList){
+    if(position->flags & WHITE_TURN) return generate_quiet_moves(position, moveList, WHITE);
+    return generate_quiet_moves(position, moveList, BLACK);
+}
+
+/*
+ * Checks if a move that was not generated in this position (a TT move) is legal,
+ * so it can be searched before generating the move list. Castles, en passant and
+ * positions in check are rare enough that they are checked against the full list
+ */
+u8 is_pseudo_legal(Position* position, Move move){
+    if(move == NO_MOVE) return FALSE;
+    i32 turn  = position->flags & TURN_MASK;
+    i32 from  = GET_FROM(move);
+    i32 to    = GET_TO(move);
+    i32 flags = GET_FLAGS(move);
+    u64 from_bb = 1ULL << from;
+    u64 to_bb   = 1ULL << to;
+    u64 ownPos = position->color[turn];
+    u64 oppPos = position->color[!turn];
+    u64 occupied = ownPos | oppPos;
+
+    if(!(from_bb & ownPos) || (to_bb & ownPos) || (to_bb & position->king[!turn])) return FALSE;
+    if(flags == 0x6 || flags == 0x7) return FALSE; // Unused flags
+
+    if(flags == KING_CASTLE || flags == QUEEN_CASTLE || flags == EP_CAPTURE || (position->flags & IN_CHECK)){
+        Move moveList[MAX_MOVES];
+        u16 size = generateLegalMoves(position, moveList);
+        for(u16 i = 0; i < size; i++){
+            if(moveList[i] == move) return TRUE;
+        }
+        return FALSE;
+    }
+
+    // The capture flag has to match the target square
+    if(!(flags & CAPTURE) != !(to_bb & oppPos)) return FALSE;
+
+    u64 targets;
+    if(from_bb & position->pawn[turn]){
+        u64 last_rank = turn ? 0xFF00000000000000ULL : 0x00000000000000FFULL;
+        if(!(flags & PROMOTION) != !(to_bb & last_rank)) return FALSE;
+
+        u64 push = (turn ? northOne(from_bb) : southOne(from_bb)) & ~occupied;
+        if(flags == DOUBLE_PAWN_PUSH){
+            u64 start_rank = turn ? 0x000000000000FF00ULL : 0x00FF000000000000ULL;
+            targets = (from_bb & start_rank) ? (turn ? northOne(push) : southOne(push)) & ~occupied : 0ULL;
+        }
+        else if(flags & CAPTURE) targets = pawnAttacks(from, turn);
+        else                     targets = push;
+    }
+    else{
+        if(flags != QUIET && flags != CAPTURE) return FALSE;
+        if     (from_bb & position->knight[turn]) targets = knightAttacks(from);
+        else if(from_bb & position->bishop[turn]) targets = bishopAttacks(occupied, from);
+        else if(from_bb & position->rook[turn])   targets = rookAttacks(occupied, from);
+        else if(from_bb & position->queen[turn])  targets = bishopAttacks(occupied, from) | rookAttacks(occupied, from);
+        else                                      targets = kingAttacks(from) & ~get_attack_mask(position, !turn);
+    }
+    if(!(targets & to_bb)) return FALSE;
+
+    // Pinned pieces can only move along the line through their king
+    if(from_bb & get_pinned(position)){
+        i32 kingSq = getlsb(position->king[turn]);
+        if(!(betweenMask[kingSq][to] & from_bb) && !(betweenMask[kingSq][from] & to_bb)) return FALSE;
     }
-    pos->charBoard[to] = pos->charBoard[from];
-    pos->charBoard[from] = 0;
-    pos->color[!turn] = clearBit(pos->color[!turn], from);
-    pos->color[!turn] = setBit(pos->color[!turn], to);
+    return TRUE;
 }
 
-/* Used to remove the captured piece */
-static void removeCaptured(Position *pos, i32 square){
-    pos->hash = hash_update_piece(pos->hash, square, pieceToIndex[(int)pos->charBoard[square]]);
-    i32 turn = pos->flags & WHITE_TURN;
-    switch(toupper(pos->charBoard[square])){
-        case 'Q':
-            pos->queen[!turn] = clearBit(pos->queen[!turn], square);
-            break;
-        case 'K':
-            //pos->king[!turn] = clearBit(pos->king[!turn], square);
-            #ifdef DEBUG
-            printf("\nWARNING ATTEMPTED TO CAPTURE A KING AT POS:\n");
-            printPosition(*pos, TRUE);
-            while(TRUE){};
-            #else
-            printf("info string Found illegal position during search - King Capture.\n");
-            #endif
-            break;
-        case 'N':
-            pos->knight[!turn] = clearBit(pos->knight[!turn], square);
-            break;
-        case 'B':
-            pos->bishop[!turn] = clearBit(pos->bishop[!turn], square);
-            break;
-        case 'R':
-            pos->rook[!turn] = clearBit(pos->rook[!turn], square);
-            break;
-        case 'P':
-            pos->pawn[!turn] = clearBit(pos->pawn[!turn], square);
-            break;
+
+static const PieceType promoType[4] = {KNIGHT, BISHOP, ROOK, QUEEN}; // Indexed by the low bits of a promotion flag
+
+/*
+ * Board updates shared by make and unmake move, the piece on a square is looked up in
+ * the mailbox so no piece type has to be switched on. The material, PST and phase
+ * accumulators and the pawn hash are updated by delta so unmaking restores them.
+ * The hash is not touched here
+ */
+static inline void movePiece(Position *pos, i32 from, i32 to){
+    u8 piece = pos->board[from];
+    u64 from_to = (1ULL << from) | (1ULL << to);
+    pos->pieces[piece] ^= from_to;
+    pos->color[PIECE_COLOR(piece)] ^= from_to;
+    pos->board[to] = piece;
+    pos->board[from] = NO_PIECE;
+
+    i32 sign = PIECE_COLOR(piece) == WHITE ? 1 : -1;
+    pos->psq += sign * (PST[piece][to] - PST[piece][from]);
+    if(PIECE_TYPE(piece) == PAWN) pos->pawn_hash = hash_update_piece(hash_update_piece(pos->pawn_hash, from, piece), to, piece);
+}
+
+static inline void putPiece(Position *pos, i32 square, u8 piece){
+    u64 bb = 1ULL << square;
+    pos->pieces[piece] |= bb;
+    pos->color[PIECE_COLOR(piece)] |= bb;
+    pos->board[square] = piece;
+
+    i32 sign = PIECE_COLOR(piece) == WHITE ? 1 : -1;
+    pos->material += sign * PieceValues[piece];
+    pos->psq      += sign * (S(PieceValues[piece], PieceValues[piece]) + PST[piece][square]);
+    pos->phase    += PiecePhases[piece];
+    pos->piece_count++;
+    pos->material_key += 1ULL << MATERIAL_SHIFT(piece);
+    if(PIECE_TYPE(piece) == PAWN) pos->pawn_hash = hash_update_piece(pos->pawn_hash, square, piece);
+}
+
+static inline void removePiece(Position *pos, i32 square){
+    u8 piece = pos->board[square];
+    #ifdef DEBUG
+    if(PIECE_TYPE(piece) == KING){
+        printf("\nWARNING ATTEMPTED TO REMOVE A KING AT POS:\n");
+        printPosition(*pos, TRUE);
+        while(TRUE){};
     }
-    pos->color[!turn] = clearBit(pos->color[!turn], square);
-    pos->charBoard[square] = 0;
-    pos->halfmove_clock = 0;
+    #endif
+    u64 bb = 1ULL << square;
+    pos->pieces[piece] ^= bb;
+    pos->color[PIECE_COLOR(piece)] ^= bb;
+    pos->board[square] = NO_PIECE;
+
+    i32 sign = PIECE_COLOR(piece) == WHITE ? 1 : -1;
+    pos->material -= sign * PieceValues[piece];
+    pos->psq      -= sign * (S(PieceValues[piece], PieceValues[piece]) + PST[piece][square]);
+    pos->phase    -= PiecePhases[piece];
+    pos->piece_count--;
+    pos->material_key -= 1ULL << MATERIAL_SHIFT(piece);
+    if(PIECE_TYPE(piece) == PAWN) pos->pawn_hash = hash_update_piece(pos->pawn_hash, square, piece);
 }
 
-static void replaceCaptured(Position *pos, i32 square, char piece){
-    i32 turn = pos->flags & WHITE_TURN;
-    switch(toupper(piece)){
-        case 'Q':
-            pos->queen[!turn] = setBit(pos->queen[!turn], square);
-            break;
-        case 'K':
-            //pos->king[!turn] = clearBit(pos->king[!turn], square);
-            #ifdef DEBUG
-            printf("WARNING ATTEMPTED TO PLACE A KING AT POS:\n");
-            printPosition(*pos, TRUE);
-            while(TRUE){};
-            #else
-            printf("info string Found illegal position during search - King Replacement.\n");
-            #endif
-            break;
-        case 'N':
-            pos->knight[!turn] = setBit(pos->knight[!turn], square);
-            break;
-        case 'B':
-            pos->bishop[!turn] = setBit(pos->bishop[!turn], square);
-            break;
-        case 'R':
-            pos->rook[!turn] = setBit(pos->rook[!turn], square);
-            break;
-        case 'P':
-            pos->pawn[!turn] = setBit(pos->pawn[!turn], square);
-            break;
+#ifdef DEBUG
+/*
+ * Checks the incremental accumulators against a full recount
+ */
+static void check_accumulators(Position *pos, const char* where){
+    Position actual = *pos;
+    init_eval_accumulators(&actual);
+    if(actual.material != pos->material || actual.psq != pos->psq
+    || actual.phase != pos->phase || actual.piece_count != pos->piece_count || actual.material_eval != pos->material_eval
+    || actual.material_key != pos->material_key){
+        printf("Incremental eval accumulators do not match a full recount after %s!\n", where);
+        printf("Found:    material %d mg %d eg %d phase %d pieces %d material_eval %d material_key %012" PRIx64 "\n",
+               pos->material, mg_score(pos->psq), eg_score(pos->psq), pos->phase, pos->piece_count, pos->material_eval, pos->material_key);
+        printf("Expected: material %d mg %d eg %d phase %d pieces %d material_eval %d material_key %012" PRIx64 "\n",
+               actual.material, mg_score(actual.psq), eg_score(actual.psq), actual.phase, actual.piece_count, actual.material_eval, actual.material_key);
+        printPosition(*pos, TRUE);
+        fflush(stdout);
+        while(1);
     }
-    pos->color[!turn] = setBit(pos->color[!turn], square);
-    pos->charBoard[square] = piece;
-    return;
 }
+#endif
+
+static void do_move(Position *pos, Move move, u64 child_hash);
 
 void make_move(ThreadData *td, Move move){
+    u64 child_hash = hash_after_move(&td->pos, move);
+    tt_prefetch(child_hash);
+    eval_table_prefetch(td->eval_table, child_hash);
+    // Other moves keep the pawn entry the parent position used
+    if(PIECE_TYPE(td->pos.board[GET_FROM(move)]) == PAWN || (GET_FLAGS(move) & CAPTURE)){
+        pawn_table_prefetch(td->pawn_table, pawn_hash_after_move(&td->pos, move));
+    }
+
     Undo *undo = &td->undo_stack.undo[++td->undo_stack.idx];
-    undo->attack_mask[0] = td->pos.attack_mask[0];
-    undo->attack_mask[1] = td->pos.attack_mask[1];
-    undo->pinned         = td->pos.pinned;
+    undo->checkers       = td->pos.checkers;
     undo->en_passant     = td->pos.en_passant;
     undo->flags          = td->pos.flags;
     undo->halfmove_clock = td->pos.halfmove_clock;
     undo->hash           = td->pos.hash;
     undo->material_eval  = td->pos.material_eval;
-    undo->captured       = td->pos.charBoard[GET_TO(move)];
+    undo->captured       = td->pos.board[GET_TO(move)];
 
     undo->hash_reset_idx = td->hash_stack.reset_idx;
 
-
-    _make_move(&td->pos, move);
+    #ifdef DEBUG
+    u64 child_pawn_hash = pawn_hash_after_move(&td->pos, move);
+    #endif
+    do_move(&td->pos, move, child_hash);
+    #ifdef DEBUG
+    if(td->pos.pawn_hash != child_pawn_hash){
+        printf("pawn_hash_after_move does not match the pawn hash after make move!\n");
+        printMove(move);
+        printf("\n");
+        fflush(stdout);
+        while(1);
+    }
+    #endif
 
     td->hash_stack.cur_idx = (td->hash_stack.cur_idx + 1) % HASHSTACK_SIZE;
     if(td->pos.halfmove_clock == 0) td->hash_stack.reset_idx = td->hash_stack.cur_idx;
     td->hash_stack.hash[td->hash_stack.cur_idx] = td->pos.hash;    
 }
 
-void _make_move(Position *pos,  Move move){
-    #ifdef DEBUG
-    if(move == NO_MOVE) printf("WARNING ILLEGAL NO-MOVE IN MAKE MOVE\n");
-    #endif
-    i32 turn = pos->flags & WHITE_TURN;
-    u8 prev_flags = pos->flags;
-    i32 from = GET_FROM(move);
-    i32 to   = GET_TO(move);
+/*
+ * Makes the move for turn, the side to move, child_hash is the hash after the move from hash_after_move
+ */
+FORCE_INLINE void do_move_color(Position *pos, Move move, u64 child_hash, const i32 turn){
+    i32 from  = GET_FROM(move);
+    i32 to    = GET_TO(move);
+    i32 flags = GET_FLAGS(move);
 
-    pos->hash = hash_update_turn(pos->hash);
-    if(pos->en_passant) pos->hash = hash_update_enpassant(pos->hash, getlsb(pos->en_passant));
-    
-    pos->halfmove_clock++;
+    pos->hash = child_hash;
     pos->en_passant = 0ULL;
+    pos->halfmove_clock++;
+    if(PIECE_TYPE(pos->board[from]) == PAWN || (flags & CAPTURE)) pos->halfmove_clock = 0;
 
-    // Handle move flags
-    switch(GET_FLAGS(move)){
-        case QUEEN_PROMO_CAPTURE:
-            removeCaptured(pos, to);
-            pos->hash = hash_update_piece(pos->hash, from, pieceToIndex[turn ? 'P' : 'p']);
-            pos->hash = hash_update_piece(pos->hash, to, pieceToIndex[turn ? 'Q' : 'q']);
-            pos->pawn[turn] = clearBit(pos->pawn[turn], from); 
-            pos->charBoard[from] = 0;
-            pos->queen[turn] = setBit(pos->queen[turn], to); 
-            pos->charBoard[to] = turn ? 'Q' : 'q';
-            pos->color[turn] = clearBit(pos->color[turn], from);
-            pos->color[turn] = setBit(pos->color[turn], to);
-            pos->halfmove_clock = 0;
-            break;
-        case ROOK_PROMO_CAPTURE:
-            removeCaptured(pos, to);
-            pos->hash = hash_update_piece(pos->hash, from, pieceToIndex[turn ? 'P' : 'p']);
-            pos->hash = hash_update_piece(pos->hash, to, pieceToIndex[turn ? 'R' : 'r']);
-            pos->pawn[turn] = clearBit(pos->pawn[turn], from); 
-            pos->charBoard[from] = 0;
-            pos->rook[turn] = setBit(pos->rook[turn], to); 
-            pos->charBoard[to] = turn ? 'R' : 'r';
-            pos->color[turn] = clearBit(pos->color[turn], from);
-            pos->color[turn] = setBit(pos->color[turn], to);
-            pos->halfmove_clock = 0;
-            break;
-        case BISHOP_PROMO_CAPTURE:
-            removeCaptured(pos, to);
-            pos->hash = hash_update_piece(pos->hash, from, pieceToIndex[turn ? 'P' : 'p']);
-            pos->hash = hash_update_piece(pos->hash, to, pieceToIndex[turn ? 'B' : 'b']);
-            pos->pawn[turn] = clearBit(pos->pawn[turn], from); 
-            pos->charBoard[from] = 0;
-            pos->bishop[turn] = setBit(pos->bishop[turn], to); 
-            pos->charBoard[to] = turn ? 'B' : 'b';
-            pos->color[turn] = clearBit(pos->color[turn], from);
-            pos->color[turn] = setBit(pos->color[turn], to);
-            pos->halfmove_clock = 0;
-            break;
-        case KNIGHT_PROMO_CAPTURE:
-            removeCaptured(pos, to);
-            pos->hash = hash_update_piece(pos->hash, from, pieceToIndex[turn ? 'P' : 'p']);
-            pos->hash = hash_update_piece(pos->hash, to, pieceToIndex[turn ? 'N' : 'n']);
-            pos->pawn[turn] = clearBit(pos->pawn[turn], from); 
-            pos->charBoard[from] = 0;
-            pos->knight[turn] = setBit(pos->knight[turn], to); 
-            pos->charBoard[to] = turn ? 'N' : 'n';
-            pos->color[turn] = clearBit(pos->color[turn], from);
-            pos->color[turn] = setBit(pos->color[turn], to);
-            pos->halfmove_clock = 0;
-            break;
-            
-        case EP_CAPTURE:
-            removeCaptured(pos, (turn ? to - 8 : to + 8));
-            movePiece(pos, turn, from, to);
-            break;
-        case CAPTURE:
-            removeCaptured(pos, to);
-            movePiece(pos, turn, from, to);
-            break;
-
-        case QUEEN_PROMOTION:
-            pos->hash = hash_update_piece(pos->hash, from, pieceToIndex[turn ? 'P' : 'p']);
-            pos->hash = hash_update_piece(pos->hash, to, pieceToIndex[turn ? 'Q' : 'q']);
-            pos->color[turn] = clearBit(pos->color[turn], from);
-            pos->color[turn] = setBit(pos->color[turn], to);
-            pos->queen[turn] = setBit(pos->queen[turn], to);
-            pos->pawn[turn] = clearBit(pos->pawn[turn], from);
-            pos->charBoard[from] = 0;
-            pos->charBoard[to] = turn ? 'Q' : 'q';
-            pos->halfmove_clock = 0;
-            break;
-        case ROOK_PROMOTION:
-            pos->hash = hash_update_piece(pos->hash, from, pieceToIndex[turn ? 'P' : 'p']);
-            pos->hash = hash_update_piece(pos->hash, to, pieceToIndex[turn ? 'R' : 'r']);
-            pos->color[turn] = clearBit(pos->color[turn], from);
-            pos->color[turn] = setBit(pos->color[turn], to);
-            pos->rook[turn] = setBit(pos->rook[turn], to);
-            pos->pawn[turn] = clearBit(pos->pawn[turn], from);
-            pos->charBoard[from] = 0;
-            pos->charBoard[to] = turn ? 'R' : 'r';
-            pos->halfmove_clock = 0;
-            break;
-        case BISHOP_PROMOTION:
-            pos->hash = hash_update_piece(pos->hash, from, pieceToIndex[turn ? 'P' : 'p']);
-            pos->hash = hash_update_piece(pos->hash, to, pieceToIndex[turn ? 'B' : 'b']);
-            pos->color[turn] = clearBit(pos->color[turn], from);
-            pos->color[turn] = setBit(pos->color[turn], to);
-            pos->bishop[turn] = setBit(pos->bishop[turn], to);
-            pos->pawn[turn] = clearBit(pos->pawn[turn], from);
-            pos->charBoard[from] = 0;
-            pos->charBoard[to] = turn ? 'B' : 'b';
-            pos->halfmove_clock = 0;
-            break;
-        case KNIGHT_PROMOTION:
-            pos->hash = hash_update_piece(pos->hash, from, pieceToIndex[turn ? 'P' : 'p']);
-            pos->hash = hash_update_piece(pos->hash, to, pieceToIndex[turn ? 'N' : 'n']);
-            pos->color[turn] = clearBit(pos->color[turn], from);
-            pos->color[turn] = setBit(pos->color[turn], to);
-            pos->knight[turn] = setBit(pos->knight[turn], to);
-            pos->pawn[turn] = clearBit(pos->pawn[turn], from);
-            pos->charBoard[from] = 0;
-            pos->charBoard[to] = turn ? 'N' : 'n';
-            pos->halfmove_clock = 0;
-            break;
-        case QUEEN_CASTLE:
-            pos->flags &= ~(turn ? W_LONG_CASTLE : B_LONG_CASTLE);
-            pos->flags &= ~(turn ? W_SHORT_CASTLE : B_SHORT_CASTLE);
-            movePiece(pos, turn, from, to);
-            movePiece(pos, turn, turn ? 0 : 56, turn ? 3 : 59);
-            break;
-        case KING_CASTLE:
-            pos->flags &= ~(turn ? W_LONG_CASTLE : B_LONG_CASTLE);
-            pos->flags &= ~(turn ? W_SHORT_CASTLE : B_SHORT_CASTLE);
-            movePiece(pos, turn, from, to);
-            movePiece(pos, turn, turn ? 7 : 63, turn ? 5 : 61);
-            break;
-
-        case DOUBLE_PAWN_PUSH:
-            pos->en_passant = 1ULL << (turn ? to - 8 : to + 8);
-            pos->hash = hash_update_enpassant(pos->hash, turn ? to - 8 : to + 8);
-            // Fall through
-        case QUIET:
-        default:
-            movePiece(pos, turn, from, to);
-            break;
+    const i32 up = turn ? 8 : -8;
+
+    if(flags == EP_CAPTURE) removePiece(pos, to - up);
+    else if(flags & CAPTURE) removePiece(pos, to);
+
+    if(flags & PROMOTION){
+        removePiece(pos, from);
+        putPiece(pos, to, PIECE_INDEX(promoType[flags & 0x3], turn));
     }
+    else movePiece(pos, from, to);
+
+    if(flags == DOUBLE_PAWN_PUSH)  pos->en_passant = 1ULL << (to - up);
+    else if(flags == KING_CASTLE)  movePiece(pos, turn ? 7 : 63, turn ? 5 : 61);
+    else if(flags == QUEEN_CASTLE) movePiece(pos, turn ? 0 : 56, turn ? 3 : 59);
 
     //Castle Aval Rooks Moves
     if((to == 0  || from == 0) ) pos->flags &= ~W_LONG_CASTLE;
@@ -396,34 +367,19 @@ void _make_move(Position *pos,  Move move){
         pos->flags &= ~B_LONG_CASTLE;
         pos->flags &= ~B_SHORT_CASTLE;
     } 
-    
-    if((prev_flags & W_LONG_CASTLE ) != (pos->flags & W_LONG_CASTLE )) pos->hash = hash_update_castle(pos->hash, W_LONG_CASTLE );
-    if((prev_flags & W_SHORT_CASTLE) != (pos->flags & W_SHORT_CASTLE)) pos->hash = hash_update_castle(pos->hash, W_SHORT_CASTLE);
-    if((prev_flags & B_LONG_CASTLE ) != (pos->flags & B_LONG_CASTLE )) pos->hash = hash_update_castle(pos->hash, B_LONG_CASTLE );
-    if((prev_flags & B_SHORT_CASTLE) != (pos->flags & B_SHORT_CASTLE)) pos->hash = hash_update_castle(pos->hash, B_SHORT_CASTLE);
 
     if(!turn) pos->fullmove_number++;
 
-    setAttackMasks(pos);
-
-    //Check Flag
-    pos->flags = pos->attack_mask[turn] & pos->king[!turn] ? (pos->flags | IN_CHECK) : (pos->flags & ~IN_CHECK);
-
-    //Double Check Flag
-    if(pos->flags & IN_CHECK){
-       i32 king_sq = getlsb(pos->king[!turn]);
-       u64 attackers = getAttackers(pos, king_sq, turn);
-       attackers &= attackers - 1;
-       if(attackers) pos->flags |= IN_D_CHECK;
-    }
-    else pos->flags &= ~IN_D_CHECK;
+    //Check Flags, attack masks and pins are only generated once something asks for them
+    pos->checkers = getAttackers(pos, getlsb(pos->king[!turn]), turn);
+    pos->flags = pos->checkers ? (pos->flags | IN_CHECK) : (pos->flags & ~IN_CHECK);
+    pos->flags = pos->checkers & (pos->checkers - 1) ? (pos->flags | IN_D_CHECK) : (pos->flags & ~IN_D_CHECK);
+    pos->cached = 0;
 
     pos->flags ^= WHITE_TURN;
 
-    pos->pinned = generatePinnedPieces(pos);
+    pos->material_eval = turn ? -pos->material : pos->material;
 
-    pos->material_eval = eval_material(pos);
-    
     pos->stage = calculateStage(pos);
 
     #ifdef DEBUG
@@ -451,9 +407,51 @@ void _make_move(Position *pos,  Move move){
         fflush(stdout);
         while(1);
     }
+    if(pos->pawn_hash != hashPawns(pos)){
+        printf("Incremental pawn hash does not match correct pawn hash after make move!\n");
+        printPosition(*pos, TRUE);
+        printf("From move: ");
+        printMove(move);
+        printf(".\r\n");
+        fflush(stdout);
+        while(1);
+    }
+    check_accumulators(pos, "make move");
     #endif
 }
 
+static void do_move(Position *pos, Move move, u64 child_hash){
+    #ifdef DEBUG
+    if(move == NO_MOVE) printf("WARNING ILLEGAL NO-MOVE IN MAKE MOVE\n");
+    #endif
+    if(pos->flags & WHITE_TURN) do_move_color(pos, move, child_hash, WHITE);
+    else                        do_move_color(pos, move, child_hash, BLACK);
+}
+
+void _make_move(Position *pos,  Move move){
+    do_move(pos, move, hash_after_move(pos, move));
+}
+
+/*
+ * Puts the pieces back from a move made by mover
+ */
+FORCE_INLINE void unmove_pieces(Position *pos, Move move, u8 captured, const i32 mover){
+    i32 from  = GET_FROM(move);
+    i32 to    = GET_TO(move);
+    i32 flags = GET_FLAGS(move);
+
+    if(flags & PROMOTION){
+        removePiece(pos, to);
+        putPiece(pos, from, PIECE_INDEX(PAWN, mover));
+    }
+    else movePiece(pos, to, from);
+
+    if(flags == EP_CAPTURE)        putPiece(pos, mover ? to - 8 : to + 8, PIECE_INDEX(PAWN, !mover));
+    else if(flags & CAPTURE)       putPiece(pos, to, captured);
+    else if(flags == KING_CASTLE)  movePiece(pos, mover ? 5 : 61, mover ? 7 : 63);
+    else if(flags == QUEEN_CASTLE) movePiece(pos, mover ? 3 : 59, mover ? 0 : 56);
+}
+
 void unmake_move(ThreadData *td, Move move){
     #ifdef DEBUG
     if(move == NO_MOVE) printf("WARNING ILLEGAL NO-MOVE IN UNMAKE MOVE\n");
@@ -462,13 +460,9 @@ void unmake_move(ThreadData *td, Move move){
     Position *pos = &td->pos;
     Undo undo = td->undo_stack.undo[td->undo_stack.idx--];
     i32 turn = pos->flags & WHITE_TURN;
-    i32 from = GET_FROM(move);
-    i32 to   = GET_TO(move);
 
-    pos->attack_mask[0] = undo.attack_mask[0];
-    pos->attack_mask[1] = undo.attack_mask[1]; 
-    pos->pinned         = undo.pinned;
-    pos->material_eval  = undo.material_eval;
+    pos->checkers       = undo.checkers;
+    pos->cached         = 0;
     pos->flags          = undo.flags;
     pos->halfmove_clock = undo.halfmove_clock;
     pos->en_passant     = undo.en_passant;
@@ -477,99 +471,8 @@ void unmake_move(ThreadData *td, Move move){
 
     td->hash_stack.reset_idx = undo.hash_reset_idx;
 
-    // Handle move flags
-    switch(GET_FLAGS(move)){
-        case QUEEN_PROMO_CAPTURE:
-            pos->color[!turn] = clearBit(pos->color[!turn], to);
-            pos->color[!turn] = setBit(pos->color[!turn], from);
-            pos->charBoard[to] = undo.captured;
-            pos->queen[!turn] = clearBit(pos->queen[!turn], to); 
-            pos->charBoard[from] = !turn ? 'P' : 'p';
-            pos->pawn[!turn] = setBit(pos->pawn[!turn], from); 
-            replaceCaptured(pos, to, undo.captured);
-            break;
-        case ROOK_PROMO_CAPTURE:
-            pos->color[!turn] = clearBit(pos->color[!turn], to);
-            pos->color[!turn] = setBit(pos->color[!turn], from);
-            pos->charBoard[to] = undo.captured;
-            pos->rook[!turn] = clearBit(pos->rook[!turn], to); 
-            pos->charBoard[from] = !turn ? 'P' : 'p';
-            pos->pawn[!turn] = setBit(pos->pawn[!turn], from); 
-            replaceCaptured(pos, to, undo.captured);
-            break;
-        case BISHOP_PROMO_CAPTURE:
-            pos->color[!turn] = clearBit(pos->color[!turn], to);
-            pos->color[!turn] = setBit(pos->color[!turn], from);
-            pos->charBoard[to] = undo.captured;
-            pos->bishop[!turn] = clearBit(pos->bishop[!turn], to); 
-            pos->charBoard[from] = !turn ? 'P' : 'p';
-            pos->pawn[!turn] = setBit(pos->pawn[!turn], from); 
-            replaceCaptured(pos, to, undo.captured);
-            break;
-        case KNIGHT_PROMO_CAPTURE:
-            pos->color[!turn] = clearBit(pos->color[!turn], to);
-            pos->color[!turn] = setBit(pos->color[!turn], from);
-            pos->charBoard[to] = undo.captured;
-            pos->knight[!turn] = clearBit(pos->knight[!turn], to); 
-            pos->charBoard[from] = !turn ? 'P' : 'p';
-            pos->pawn[!turn] = setBit(pos->pawn[!turn], from); 
-            replaceCaptured(pos, to, undo.captured);
-            break;
-        case EP_CAPTURE:
-            unmovePiece(pos, turn, to, from);
-            replaceCaptured(pos, (turn ? to + 8 : to - 8), turn ? 'P' : 'p');
-            break;
-        case CAPTURE:
-            unmovePiece(pos, turn, to, from);
-            replaceCaptured(pos, to, undo.captured);
-            break;
-        case QUEEN_PROMOTION:
-            pos->charBoard[from] = !turn ? 'P' : 'p';
-            pos->charBoard[to] = 0;
-            pos->pawn[!turn] = setBit(pos->pawn[!turn], from);
-            pos->queen[!turn] = clearBit(pos->queen[!turn], to);
-            pos->color[!turn] = clearBit(pos->color[!turn], to);
-            pos->color[!turn] = setBit(pos->color[!turn], from);
-            break;
-        case ROOK_PROMOTION:
-            pos->charBoard[from] = !turn ? 'P' : 'p';
-            pos->charBoard[to] = 0;
-            pos->pawn[!turn] = setBit(pos->pawn[!turn], from);
-            pos->rook[!turn] = clearBit(pos->rook[!turn], to);
-            pos->color[!turn] = clearBit(pos->color[!turn], to);
-            pos->color[!turn] = setBit(pos->color[!turn], from);
-            break;
-        case BISHOP_PROMOTION:
-            pos->charBoard[from] = !turn ? 'P' : 'p';
-            pos->charBoard[to] = 0;
-            pos->pawn[!turn] = setBit(pos->pawn[!turn], from);
-            pos->bishop[!turn] = clearBit(pos->bishop[!turn], to);
-            pos->color[!turn] = clearBit(pos->color[!turn], to);
-            pos->color[!turn] = setBit(pos->color[!turn], from);
-            break;
-        case KNIGHT_PROMOTION:
-            pos->charBoard[from] = !turn ? 'P' : 'p';
-            pos->charBoard[to] = 0;
-            pos->pawn[!turn] = setBit(pos->pawn[!turn], from);
-            pos->knight[!turn] = clearBit(pos->knight[!turn], to);
-            pos->color[!turn] = clearBit(pos->color[!turn], to);
-            pos->color[!turn] = setBit(pos->color[!turn], from);
-            break;
-        case QUEEN_CASTLE:
-            unmovePiece(pos, turn, to, from);
-            unmovePiece(pos, turn, !turn ? 3 : 59, !turn ? 0 : 56);
-            break;
-        case KING_CASTLE:
-            unmovePiece(pos, turn, to, from);
-            unmovePiece(pos, turn, !turn ? 5 : 61, !turn ? 7 : 63);
-            break;
-
-        case DOUBLE_PAWN_PUSH:
-        case QUIET:
-        default:
-            unmovePiece(pos, turn, to, from);
-            break;
-    }
+    if(turn) unmove_pieces(pos, move, undo.captured, BLACK);
+    else     unmove_pieces(pos, move, undo.captured, WHITE);
 
     if(turn) pos->fullmove_number--;
 
@@ -602,6 +505,16 @@ void unmake_move(ThreadData *td, Move move){
         fflush(stdout);
         while(1);
     }
+    if(pos->pawn_hash != hashPawns(pos)){
+        printf("Incremental pawn hash does not match correct pawn hash after unmake move!\n");
+        printPosition(*pos, TRUE);
+        printf("From unmaking move: ");
+        printMove(move);
+        printf(".\r\n");
+        fflush(stdout);
+        while(1);
+    }
+    check_accumulators(pos, "unmake move");
     #endif
 
 }
@@ -609,7 +522,6 @@ void unmake_move(ThreadData *td, Move move){
 void make_null_move(ThreadData *td){
     Position *pos = &td->pos;
     Undo *undo = &td->undo_stack.undo[++td->undo_stack.idx];
-    undo->pinned         = pos->pinned;
     undo->en_passant     = pos->en_passant;
     undo->hash_reset_idx = td->hash_stack.reset_idx;
 
@@ -617,13 +529,16 @@ void make_null_move(ThreadData *td){
     if(!(pos->flags & TURN_MASK)) pos->fullmove_number++;
 
     pos->flags ^= TURN_MASK;
+    pos->material_eval = -pos->material_eval; // Side to move relative
 
     if(pos->en_passant){
         pos->hash = hash_update_enpassant(pos->hash, getlsb(pos->en_passant));
         pos->en_passant = 0ULL;
-        pos->pinned = generatePinnedPieces(&td->pos);
     }
 
+    // Nothing moved so the attack masks still hold, the pins belong to the other side now
+    pos->cached &= ~PINNED_CACHED;
+
     pos->hash = hash_update_turn(pos->hash);
 
     pos->stage = calculateStage(pos);
@@ -656,12 +571,13 @@ void make_null_move(ThreadData *td){
 void unmake_null_move(ThreadData *td){
     Position *pos = &td->pos;
     Undo undo = td->undo_stack.undo[td->undo_stack.idx--];
-    pos->pinned              = undo.pinned;
+    pos->cached             &= ~PINNED_CACHED;
     pos->en_passant          = undo.en_passant;
     td->hash_stack.reset_idx = undo.hash_reset_idx;
     
     pos->hash = hash_update_turn(pos->hash);
     pos->flags ^= TURN_MASK;
+    pos->material_eval = -pos->material_eval;
 
     if(pos->en_passant){
         pos->hash = hash_update_enpassant(pos->hash, getlsb(pos->en_passant));
@@ -696,60 +612,3 @@ void unmake_null_move(ThreadData *td){
     #endif
 }
 
-
-static u64 generatePinnedPiecesColor(Position* pos, i32 turn){
-    u64 pos_pinners;
-    i32 k_square = getlsb(pos->king[turn]);
-
-    //Contains all the initial pieces
-    u64 all_pieces = pos->color[0] | pos->color[1];  
-
-    // The pieces belonging to white which become pinned
-    u64 pinned = pos->color[turn];  
-
-    // A attack masks
-    u64 d_attack_mask, h_attack_mask, attack_mask = 0ULL;
-
-    u64 pin_directions = 0ULL;
-    u64 ep_pawn_square = 0ULL;
-
-    // Make sure ep_pawn_square is the same row as the k_square
-    // if white turn => king must be row 5
-    // if black turn => king must be row 4
-    if((pos->en_passant != 0) && (k_square / 8 == (turn ? 4 : 3))){ //If can capture en-passant
-        ep_pawn_square = turn ? southOne(pos->en_passant) : northOne(pos->en_passant);
-    }
-    
-    // Get a bb of squares being attacked by the king
-    attack_mask |= rookAttacks(all_pieces & ~ep_pawn_square, k_square);  
-    attack_mask |= bishopAttacks(all_pieces, k_square);
-
-    // The pinned white pieces now contains the ones with a ray to the king
-    pinned &= attack_mask; 
-
-    // Now get all pieces under attack as if king is queen again and these are the possible pinners
-    h_attack_mask = rookAttacks(all_pieces & ~pinned & ~ep_pawn_square, k_square);
-    pos_pinners = h_attack_mask & (pos->queen[!turn] | pos->rook[!turn]);
-    while(pos_pinners){
-        i32 pinner_sq = getlsb(pos_pinners);
-        pin_directions |= betweenMask[k_square][pinner_sq];
-        pos_pinners &= pos_pinners - 1;
-    }
-
-    d_attack_mask = bishopAttacks(all_pieces & ~pinned, k_square);
-    pos_pinners = d_attack_mask & (pos->queen[!turn] | pos->bishop[!turn]);
-    while(pos_pinners){
-        i32 pinner_sq = getlsb(pos_pinners);
-        pin_directions |= betweenMask[k_square][pinner_sq];
-        pos_pinners &= pos_pinners - 1;
-    }
-
-    // Only keep the pieces that are actually pinned
-    pinned &= pin_directions; 
-    return pinned;
-}
-
-u64 generatePinnedPieces(Position* pos){
-    return generatePinnedPiecesColor(pos, 0) | generatePinnedPiecesColor(pos, 1);
-}
-
@@ -2,7 +2,9 @@
 #include "types.h"
 u16 generateLegalMoves(Position* pos,  Move* moveList);
 u16 generateThreatMoves(Position* pos,  Move* moveList);
-u64 generatePinnedPieces(Position* pos);
+u16 generateNoisyMoves(Position* pos,  Move* moveList);
+u16 generateQuietMoves(Position* pos,  Move* moveList);
+u8 is_pseudo_legal(Position* pos, Move move);
 void make_move(ThreadData *td, Move move);
 void _make_move(Position *pos,  Move move);
 void unmake_move(ThreadData *td, Move move);
@@ -3,6 +3,8 @@
 #include "bitboard/bitboard.h"
 #include "types.h"
 #include "params.h"
+#include "movement.h"
+#include "util.h"
 
 static const i32 SEEPieceValues[] = {
     [WHITE_PAWN  ] = MovePawnValue,
@@ -29,17 +31,16 @@ i32 eval_move(Move move, Position* pos){
     // Get the piece information from the move and the position.
     Square fr_sq = GET_FROM(move);
     Square to_sq = GET_TO(move);
-    char fr_piece = pos->charBoard[fr_sq];
-    char to_piece = pos->charBoard[to_sq];
-    i32 fr_piece_i = pieceToIndex[(int)fr_piece];
-    i32 to_piece_i = pieceToIndex[(int)to_piece];
+    i32 fr_piece_i = pos->board[fr_sq];
+    i32 to_piece_i = pos->board[to_sq];
+    if(GET_FLAGS(move) == EP_CAPTURE) to_piece_i = PIECE_INDEX(PAWN, !(pos->flags & TURN_MASK));
 
     #ifdef DEBUG
-    if(fr_piece_i >= 12 || to_piece_i >= 12){
+    if(fr_piece_i >= PIECE_COUNT){
         printf("Warning illegal piece found at:");
         printPosition(*pos, TRUE);
-        printf("from piece: %d", pos->charBoard[fr_sq]);
-        printf(" to piece: %d", pos->charBoard[to_sq]);
+        printf("from piece: %d", pos->board[fr_sq]);
+        printf(" to piece: %d", pos->board[to_sq]);
         while(1){};
         return 0;
     }
@@ -47,35 +48,35 @@ i32 eval_move(Move move, Position* pos){
 
     // Add on the PST values
     u32 phase = pos->stage == END_GAME ? 1 : 0;
-    eval += PST[phase][fr_piece_i][to_sq] - PST[phase][fr_piece_i][fr_sq];
+    eval += phase_score(PST[fr_piece_i][to_sq] - PST[fr_piece_i][fr_sq], phase);
     
     // Add on calculated values depending on the flag
     switch(GET_FLAGS(move)){
         // Promotion Capture Moves
         case QUEEN_PROMO_CAPTURE:
             eval += see(pos, to_sq, to_piece_i, fr_sq, fr_piece_i) + MoveQueenValue - MovePawnValue;
-            eval += PST[phase][to_piece_i][to_sq];
+            eval += phase_score(PST[to_piece_i][to_sq], phase);
             break;
         case ROOK_PROMO_CAPTURE:
             eval += see(pos, to_sq, to_piece_i, fr_sq, fr_piece_i) + MoveRookValue - MovePawnValue;
-            eval += PST[phase][to_piece_i][to_sq];
+            eval += phase_score(PST[to_piece_i][to_sq], phase);
             break;
         case BISHOP_PROMO_CAPTURE:
             eval += see(pos, to_sq, to_piece_i, fr_sq, fr_piece_i) + MoveBishopValue - MovePawnValue;
-            eval += PST[phase][to_piece_i][to_sq];
+            eval += phase_score(PST[to_piece_i][to_sq], phase);
             break;
         case KNIGHT_PROMO_CAPTURE:
             eval += see(pos, to_sq, to_piece_i, fr_sq, fr_piece_i) + MoveKnightValue - MovePawnValue;
-            eval += PST[phase][to_piece_i][to_sq];
+            eval += phase_score(PST[to_piece_i][to_sq], phase);
             break;
         // Capture Moves
         case EP_CAPTURE:
-            eval += see(pos, to_sq, ( WHITE_PAWN + ((pos->flags & TURN_MASK) * 6) ), fr_sq, fr_piece_i);
-            eval += PST[phase][to_piece_i][to_sq];
+            eval += see(pos, to_sq, to_piece_i, fr_sq, fr_piece_i);
+            eval += phase_score(PST[to_piece_i][to_sq], phase);
             break;
         case CAPTURE:
             eval += see(pos, to_sq, to_piece_i, fr_sq, fr_piece_i);
-            eval += PST[phase][to_piece_i][to_sq];
+            eval += phase_score(PST[to_piece_i][to_sq], phase);
             break;
         // Promotion Moves
         case QUEEN_PROMOTION:
@@ -113,11 +114,9 @@ void eval_movelist(Position* pos, Move* moveList, i32* moveVals, i32 size){
         Square fr_sq = GET_FROM(move);
         Square to_sq = GET_TO(move);
 
-        i32 fr_piece = (i32)pos->charBoard[fr_sq];
-        i32 to_piece = (i32)pos->charBoard[to_sq];
-
-        i32 fr_piece_i = pieceToIndex[fr_piece];
-        i32 to_piece_i = pieceToIndex[to_piece];
+        i32 fr_piece_i = pos->board[fr_sq];
+        i32 to_piece_i = pos->board[to_sq];
+        if(GET_FLAGS(move) == EP_CAPTURE) to_piece_i = PIECE_INDEX(PAWN, !(pos->flags & TURN_MASK));
 
         i32 phase = pos->stage; // Use to mimic phase from the stage
         if(phase) phase--;
@@ -125,27 +124,27 @@ void eval_movelist(Position* pos, Move* moveList, i32* moveVals, i32 size){
         switch(GET_FLAGS(move)){
             case QUEEN_PROMO_CAPTURE:
                 moveVals[i] += see(pos, to_sq, to_piece_i, fr_sq, fr_piece_i) + MoveQueenValue;
-                moveVals[i] += PST[phase][to_piece_i][to_sq];
+                moveVals[i] += phase_score(PST[to_piece_i][to_sq], phase);
                 break;
             case ROOK_PROMO_CAPTURE:
                 moveVals[i] += see(pos, to_sq, to_piece_i, fr_sq, fr_piece_i) + MoveRookValue;
-                moveVals[i] += PST[phase][to_piece_i][to_sq];
+                moveVals[i] += phase_score(PST[to_piece_i][to_sq], phase);
                 break;
             case BISHOP_PROMO_CAPTURE:
                 moveVals[i] += see(pos, to_sq, to_piece_i, fr_sq, fr_piece_i) + MoveBishopValue;
-                moveVals[i] += PST[phase][to_piece_i][to_sq];
+                moveVals[i] += phase_score(PST[to_piece_i][to_sq], phase);
                 break;
             case KNIGHT_PROMO_CAPTURE:
                 moveVals[i] += see(pos, to_sq, to_piece_i, fr_sq, fr_piece_i) + MoveKnightValue;
-                moveVals[i] += PST[phase][to_piece_i][to_sq];
+                moveVals[i] += phase_score(PST[to_piece_i][to_sq], phase);
                 break;
             case EP_CAPTURE:
-                moveVals[i] += see(pos, to_sq, ( WHITE_PAWN + ((pos->flags & TURN_MASK) * 6) ), fr_sq, fr_piece_i);
-                moveVals[i] += PST[phase][to_piece_i][to_sq];
+                moveVals[i] += see(pos, to_sq, to_piece_i, fr_sq, fr_piece_i);
+                moveVals[i] += phase_score(PST[to_piece_i][to_sq], phase);
                 break;
             case CAPTURE:
                 moveVals[i] += see(pos, to_sq, to_piece_i, fr_sq, fr_piece_i);
-                moveVals[i] += PST[phase][to_piece_i][to_sq];
+                moveVals[i] += phase_score(PST[to_piece_i][to_sq], phase);
                 break;
             default:
                 break;
@@ -158,32 +157,32 @@ void eval_movelist(Position* pos, Move* moveList, i32* moveVals, i32 size){
 static u64 least_valuable_attacker(Position* pos, u64 attadef, Turn turn, PieceIndex* piece){
     u64 subset = attadef & pos->pawn[turn]; // Pawn
     if (subset){
-        *piece = WHITE_PAWN + 6*turn;
+        *piece = PIECE_INDEX(PAWN, turn);
         return subset & (~subset + 1);
     }
     subset = attadef & pos->knight[turn]; // Knight
     if (subset){
-        *piece = WHITE_KNIGHT + 6*turn;
+        *piece = PIECE_INDEX(KNIGHT, turn);
         return subset & (~subset + 1);
     }
     subset = attadef & pos->bishop[turn]; // Bishops
     if (subset){
-        *piece = WHITE_BISHOP + 6*turn;
+        *piece = PIECE_INDEX(BISHOP, turn);
         return subset & (~subset + 1);
     }
     subset = attadef & pos->rook[turn]; // Rooks
     if (subset){
-        *piece = WHITE_ROOK + 6*turn;
+        *piece = PIECE_INDEX(ROOK, turn);
         return subset & (~subset + 1);
     }
     subset = attadef & pos->queen[turn]; // Queens
     if (subset){
-        *piece = WHITE_QUEEN + 6*turn;
+        *piece = PIECE_INDEX(QUEEN, turn);
         return subset & (~subset + 1);
     }
     subset = attadef & pos->king[turn]; // Kings
     if (subset){
-        *piece = WHITE_KING + 6*turn;
+        *piece = PIECE_INDEX(KING, turn);
         return subset & (~subset + 1);
     }
    return 0; // None were found
@@ -215,4 +214,193 @@ i32 see(Position* pos, u32 toSq, PieceIndex target, u32 frSq, PieceIndex aPiece)
         if(gain[d] >= -gain[d-1]) gain[d-1] = -gain[d];
     }
     return gain[0];
-}
\ No newline at end of file
+}
+
+/*
+ * Small per thread noise added to move scores in helper threads so each
+ * helper walks the tree in a slightly different order (0 for the main thread)
+ */
+static inline i32 helper_disorder(ThreadData* td, Move move){
+    if(!td->is_helper_thread) return 0;
+    u32 key = ((u32)move * 2654435761u) ^ (td->thread_num * 0x9E3779B9u);
+    key ^= key >> 15;
+    u32 range = HELPER_MOVE_DISORDER * (1 + td->thread_num % HELPER_THREAD_DISORDER) * 10;
+    return (i32)(key % range);
+}
+
+/*
+ * Moves the highest valued move in [start, end) to start
+ */
+static inline void pick_best(MovePicker* mp, u16 start, u16 end){
+    u16 maxIdx = start;
+    for(u16 j = start + 1; j < end; j++){
+        if(mp->vals[j] > mp->vals[maxIdx]) maxIdx = j;
+    }
+    if(maxIdx != start){
+        i32 tempVal = mp->vals[start];
+        mp->vals[start] = mp->vals[maxIdx];
+        mp->vals[maxIdx] = tempVal;
+
+        Move tempMove = mp->moves[start];
+        mp->moves[start] = mp->moves[maxIdx];
+        mp->moves[maxIdx] = tempMove;
+    }
+}
+
+/*
+ * Scores the captures and promotions of moveList into the front of the picker and the quiets after them,
+ * leaving out the TT move which has already been searched. Quiets are scored once reached
+ */
+static void add_picker_moves(MovePicker* mp, ThreadData* td, Move* moveList, u16 size){
+    u16 captures = 0, quiets = 0;
+    for(u16 i = 0; i < size; i++){
+        if(moveList[i] != mp->tt_move && (GET_FLAGS(moveList[i]) & (CAPTURE | PROMOTION))) captures++;
+    }
+    for(u16 i = 0; i < size; i++){
+        Move move = moveList[i];
+        if(move == mp->tt_move) continue;
+        if(GET_FLAGS(move) & (CAPTURE | PROMOTION)){
+            mp->vals[mp->size] = eval_move(move, &td->pos) + helper_disorder(td, move);
+            mp->moves[mp->size++] = move;
+        } else {
+            mp->moves[captures + quiets++] = move;
+        }
+    }
+    mp->quiet_start = captures;
+    mp->quiet_idx = captures;
+    mp->size = captures + quiets;
+}
+
+/*
+ * Generates the captures and promotions, or every legal move in check or with a pinned piece
+ */
+static void generate_picker_moves(MovePicker* mp, ThreadData* td){
+    Move moveList[MAX_MOVES];
+    Position* pos = &td->pos;
+    mp->quiets_generated = (pos->flags & IN_CHECK) || (get_pinned(pos) & pos->color[pos->flags & TURN_MASK]);
+    u16 size = mp->quiets_generated ? generateLegalMoves(pos, moveList) : generateNoisyMoves(pos, moveList);
+
+    #ifdef DEBUG
+    u8 tt_found = mp->tt_move == NO_MOVE;
+    Move legalList[MAX_MOVES];
+    u16 legal_size = generateLegalMoves(pos, legalList);
+    for(u16 i = 0; i < legal_size; i++) if(legalList[i] == mp->tt_move) tt_found = TRUE;
+    if(!tt_found){
+        printf("TT move was searched but is not a legal move: ");
+        printMove(mp->tt_move);
+        printPosition(td->pos, TRUE);
+        while(1);
+    }
+    #endif
+
+    add_picker_moves(mp, td, moveList, size);
+}
+
+/*
+ * Appends the quiets once the good captures are used up
+ */
+static void generate_picker_quiets(MovePicker* mp, ThreadData* td){
+    Move moveList[MAX_MOVES];
+    u16 size = generateQuietMoves(&td->pos, moveList);
+    for(u16 i = 0; i < size; i++){
+        if(moveList[i] != mp->tt_move) mp->moves[mp->size++] = moveList[i];
+    }
+    mp->quiets_generated = TRUE;
+
+    #ifdef DEBUG
+    Move legalList[MAX_MOVES];
+    if(generateLegalMoves(&td->pos, legalList) != mp->size + (mp->tt_move != NO_MOVE)){
+        printf("Captures and quiets do not add up to the legal moves\n");
+        printPosition(td->pos, TRUE);
+        while(1);
+    }
+    #endif
+}
+
+/*
+ * Sets up the picker for a node, tt_move may be NO_MOVE
+ */
+void init_move_picker(MovePicker* mp, Move tt_move, u8 ply){
+    mp->tt_move = tt_move;
+    mp->stage = PICK_TT_MOVE;
+    mp->ply = ply;
+    mp->killer = 0;
+    mp->size = 0;
+    mp->quiet_start = 0;
+    mp->capture_idx = 0;
+    mp->quiet_idx = 0;
+    mp->quiets_generated = FALSE;
+}
+
+/*
+ * Returns the next move to search and its ordering value, NO_MOVE once every move has been handed out.
+ * Order: TT move, captures that don't lose material, killers, losing captures, then quiets
+ */
+Move next_move(MovePicker* mp, ThreadData* td, i32* value){
+    Position* pos = &td->pos;
+    switch(mp->stage){
+        case PICK_TT_MOVE:
+            mp->stage = PICK_GEN_MOVES;
+            if(is_pseudo_legal(pos, mp->tt_move)){
+                *value = TT_MOVE_BONUS;
+                return mp->tt_move;
+            }
+            mp->tt_move = NO_MOVE;
+            // fall through
+        case PICK_GEN_MOVES:
+            generate_picker_moves(mp, td);
+            mp->stage = PICK_GOOD_CAPTURES;
+            // fall through
+        case PICK_GOOD_CAPTURES:
+            if(mp->capture_idx < mp->quiet_start){
+                pick_best(mp, mp->capture_idx, mp->quiet_start);
+                if(mp->vals[mp->capture_idx] >= 0){
+                    *value = mp->vals[mp->capture_idx] + CAPTURE_MOVE_BONUS;
+                    return mp->moves[mp->capture_idx++];
+                }
+            }
+            // Killers are quiets, and the move count LMR uses should include all of them
+            if(!mp->quiets_generated) generate_picker_quiets(mp, td);
+            mp->stage = PICK_KILLERS;
+            // fall through
+        case PICK_KILLERS:
+            // Killers are only played if they are in the quiet list, which also makes sure they are legal
+            while(mp->killer < KMV_CNT){
+                Move killer = td->km.table[mp->ply][mp->killer++];
+                if(killer == NO_MOVE) continue;
+                for(u16 j = mp->quiet_idx; j < mp->size; j++){
+                    if(mp->moves[j] != killer) continue;
+                    mp->moves[j] = mp->moves[mp->quiet_idx];
+                    mp->moves[mp->quiet_idx] = killer;
+                    mp->vals[mp->quiet_idx] = eval_move(killer, pos) + helper_disorder(td, killer);
+                    *value = mp->vals[mp->quiet_idx] + KILLER_MOVE_BONUS;
+                    return mp->moves[mp->quiet_idx++];
+                }
+            }
+            mp->stage = PICK_BAD_CAPTURES;
+            // fall through
+        case PICK_BAD_CAPTURES:
+            // Losing captures still go before the quiets, they are never reduced so
+            // pushing them to the end costs more than it saves
+            if(mp->capture_idx < mp->quiet_start){
+                pick_best(mp, mp->capture_idx, mp->quiet_start);
+                *value = mp->vals[mp->capture_idx] + CAPTURE_MOVE_BONUS;
+                return mp->moves[mp->capture_idx++];
+            }
+            for(u16 j = mp->quiet_idx; j < mp->size; j++){
+                mp->vals[j] = eval_move(mp->moves[j], pos) + helper_disorder(td, mp->moves[j]);
+            }
+            mp->stage = PICK_QUIETS;
+            // fall through
+        case PICK_QUIETS:
+            if(mp->quiet_idx < mp->size){
+                pick_best(mp, mp->quiet_idx, mp->size);
+                *value = mp->vals[mp->quiet_idx];
+                return mp->moves[mp->quiet_idx++];
+            }
+            mp->stage = PICK_DONE;
+            // fall through
+        default:
+            return NO_MOVE;
+    }
+}
@@ -1,6 +1,43 @@
 #pragma once
 #include "types.h"
 
+#define TT_MOVE_BONUS       3000000 // Bonus for move being in the TT
+#define CAPTURE_MOVE_BONUS  2000000 // Bonus for move being a capture
+#define KILLER_MOVE_BONUS   1000000 // Bonus for move being killer move
+
+typedef enum {
+    PICK_TT_MOVE,
+    PICK_GEN_MOVES,
+    PICK_GOOD_CAPTURES,
+    PICK_KILLERS,
+    PICK_BAD_CAPTURES,
+    PICK_QUIETS,
+    PICK_DONE
+} PickStage;
+
+/*
+ * Hands out the moves of a node one at a time, the TT move is tried before
+ * any moves are generated so a cutoff on it skips generation entirely.
+ * Captures sit at the front of the list and quiets after them, out of check
+ * with no pinned pieces the quiets are only generated once the good captures run out
+ */
+typedef struct {
+    Move moves[MAX_MOVES];
+    i32  vals[MAX_MOVES];
+    Move tt_move;
+    PickStage stage;
+    u8  ply;
+    u8  killer;      // Next killer slot to try
+    u16 size;        // Number of moves generated
+    u16 quiet_start; // Index of the first quiet move
+    u16 capture_idx; // Next capture to pick, bad captures start here once good ones run out
+    u16 quiet_idx;   // Next quiet move to pick
+    u8  quiets_generated;
+} MovePicker;
+
 i32 eval_move(Move move, Position* pos);
 i32 see(Position* pos, u32 toSq, PieceIndex target, u32 frSq, PieceIndex aPiece);
-void eval_movelist(Position* pos, Move* moveList, i32* moveVals, i32 size);
\ No newline at end of file
+void eval_movelist(Position* pos, Move* moveList, i32* moveVals, i32 size);
+
+void init_move_picker(MovePicker* mp, Move tt_move, u8 ply);
+Move next_move(MovePicker* mp, ThreadData* td, i32* value);
@@ -17,6 +17,8 @@ static const i8  NULL_PRUNE_R           = 3;    // How much null pruning reduces
 static const i32 NMR_MARGIN             = 2000; // Threshold for applying null move pruning
 static const u32 HELPER_MOVE_DISORDER   = 3;    // Degree of move ordering disruption in helper searches
 static const u32 HELPER_THREAD_DISORDER = 3;    // How differently each helper thread searches from one another
+static const u32 HELPER_DEPTH_OFFSETS   = 3;    // Helper threads start this many different depths ahead of the main thread
+static const u32 STOP_POLL_NODES        = 1024; // Nodes searched between checks of the stop flag
 static const i32 DeltaValue             = 750;  // Difference for delta pruning in Q search
 static const i32 EarlyDeltaValue        = 9000; // Difference for delta pruning in Q search before move is made
 static const i32 PromotionBuffer        = 9000; // What to add to delta pruning in case move is a promotion move
@@ -26,8 +28,14 @@ static const u32 END_GAME_PIECES        = 16;   // Pieces left to count as late
 /**
  * Search Parameters
  */
-static const real64 SEARCH_REDUCTION_LEVEL = 0.75; // How much time is reduced when search finds move to reduce time on
-static const real64 SEARCH_EXTENSION_LEVEL = 1.5;  // How much time is expanded when search finds move to extend time on
+static const real64 SEARCH_EXTENSION_LEVEL = 1.5;  // How much time is expanded when the last iteration failed low
+static const i64    TM_MOVE_HORIZON        = 30;   // Moves the remaining clock is spread over without movestogo
+static const i64    TM_MAX_SCALE           = 5;    // Hard budget as a multiple of the optimum budget
+static const real64 TM_MAX_SHARE           = 0.8;  // Most of the remaining clock one move can use
+static const real64 TM_STABILITY_BASE      = 1.3;  // Optimum scale with a best move that just changed
+static const real64 TM_STABILITY_STEP      = 0.1;  // Scale removed for each depth the best move stays the same
+static const real64 TM_STABILITY_MIN       = 0.7;  // Smallest stability scale
+static const real64 TM_NODE_SHARE_BASE     = 1.6;  // Optimum scale is this minus the best move's share of root nodes
 
 /**
  * Move Ordering Parameters
@@ -51,353 +59,210 @@ static const i32 QueenValue  =  10000;
 static const i32 KingValue   = 100000;
 
 /* Piece-Square Tables */
-static const i32 PST[2][12][64] = {
-    [PHASE_MG] = {
-        [WHITE_PAWN] = {
-             0,   0,   0,   0,   0,   0,   0,   0,
-            10,   0,   0, -10, -10,   0,   0,  10,
-            10,  20,  20,  20,  20,  20,  20,  10,
-             0,  10,  10,  30,  30,  10,  10,   0,
-             0,   0,   0,  30,  30,   0,   0,   0,
-            30,  30,  30,  40,  40,  30,  30,  30,
-            90,  90,  90,  90,  90,  90,  90,  90,
-             0,   0,   0,   0,   0,   0,   0,   0
-        },
-        [BLACK_PAWN] = {
-             0,   0,   0,   0,   0,   0,   0,   0,
-            90,  90,  90,  90,  90,  90,  90,  90,
-            30,  30,  30,  40,  40,  30,  30,  30,
-             0,   0,   0,  30,  30,   0,   0,   0,
-             0,  10,  10,  30,  30,  10,  10,   0,
-            10,  20,  20,  20,  20,  20,  20,  10,
-            10,   0,   0, -10, -10,   0,   0,  10,
-             0,   0,   0,   0,   0,   0,   0,   0
-        },
-        [WHITE_KNIGHT] = {
-           -50, -40, -30, -30, -30, -30, -40, -50,
-           -40, -20,   0,   0,   0,   0, -20, -40,
-           -30,   0,  10,  10,  10,  10,   0, -30,
-           -30,   0,  10,  20,  20,  10,   0, -30,
-           -30,   0,  10,  20,  20,  10,   0, -30,
-           -30,   0,  10,  10,  10,  10,   0, -30,
-           -40, -20,   0,   0,   0,   0, -20, -40,
-           -50, -40, -30, -30, -30, -30, -40, -50
-        },
-        [BLACK_KNIGHT] = {
-           -50, -40, -30, -30, -30, -30, -40, -50,
-           -40, -20,   0,   0,   0,   0, -20, -40,
-           -30,   0,  10,  10,  10,  10,   0, -30,
-           -30,   0,  10,  20,  20,  10,   0, -30,
-           -30,   0,  10,  20,  20,  10,   0, -30,
-           -30,   0,  10,  10,  10,  10,   0, -30,
-           -40, -20,   0,   0,   0,   0, -20, -40,
-           -50, -40, -30, -30, -30, -30, -40, -50
-        },
-        [WHITE_BISHOP] = {
-            10, -10, -10, -10, -10, -10, -10,  10,
-           -10,  10,   0,   0,   0,   0,  10, -10,
-           -10,   0,  10,  20,  20,  10,   0, -10,
-           -10,   0,  10,  20,  20,  10,   0, -10,
-           -10,   0,  20,  20,  20,  20,   0, -10,
-           -10,  20,  20,  20,  20,  20,  20, -10,
-           -10,  10,   0,   0,   0,   0,  10, -10,
-            10, -10, -10, -10, -10, -10, -10,  10
-        },
-        [BLACK_BISHOP] = {
-            10, -10, -10, -10, -10, -10, -10,  10,
-           -10,  10,   0,   0,   0,   0,  10, -10,
-           -10,   0,  20,  20,  20,  20,   0, -10,
-           -10,   0,  10,  20,  20,  10,   0, -10,
-           -10,   0,  10,  20,  20,  10,   0, -10,
-           -10,   0,  10,  20,  20,  10,   0, -10,
-           -10,  10,   0,   0,   0,   0,  10, -10,
-            10, -10, -10, -10, -10, -10, -10,  10
-        },
-        [WHITE_ROOK] = {
-             0,   0,   0,  10,  10,   0,   0,   0,
-             0,   0,   0,   0,   0,   0,   0,   0,
-             0,   0,   0,   0,   0,   0,   0,   0,
-             0,   0,   0,   0,   0,   0,   0,   0,
-             0,   0,   0,   0,   0,   0,   0,   0,
-             0,   0,   0,   0,   0,   0,   0,   0,
-            10,  20,  20,  20,  20,  20,  20,  10,
-             0,   0,   0,   0,   0,   0,   0,   0
-        },
-        [BLACK_ROOK] = {
-             0,   0,   0,   0,   0,   0,   0,   0,
-            10,  20,  20,  20,  20,  20,  20,  10,
-             0,   0,   0,   0,   0,   0,   0,   0,
-             0,   0,   0,   0,   0,   0,   0,   0,
-             0,   0,   0,   0,   0,   0,   0,   0,
-             0,   0,   0,   0,   0,   0,   0,   0,
-             0,   0,   0,  10,  10,   0,   0,   0,
-             0,   0,   0,   0,   0,   0,   0,   0
-        },
-        [WHITE_QUEEN] = {
-           -20, -10, -10, -10, -10, -10, -10, -20,
-           -10,   0,   0,   0,   0,   0,   0, -10,
-           -10,   0,  10,  10,  10,  10,   0, -10,
-           -10,   0,  10,  20,  20,  10,   0, -10,
-           -10,   0,  10,  20,  20,  10,   0, -10,
-           -10,  10,  10,  10,  10,  10,  10, -10,
-           -10,   0,  10,   0,   0,  10,   0, -10,
-           -20, -10, -10, -10, -10, -10, -10, -20
-        },
-        [BLACK_QUEEN] = {
-           -20, -10, -10, -10, -10, -10, -10, -20,
-           -10,   0,  10,   0,   0,  10,   0, -10,
-           -10,  10,  10,  10,  10,  10,  10, -10,
-           -10,   0,  10,  20,  20,  10,   0, -10,
-           -10,   0,  10,  20,  20,  10,   0, -10,
-           -10,   0,  10,  10,  10,  10,   0, -10,
-           -10,   0,   0,   0,   0,   0,   0, -10,
-           -20, -10, -10, -10, -10, -10, -10, -20
-        },
-        [WHITE_KING] = {
-            30,  40,  10,   0,   0,  10,  40,  30,
-            10,  10, -10, -10, -10, -10,  10,  10,
-           -10, -20, -20, -50, -50, -20, -20, -10,
-           -20, -50, -50, -90, -90, -50, -50, -20,
-           -30, -50, -50, -90, -90, -50, -50, -30,
-           -30, -40, -40, -50, -50, -40, -40, -30,
-           -30, -40, -40, -50, -50, -40, -40, -30,
-           -30, -40, -40, -50, -50, -40, -40, -30
-        },
-        [BLACK_KING] = {
-           -30, -40, -40, -50, -50, -40, -40, -30,
-           -30, -40, -40, -50, -50, -40, -40, -30,
-           -30, -40, -40, -50, -50, -40, -40, -30,
-           -30, -50, -50, -90, -90, -50, -50, -30,
-           -20, -50, -50, -90, -90, -50, -50, -20,
-           -10, -20, -20, -50, -50, -20, -20, -10,
-            10,  10, -10, -10, -10, -10,  10,  10,
-            30,  40,  10,   0,   0,  10,  40,  30
-        }
+static const Score PST[12][64] = {
+    [WHITE_PAWN] = {
+        S(  0,   0), S(  0,   0), S(  0,   0), S(  0,   0), S(  0,   0), S(  0,   0), S(  0,   0), S(  0,   0),
+        S( 10, -10), S(  0, -10), S(  0, -10), S(-10, -10), S(-10, -10), S(  0, -10), S(  0, -10), S( 10, -10),
+        S( 10,  -5), S( 20,  -5), S( 20,  -5), S( 20,  -5), S( 20,  -5), S( 20,  -5), S( 20,  -5), S( 10,  -5),
+        S(  0,   0), S( 10,   0), S( 10,   0), S( 30,   0), S( 30,   0), S( 10,   0), S( 10,   0), S(  0,   0),
+        S(  0,  30), S(  0,  30), S(  0,  30), S( 30,  30), S( 30,  30), S(  0,  30), S(  0,  30), S(  0,  30),
+        S( 30,  70), S( 30,  70), S( 30,  70), S( 40,  70), S( 40,  70), S( 30,  70), S( 30,  70), S( 30,  70),
+        S( 90,  90), S( 90,  90), S( 90,  90), S( 90,  90), S( 90,  90), S( 90,  90), S( 90,  90), S( 90,  90),
+        S(  0,   0), S(  0,   0), S(  0,   0), S(  0,   0), S(  0,   0), S(  0,   0), S(  0,   0), S(  0,   0)
+    },
+    [BLACK_PAWN] = {
+        S(  0,   0), S(  0,   0), S(  0,   0), S(  0,   0), S(  0,   0), S(  0,   0), S(  0,   0), S(  0,   0),
+        S( 90,  90), S( 90,  90), S( 90,  90), S( 90,  90), S( 90,  90), S( 90,  90), S( 90,  90), S( 90,  90),
+        S( 30,  70), S( 30,  70), S( 30,  70), S( 40,  70), S( 40,  70), S( 30,  70), S( 30,  70), S( 30,  70),
+        S(  0,  30), S(  0,  30), S(  0,  30), S( 30,  30), S( 30,  30), S(  0,  30), S(  0,  30), S(  0,  30),
+        S(  0,   0), S( 10,   0), S( 10,   0), S( 30,   0), S( 30,   0), S( 10,   0), S( 10,   0), S(  0,   0),
+        S( 10,  -5), S( 20,  -5), S( 20,  -5), S( 20,  -5), S( 20,  -5), S( 20,  -5), S( 20,  -5), S( 10,  -5),
+        S( 10, -10), S(  0, -10), S(  0, -10), S(-10, -10), S(-10, -10), S(  0, -10), S(  0, -10), S( 10, -10),
+        S(  0,   0), S(  0,   0), S(  0,   0), S(  0,   0), S(  0,   0), S(  0,   0), S(  0,   0), S(  0,   0)
+    },
+    [WHITE_KNIGHT] = {
+        S(-50, -50), S(-40, -40), S(-30, -30), S(-30, -30), S(-30, -30), S(-30, -30), S(-40, -40), S(-50, -50),
+        S(-40, -40), S(-20, -20), S(  0,   0), S(  0,   0), S(  0,   0), S(  0,   0), S(-20, -20), S(-40, -40),
+        S(-30, -30), S(  0,   0), S( 10,  10), S( 10,  10), S( 10,  10), S( 10,  10), S(  0,   0), S(-30, -30),
+        S(-30, -30), S(  0,   0), S( 10,  10), S( 20,  20), S( 20,  20), S( 10,  10), S(  0,   0), S(-30, -30),
+        S(-30, -30), S(  0,   0), S( 10,  10), S( 20,  20), S( 20,  20), S( 10,  10), S(  0,   0), S(-30, -30),
+        S(-30, -30), S(  0,   0), S( 10,  10), S( 10,  10), S( 10,  10), S( 10,  10), S(  0,   0), S(-30, -30),
+        S(-40, -40), S(-20, -20), S(  0,   0), S(  0,   0), S(  0,   0), S(  0,   0), S(-20, -20), S(-40, -40),
+        S(-50, -50), S(-40, -40), S(-30, -30), S(-30, -30), S(-30, -30), S(-30, -30), S(-40, -40), S(-50, -50)
+    },
+    [BLACK_KNIGHT] = {
+        S(-50, -50), S(-40, -40), S(-30, -30), S(-30, -30), S(-30, -30), S(-30, -30), S(-40, -40), S(-50, -50),
+        S(-40, -40), S(-20, -20), S(  0,   0), S(  0,   0), S(  0,   0), S(  0,   0), S(-20, -20), S(-40, -40),
+        S(-30, -30), S(  0,   0), S( 10,  10), S( 10,  10), S( 10,  10), S( 10,  10), S(  0,   0), S(-30, -30),
+        S(-30, -30), S(  0,   0), S( 10,  10), S( 20,  20), S( 20,  20), S( 10,  10), S(  0,   0), S(-30, -30),
+        S(-30, -30), S(  0,   0), S( 10,  10), S( 20,  20), S( 20,  20), S( 10,  10), S(  0,   0), S(-30, -30),
+        S(-30, -30), S(  0,   0), S( 10,  10), S( 10,  10), S( 10,  10), S( 10,  10), S(  0,   0), S(-30, -30),
+        S(-40, -40), S(-20, -20), S(  0,   0), S(  0,   0), S(  0,   0), S(  0,   0), S(-20, -20), S(-40, -40),
+        S(-50, -50), S(-40, -40), S(-30, -30), S(-30, -30), S(-30, -30), S(-30, -30), S(-40, -40), S(-50, -50)
+    },
+    [WHITE_BISHOP] = {
+        S( 10,  20), S(-10, -10), S(-10, -10), S(-10, -10), S(-10, -10), S(-10, -10), S(-10, -10), S( 10,  20),
+        S(-10, -10), S( 10,  20), S(  0,   0), S(  0,   0), S(  0,   0), S(  0,   0), S( 10,  20), S(-10, -10),
+        S(-10, -10), S(  0,   0), S( 10,  20), S( 20,  10), S( 20,  10), S( 10,  20), S(  0,   0), S(-10, -10),
+        S(-10, -10), S(  0,   0), S( 10,  10), S( 20,  20), S( 20,  20), S( 10,  10), S(  0,   0), S(-10, -10),
+        S(-10, -10), S(  0,   0), S( 20,  10), S( 20,  20), S( 20,  20), S( 20,  10), S(  0,   0), S(-10, -10),
+        S(-10, -10), S( 20,   0), S( 20,  20), S( 20,  10), S( 20,  10), S( 20,  20), S( 20,   0), S(-10, -10),
+        S(-10, -10), S( 10,  20), S(  0,   0), S(  0,   0), S(  0,   0), S(  0,   0), S( 10,  20), S(-10, -10),
+        S( 10,  20), S(-10, -10), S(-10, -10), S(-10, -10), S(-10, -10), S(-10, -10), S(-10, -10), S( 10,  20)
+    },
+    [BLACK_BISHOP] = {
+        S( 10,  20), S(-10, -10), S(-10, -10), S(-10, -10), S(-10, -10), S(-10, -10), S(-10, -10), S( 10,  20),
+        S(-10, -10), S( 10,  20), S(  0,   0), S(  0,   0), S(  0,   0), S(  0,   0), S( 10,  20), S(-10, -10),
+        S(-10, -10), S(  0,   0), S( 20,  20), S( 20,  10), S( 20,  10), S( 20,  20), S(  0,   0), S(-10, -10),
+        S(-10, -10), S(  0,   0), S( 10,  10), S( 20,  20), S( 20,  20), S( 10,  10), S(  0,   0), S(-10, -10),
+        S(-10, -10), S(  0,   0), S( 10,  10), S( 20,  20), S( 20,  20), S( 10,  10), S(  0,   0), S(-10, -10),
+        S(-10, -10), S(  0,   0), S( 10,  20), S( 20,  10), S( 20,  10), S( 10,  20), S(  0,   0), S(-10, -10),
+        S(-10, -10), S( 10,  20), S(  0,   0), S(  0,   0), S(  0,   0), S(  0,   0), S( 10,  20), S(-10, -10),
+        S( 10,  20), S(-10, -10), S(-10, -10), S(-10, -10), S(-10, -10), S(-10, -10), S(-10, -10), S( 10,  20)
+    },
+    [WHITE_ROOK] = {
+        S( 0, 0), S( 0, 0), S( 0, 0), S(10, 0), S(10, 0), S( 0, 0), S( 0, 0), S( 0, 0),
+        S( 0, 0), S( 0, 0), S( 0, 0), S( 0, 0), S( 0, 0), S( 0, 0), S( 0, 0), S( 0, 0),
+        S( 0, 0), S( 0, 0), S( 0, 0), S( 0, 0), S( 0, 0), S( 0, 0), S( 0, 0), S( 0, 0),
+        S( 0, 0), S( 0, 0), S( 0, 0), S( 0, 0), S( 0, 0), S( 0, 0), S( 0, 0), S( 0, 0),
+        S( 0, 0), S( 0, 0), S( 0, 0), S( 0, 0), S( 0, 0), S( 0, 0), S( 0, 0), S( 0, 0),
+        S( 0, 0), S( 0, 0), S( 0, 0), S( 0, 0), S( 0, 0), S( 0, 0), S( 0, 0), S( 0, 0),
+        S(10, 0), S(20, 0), S(20, 0), S(20, 0), S(20, 0), S(20, 0), S(20, 0), S(10, 0),
+        S( 0, 0), S( 0, 0), S( 0, 0), S( 0, 0), S( 0, 0), S( 0, 0), S( 0, 0), S( 0, 0)
+    },
+    [BLACK_ROOK] = {
+        S( 0, 0), S( 0, 0), S( 0, 0), S( 0, 0), S( 0, 0), S( 0, 0), S( 0, 0), S( 0, 0),
+        S(10, 0), S(20, 0), S(20, 0), S(20, 0), S(20, 0), S(20, 0), S(20, 0), S(10, 0),
+        S( 0, 0), S( 0, 0), S( 0, 0), S( 0, 0), S( 0, 0), S( 0, 0), S( 0, 0), S( 0, 0),
+        S( 0, 0), S( 0, 0), S( 0, 0), S( 0, 0), S( 0, 0), S( 0, 0), S( 0, 0), S( 0, 0),
+        S( 0, 0), S( 0, 0), S( 0, 0), S( 0, 0), S( 0, 0), S( 0, 0), S( 0, 0), S( 0, 0),
+        S( 0, 0), S( 0, 0), S( 0, 0), S( 0, 0), S( 0, 0), S( 0, 0), S( 0, 0), S( 0, 0),
+        S( 0, 0), S( 0, 0), S( 0, 0), S(10, 0), S(10, 0), S( 0, 0), S( 0, 0), S( 0, 0),
+        S( 0, 0), S( 0, 0), S( 0, 0), S( 0, 0), S( 0, 0), S( 0, 0), S( 0, 0), S( 0, 0)
+    },
+    [WHITE_QUEEN] = {
+        S(-20, -20), S(-10, -10), S(-10, -10), S(-10, -10), S(-10, -10), S(-10, -10), S(-10, -10), S(-20, -20),
+        S(-10, -10), S(  0,   0), S(  0,   0), S(  0,   0), S(  0,   0), S(  0,   0), S(  0,   0), S(-10, -10),
+        S(-10, -10), S(  0,   0), S( 10,   0), S( 10,   0), S( 10,   0), S( 10,   0), S(  0,   0), S(-10, -10),
+        S(-10, -10), S(  0,   0), S( 10,   0), S( 20,   0), S( 20,   0), S( 10,   0), S(  0,   0), S(-10, -10),
+        S(-10, -10), S(  0,   0), S( 10,   0), S( 20,   0), S( 20,   0), S( 10,   0), S(  0,   0), S(-10, -10),
+        S(-10, -10), S( 10,   0), S( 10,   0), S( 10,   0), S( 10,   0), S( 10,   0), S( 10,   0), S(-10, -10),
+        S(-10, -10), S(  0,   0), S( 10,   0), S(  0,   0), S(  0,   0), S( 10,   0), S(  0,   0), S(-10, -10),
+        S(-20, -20), S(-10, -10), S(-10, -10), S(-10, -10), S(-10, -10), S(-10, -10), S(-10, -10), S(-20, -20)
+    },
+    [BLACK_QUEEN] = {
+        S(-20, -20), S(-10, -10), S(-10, -10), S(-10, -10), S(-10, -10), S(-10, -10), S(-10, -10), S(-20, -20),
+        S(-10, -10), S(  0,   0), S( 10,   0), S(  0,   0), S(  0,   0), S( 10,   0), S(  0,   0), S(-10, -10),
+        S(-10, -10), S( 10,   0), S( 10,   0), S( 10,   0), S( 10,   0), S( 10,   0), S( 10,   0), S(-10, -10),
+        S(-10, -10), S(  0,   0), S( 10,   0), S( 20,   0), S( 20,   0), S( 10,   0), S(  0,   0), S(-10, -10),
+        S(-10, -10), S(  0,   0), S( 10,   0), S( 20,   0), S( 20,   0), S( 10,   0), S(  0,   0), S(-10, -10),
+        S(-10, -10), S(  0,   0), S( 10,   0), S( 10,   0), S( 10,   0), S( 10,   0), S(  0,   0), S(-10, -10),
+        S(-10, -10), S(  0,   0), S(  0,   0), S(  0,   0), S(  0,   0), S(  0,   0), S(  0,   0), S(-10, -10),
+        S(-20, -20), S(-10, -10), S(-10, -10), S(-10, -10), S(-10, -10), S(-10, -10), S(-10, -10), S(-20, -20)
+    },
+    [WHITE_KING] = {
+        S( 30,  30), S( 40,  40), S( 10,  10), S(  0,   0), S(  0,   0), S( 10,  10), S( 40,  40), S( 30,  30),
+        S( 10,  10), S( 10,  10), S(-10, -10), S(-10, -10), S(-10, -10), S(-10, -10), S( 10,  10), S( 10,  10),
+        S(-10, -10), S(-20, -20), S(-20, -20), S(-50, -50), S(-50, -50), S(-20, -20), S(-20, -20), S(-10, -10),
+        S(-20, -20), S(-50, -50), S(-50, -50), S(-90, -90), S(-90, -90), S(-50, -50), S(-50, -50), S(-20, -20),
+        S(-30, -30), S(-50, -50), S(-50, -50), S(-90, -90), S(-90, -90), S(-50, -50), S(-50, -50), S(-30, -30),
+        S(-30, -30), S(-40, -40), S(-40, -40), S(-50, -50), S(-50, -50), S(-40, -40), S(-40, -40), S(-30, -30),
+        S(-30, -30), S(-40, -40), S(-40, -40), S(-50, -50), S(-50, -50), S(-40, -40), S(-40, -40), S(-30, -30),
+        S(-30, -30), S(-40, -40), S(-40, -40), S(-50, -50), S(-50, -50), S(-40, -40), S(-40, -40), S(-30, -30)
+    },
+    [BLACK_KING] = {
+        S(-30, -30), S(-40, -40), S(-40, -40), S(-50, -50), S(-50, -50), S(-40, -40), S(-40, -40), S(-30, -30),
+        S(-30, -30), S(-40, -40), S(-40, -40), S(-50, -50), S(-50, -50), S(-40, -40), S(-40, -40), S(-30, -30),
+        S(-30, -30), S(-40, -40), S(-40, -40), S(-50, -50), S(-50, -50), S(-40, -40), S(-40, -40), S(-30, -30),
+        S(-30, -30), S(-50, -50), S(-50, -50), S(-90, -90), S(-90, -90), S(-50, -50), S(-50, -50), S(-30, -30),
+        S(-20, -20), S(-50, -50), S(-50, -50), S(-90, -90), S(-90, -90), S(-50, -50), S(-50, -50), S(-20, -20),
+        S(-10, -10), S(-20, -20), S(-20, -20), S(-50, -50), S(-50, -50), S(-20, -20), S(-20, -20), S(-10, -10),
+        S( 10,  10), S( 10,  10), S(-10, -10), S(-10, -10), S(-10, -10), S(-10, -10), S( 10,  10), S( 10,  10),
+        S( 30,  30), S( 40,  40), S( 10,  10), S(  0,   0), S(  0,   0), S( 10,  10), S( 40,  40), S( 30,  30)
     },
-    [PHASE_EG] = {
-        [WHITE_PAWN] = {
-             0,   0,   0,   0,   0,   0,   0,   0,
-           -10, -10, -10, -10, -10, -10, -10, -10,
-            -5,  -5,  -5,  -5,  -5,  -5,  -5,  -5,
-             0,   0,   0,   0,   0,   0,   0,   0,
-            30,  30,  30,  30,  30,  30,  30,  30,
-            70,  70,  70,  70,  70,  70,  70,  70,
-            90,  90,  90,  90,  90,  90,  90,  90,
-             0,   0,   0,   0,   0,   0,   0,   0
-        },
-        [BLACK_PAWN] = {
-             0,   0,   0,   0,   0,   0,   0,   0,
-            90,  90,  90,  90,  90,  90,  90,  90,
-            70,  70,  70,  70,  70,  70,  70,  70,
-            30,  30,  30,  30,  30,  30,  30,  30,
-             0,   0,   0,   0,   0,   0,   0,   0,
-            -5,  -5,  -5,  -5,  -5,  -5,  -5,  -5,
-           -10, -10, -10, -10, -10, -10, -10, -10,
-             0,   0,   0,   0,   0,   0,   0,   0
-        },
-        [WHITE_KNIGHT] = {
-           -50, -40, -30, -30, -30, -30, -40, -50,
-           -40, -20,   0,   0,   0,   0, -20, -40,
-           -30,   0,  10,  10,  10,  10,   0, -30,
-           -30,   0,  10,  20,  20,  10,   0, -30,
-           -30,   0,  10,  20,  20,  10,   0, -30,
-           -30,   0,  10,  10,  10,  10,   0, -30,
-           -40, -20,   0,   0,   0,   0, -20, -40,
-           -50, -40, -30, -30, -30, -30, -40, -50
-        },
-        [BLACK_KNIGHT] = {
-           -50, -40, -30, -30, -30, -30, -40, -50,
-           -40, -20,   0,   0,   0,   0, -20, -40,
-           -30,   0,  10,  10,  10,  10,   0, -30,
-           -30,   0,  10,  20,  20,  10,   0, -30,
-           -30,   0,  10,  20,  20,  10,   0, -30,
-           -30,   0,  10,  10,  10,  10,   0, -30,
-           -40, -20,   0,   0,   0,   0, -20, -40,
-           -50, -40, -30, -30, -30, -30, -40, -50
-        },
-        [WHITE_BISHOP] = {
-            20, -10, -10, -10, -10, -10, -10,  20,
-           -10,  20,   0,   0,   0,   0,  20, -10,
-           -10,   0,  20,  10,  10,  20,   0, -10,
-           -10,   0,  10,  20,  20,  10,   0, -10,
-           -10,   0,  10,  20,  20,  10,   0, -10,
-           -10,   0,  20,  10,  10,  20,   0, -10,
-           -10,  20,   0,   0,   0,   0,  20, -10,
-            20, -10, -10, -10, -10, -10, -10,  20
-        },
-        [BLACK_BISHOP] = {
-            20, -10, -10, -10, -10, -10, -10,  20,
-           -10,  20,   0,   0,   0,   0,  20, -10,
-           -10,   0,  20,  10,  10,  20,   0, -10,
-           -10,   0,  10,  20,  20,  10,   0, -10,
-           -10,   0,  10,  20,  20,  10,   0, -10,
-           -10,   0,  20,  10,  10,  20,   0, -10,
-           -10,  20,   0,   0,   0,   0,  20, -10,
-            20, -10, -10, -10, -10, -10, -10,  20
-        },
-        [WHITE_ROOK] = {
-             0,   0,   0,   0,   0,   0,   0,   0,
-             0,   0,   0,   0,   0,   0,   0,   0,
-             0,   0,   0,   0,   0,   0,   0,   0,
-             0,   0,   0,   0,   0,   0,   0,   0,
-             0,   0,   0,   0,   0,   0,   0,   0,
-             0,   0,   0,   0,   0,   0,   0,   0,
-             0,   0,   0,   0,   0,   0,   0,   0,
-             0,   0,   0,   0,   0,   0,   0,   0
-        },
-        [BLACK_ROOK] = {
-             0,   0,   0,   0,   0,   0,   0,   0,
-             0,   0,   0,   0,   0,   0,   0,   0,
-             0,   0,   0,   0,   0,   0,   0,   0,
-             0,   0,   0,   0,   0,   0,   0,   0,
-             0,   0,   0,   0,   0,   0,   0,   0,
-             0,   0,   0,   0,   0,   0,   0,   0,
-             0,   0,   0,   0,   0,   0,   0,   0,
-             0,   0,   0,   0,   0,   0,   0,   0
-        },
-        [WHITE_QUEEN] = {
-           -20, -10, -10, -10, -10, -10, -10, -20,
-           -10,   0,   0,   0,   0,   0,   0, -10,
-           -10,   0,   0,   0,   0,   0,   0, -10,
-           -10,   0,   0,   0,   0,   0,   0, -10,
-           -10,   0,   0,   0,   0,   0,   0, -10,
-           -10,   0,   0,   0,   0,   0,   0, -10,
-           -10,   0,   0,   0,   0,   0,   0, -10,
-           -20, -10, -10, -10, -10, -10, -10, -20
-        },
-        [BLACK_QUEEN] = {
-           -20, -10, -10, -10, -10, -10, -10, -20,
-           -10,   0,   0,   0,   0,   0,   0, -10,
-           -10,   0,   0,   0,   0,   0,   0, -10,
-           -10,   0,   0,   0,   0,   0,   0, -10,
-           -10,   0,   0,   0,   0,   0,   0, -10,
-           -10,   0,   0,   0,   0,   0,   0, -10,
-           -10,   0,   0,   0,   0,   0,   0, -10,
-           -20, -10, -10, -10, -10, -10, -10, -20
-        },
-        [WHITE_KING] = {
-            30,  40,  10,   0,   0,  10,  40,  30,
-            10,  10, -10, -10, -10, -10,  10,  10,
-           -10, -20, -20, -50, -50, -20, -20, -10,
-           -20, -50, -50, -90, -90, -50, -50, -20,
-           -30, -50, -50, -90, -90, -50, -50, -30,
-           -30, -40, -40, -50, -50, -40, -40, -30,
-           -30, -40, -40, -50, -50, -40, -40, -30,
-           -30, -40, -40, -50, -50, -40, -40, -30
-        },
-        [BLACK_KING] = {
-           -30, -40, -40, -50, -50, -40, -40, -30,
-           -30, -40, -40, -50, -50, -40, -40, -30,
-           -30, -40, -40, -50, -50, -40, -40, -30,
-           -30, -50, -50, -90, -90, -50, -50, -30,
-           -20, -50, -50, -90, -90, -50, -50, -20,
-           -10, -20, -20, -50, -50, -20, -20, -10,
-            10,  10, -10, -10, -10, -10,  10,  10,
-            30,  40,  10,   0,   0,  10,  40,  30
-        }
-    }
 };
 
 
 static const i32 KnightAdjust[9] = { -200, -160, -120, -80, -40,  0,  40,  80, 120 };
 static const i32   RookAdjust[9] = {  150,  120,   90,  60,  30,  0, -30, -60, -90 };
-static const i32 KingPawnDistancePenalty[2] = { -20, -200 };
-static const i32 OpenFileNearKingPenalty[2] = { -200, -100 };
-static const i32 VirtualMobility[2][28] = {
-    {
-        0,    0,    0,    0,    0,    0,    0,  -50, -100, -125, -150, -175,  -200,  -250,
-        -300, -350, -400, -500, -500, -500, -500, -500, -500, -500, -500,  -500, -500, -500,
-    },
-    {
-          0,    0,    0,    0,    0,    0,    0,  -5, -15, -20, -30, -40, -50, -60,
-        -70,  -70,  -70,  -70,  -70,  -70,  -70, -70, -70, -70, -70, -70, -70, -70,
-    },
+static const Score KingPawnDistancePenalty = S(-20, -200);
+static const Score OpenFileNearKingPenalty = S(-200, -100);
+static const Score VirtualMobility[28] = {
+    S(   0,   0), S(   0,   0), S(   0,   0), S(   0,   0), S(   0,   0), S(   0,   0), S(   0,   0),
+    S( -50,  -5), S(-100, -15), S(-125, -20), S(-150, -30), S(-175, -40), S(-200, -50), S(-250, -60),
+    S(-300, -70), S(-350, -70), S(-400, -70), S(-500, -70), S(-500, -70), S(-500, -70), S(-500, -70),
+    S(-500, -70), S(-500, -70), S(-500, -70), S(-500, -70), S(-500, -70), S(-500, -70), S(-500, -70)
 };
 
-static const i32 PawnsInKingArea[2][9] = {
-    {  -50, -10, 25,  20,  30,  30,  30,  30,  30 },
-    { -100, -50,  0,   0,   0,   0,   0,   0,   0 },
+static const Score PawnsInKingArea[9] = {
+    S(-50, -100), S(-10,  -50), S( 25,    0), S( 20,    0), S( 30,    0), S( 30,    0), S( 30,    0), S( 30,    0), S( 30,    0)
 };
 static const i32 ATTACK_UNIT_PAWN   = 2;
 static const i32 ATTACK_UNIT_KNIGHT = 2;
 static const i32 ATTACK_UNIT_BISHOP = 2;
 static const i32 ATTACK_UNIT_ROOK   = 5;
 static const i32 ATTACK_UNIT_QUEEN  = 6;
-static const i32 SafetyTable[2][100] = {
-    [PHASE_MG] =
-    {
-           0,    0,   10,   20,   30,   50,   70,   90,  120,  150,
-         180,  220,  260,  300,  350,  390,  440,  500,  560,  620,
-         680,  750,  820,  850,  890,  970, 1050, 1130, 1220, 1310,
-        1400, 1500, 1690, 1800, 1910, 2020, 2130, 2250, 2370, 2480,
-        2600, 2720, 2830, 2950, 3070, 3190, 3300, 3420, 3540, 3660,
-        3770, 3890, 4010, 4120, 4240, 4360, 4480, 4590, 4710, 4830,
-        4940, 5000, 5000, 5000, 5000, 5000, 5000, 5000, 5000, 5000,
-        5000, 5000, 5000, 5000, 5000, 5000, 5000, 5000, 5000, 5000,
-        5000, 5000, 5000, 5000, 5000, 5000, 5000, 5000, 5000, 5000,
-        5000, 5000, 5000, 5000, 5000, 5000, 5000, 5000, 5000, 5000
-    },
-    [PHASE_EG] =
-    {
-          0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   
-          0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   
-          0,   0,   0,   1,   1,   2,   3,   4,   5,   6,
-          8,  10,  13,  16,  20,  25,  30,  36,  42,  48,
-         55,  62,  70,  80,  90,  90,  90,  90,  90,  90,  
-         90,  90,  90,  90,  90,  90,  90,  90,  90,  90,  
-         90,  90,  90,  90,  90,  90,  90,  90,  90,  90,  
-         90,  90,  90,  90,  90,  90,  90,  90,  90,  90,  
-         90,  90,  90,  90,  90,  90,  90,  90,  90,  90,  
-         90,  90,  90,  90,  90,  90,  90,  90,  90,  90,
-    }
+static const Score SafetyTable[100] = {
+    S(   0,  0), S(   0,  0), S(  10,  0), S(  20,  0), S(  30,  0),
+    S(  50,  0), S(  70,  0), S(  90,  0), S( 120,  0), S( 150,  0),
+    S( 180,  0), S( 220,  0), S( 260,  0), S( 300,  0), S( 350,  0),
+    S( 390,  0), S( 440,  0), S( 500,  0), S( 560,  0), S( 620,  0),
+    S( 680,  0), S( 750,  0), S( 820,  0), S( 850,  1), S( 890,  1),
+    S( 970,  2), S(1050,  3), S(1130,  4), S(1220,  5), S(1310,  6),
+    S(1400,  8), S(1500, 10), S(1690, 13), S(1800, 16), S(1910, 20),
+    S(2020, 25), S(2130, 30), S(2250, 36), S(2370, 42), S(2480, 48),
+    S(2600, 55), S(2720, 62), S(2830, 70), S(2950, 80), S(3070, 90),
+    S(3190, 90), S(3300, 90), S(3420, 90), S(3540, 90), S(3660, 90),
+    S(3770, 90), S(3890, 90), S(4010, 90), S(4120, 90), S(4240, 90),
+    S(4360, 90), S(4480, 90), S(4590, 90), S(4710, 90), S(4830, 90),
+    S(4940, 90), S(5000, 90), S(5000, 90), S(5000, 90), S(5000, 90),
+    S(5000, 90), S(5000, 90), S(5000, 90), S(5000, 90), S(5000, 90),
+    S(5000, 90), S(5000, 90), S(5000, 90), S(5000, 90), S(5000, 90),
+    S(5000, 90), S(5000, 90), S(5000, 90), S(5000, 90), S(5000, 90),
+    S(5000, 90), S(5000, 90), S(5000, 90), S(5000, 90), S(5000, 90),
+    S(5000, 90), S(5000, 90), S(5000, 90), S(5000, 90), S(5000, 90),
+    S(5000, 90), S(5000, 90), S(5000, 90), S(5000, 90), S(5000, 90),
+    S(5000, 90), S(5000, 90), S(5000, 90), S(5000, 90), S(5000, 90)
 };
-static const i32 PawnHangingPenalty[2] = { -10, 0 };
-static const i32 DoubledPawnPenalty[2] = { -20, -200 };
-static const i32 IsolatedPawnPenalty[2] = { -50, -100 };
-static const i32 RammedPawnPenalty[2] = { -20, -100 };
-static const i32 PassedPawnBonus[2] = { 25, 500 };
-static const i32 ConnectedPawnBonus[2] = { 20, 60 };
-static const i32 KnightHangingPenalty[2] =  { -20, 0 };
-static const i32 KnightMobility[2][9] = 
-{
-    {  -104,  -45,  -22,  -8,  6,  11,  19,  30,  43 },
-    { -1040, -450, -220, -80, 60, 110, 190, 300, 430 }
+static const Score PawnHangingPenalty = S(-10, 0);
+static const Score DoubledPawnPenalty = S(-20, -200);
+static const Score IsolatedPawnPenalty = S(-50, -100);
+static const Score RammedPawnPenalty = S(-20, -100);
+static const Score PassedPawnBonus = S(25, 500);
+static const Score ConnectedPawnBonus = S(20, 60);
+static const Score KnightHangingPenalty = S(-20, 0);
+static const Score KnightMobility[9] = {
+    S(-104, -1040), S( -45,  -450), S( -22,  -220), S(  -8,   -80), S(   6,    60), S(  11,   110), S(  19,   190), S(  30,   300), S(  43,   430)
 };
 
-static const i32 OutpostKnightBonus[2] = { 50, 0 };
-static const i32 OutpostKnightExtraBonus[2] = { 100, 0 };
+static const Score OutpostKnightBonus = S(50, 0);
+static const Score OutpostKnightExtraBonus = S(100, 0);
 
-static const i32 BishopHangingPenalty[2] = { -10, 0 };
-static const i32 BishopMobility[2][14] = 
-{
-    {  -99,  -46,  -16,  -4,  6,  14,  17,  19,  19 , 27 , 26,  52,  55,  83 },
-    { -990, -460, -160, -40, 60, 140, 170, 190, 190, 270, 260, 520, 550, 830 },
+static const Score BishopHangingPenalty = S(-10, 0);
+static const Score BishopMobility[14] = {
+    S(-99, -990), S(-46, -460), S(-16, -160), S( -4,  -40), S(  6,   60), S( 14,  140), S( 17,  170),
+    S( 19,  190), S( 19,  190), S( 27,  270), S( 26,  260), S( 52,  520), S( 55,  550), S( 83,  830)
 };
-static const i32 OutpostBishopBonus[2] = { 25, 0 };
-static const i32 OutpostBishopExtraBonus[2] = { 30, 0 };
-static const i32 OppositeBishopBonus[2] = { 75, 300 };
-static const i32 BishopPawnWeakPenalty[2] = { -75, 0 };
+static const Score OutpostBishopBonus = S(25, 0);
+static const Score OutpostBishopExtraBonus = S(30, 0);
+static const Score OppositeBishopBonus = S(75, 300);
+static const Score BishopPawnWeakPenalty = S(-75, 0);
 
-static const i32 RookHangingPenalty[2] = { -15, 0 };
-static const i32 RookMobility[2][15] = 
-{
-    {  -127,  -56,  -25,  -12,  -10,  -12,  -11,  -4,  4,  9,  11,  19,  19,  37,  97 },
-    { -1270, -560, -250, -120, -100, -120, -110, -40, 40, 90, 110, 190, 190, 370, 970 },
+static const Score RookHangingPenalty = S(-15, 0);
+static const Score RookMobility[15] = {
+    S(-127, -1270), S( -56,  -560), S( -25,  -250), S( -12,  -120), S( -10,  -100),
+    S( -12,  -120), S( -11,  -110), S(  -4,   -40), S(   4,    40), S(   9,    90),
+    S(  11,   110), S(  19,   190), S(  19,   190), S(  37,   370), S(  97,   970)
 };
-static const i32 ConnectedRookBonus[2] = { 15, 0 };
-static const i32 TwoRookPenalty[2] = { -5, -35 };
+static const Score ConnectedRookBonus = S(15, 0);
+static const Score TwoRookPenalty = S(-5, -35);
 
-static const i32 QueenHangingPenalty[2] = { -60, 0 };
-static const i32 QueenMobility[2][28] = 
-{
-    {
-        -111, -111, -104, -46, -20, -9, -1,  2,  8, 10, 15, 17,  20,  23,
-        22,   21,   24,  16,  13, 18, 25, 38, 34, 28, 10,  7, -42, -23,
-    },
-    {
-        -1110, -2530, -1270, -460, -200, -90, -10,  20,  80, 100, 150, 170,  200,  230,
-        220,   210,   240,  160,  130, 180, 250, 380, 340, 280, 100,  70, -420, -230,
-    },
+static const Score QueenHangingPenalty = S(-60, 0);
+static const Score QueenMobility[28] = {
+    S(-111, -1110), S(-111, -2530), S(-104, -1270), S( -46,  -460), S( -20,  -200), S(  -9,   -90), S(  -1,   -10),
+    S(   2,    20), S(   8,    80), S(  10,   100), S(  15,   150), S(  17,   170), S(  20,   200), S(  23,   230),
+    S(  22,   220), S(  21,   210), S(  24,   240), S(  16,   160), S(  13,   130), S(  18,   180), S(  25,   250),
+    S(  38,   380), S(  34,   340), S(  28,   280), S(  10,   100), S(   7,    70), S( -42,  -420), S( -23,  -230)
 };
-static const i32 QueenPinPenalty[2] = { -100, -300};
-static const i32 CastleAbilityBonus[2] = { 0, 0 };
\ No newline at end of file
+static const Score QueenPinPenalty = S(-100, -300);
+static const Score CastleAbilityBonus = S(0, 0);
\ No newline at end of file
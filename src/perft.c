@@ -0,0 +1,274 @@
+#include "perft.h"
+#include "movement.h"
+#include "timeman.h"
+#include "util.h"
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#ifdef DEBUG
+#include "bitboard/bbutils.h"
+#endif
+
+/*
+ * Subtree counts keyed by (hash, depth), stored like the TT as hash ^ data
+ * so an entry torn by another thread fails to verify instead of being trusted
+ */
+typedef struct {
+    _Atomic u64 data; // Node count in the upper 56 bits, depth in the low 8
+    _Atomic u64 hash;
+} PerftEntry;
+
+typedef struct {
+    u8   root;  // Index of the root move
+    Move reply; // Reply searched under it, NO_MOVE when the root move is the whole task
+} PerftTask;
+
+typedef struct {
+    Position root_pos;
+    i32 depth;
+    Move root_moves[MAX_MOVES];
+    PerftTask *tasks;
+    u32 n_tasks;
+    _Atomic u32 next_task;             // Idle workers take the next task from here
+    _Atomic u64 root_nodes[MAX_MOVES];
+    PerftEntry *table;
+    u64 table_mask;
+} PerftJob;
+
+typedef struct {
+    PerftJob *job;
+    ThreadData *td;
+} PerftWorker;
+
+/*
+ * Reference perft on a single thread without hashing, used to check perft_run
+ * In debug builds every unmake is checked against the position before the move
+ */
+u64 perft(ThreadData *td, i32 depth, u8 print){
+  Move move_list[MAX_MOVES];
+  i32 n_moves, i;
+  u64 nodes = 0;
+
+  n_moves = generateLegalMoves(&td->pos, move_list);
+
+  if (depth <= 1)
+    return n_moves;
+
+  for (i = 0; i < n_moves; i++) {
+    #ifdef DEBUG
+    Position prev_pos = td->pos;
+    i32 prev_hash_cur_idx = td->hash_stack.cur_idx;
+    i32 prev_hash_reset_idx = td->hash_stack.reset_idx;
+    #endif
+    make_move(td, move_list[i]);
+
+    #ifdef PYTHON
+    checkMoveCount(pos);
+    #endif
+    u64 count = perft(td, depth - 1, FALSE);
+    if(print){
+        printMoveShort(move_list[i]);
+        printf(": %" PRIu64 "\n", count);
+    }
+    unmake_move(td, move_list[i]);
+
+    #ifdef DEBUG
+    if(!compare_positions(&td->pos, &prev_pos)){
+        printf("Error in perft, unmake move did not properly return the position: ");
+        printMove(move_list[i]);
+        printf("\n\nCorrect Position:\n");
+        printPosition(prev_pos, TRUE);
+        printf("\n\nFound Position:\n");
+        printPosition(td->pos, TRUE);
+        while(1);
+    }
+    if(prev_hash_cur_idx != td->hash_stack.cur_idx){
+        printf("Hash stack cur_idx doesnt match previous hash stack!\n");
+        while(1);
+    }
+    if(prev_hash_reset_idx != td->hash_stack.reset_idx){
+        printf("Hash stack reset_idx doesnt match previous hash stack!\n");
+        while(1);
+    }
+    td->pos = prev_pos;
+    #endif
+
+
+
+    nodes += count;
+  }
+  if(print){
+    printf("Nodes searched: %" PRIu64 "\n", nodes);
+  }
+  return nodes;
+}
+
+/*
+ * Perft below the split, leaves are bulk counted from the move list
+ * and subtrees of depth 2 or more go through the hash table
+ */
+static u64 perft_hashed(ThreadData *td, PerftJob *job, i32 depth){
+    if(depth == 0) return 1;
+
+    Move move_list[MAX_MOVES];
+    i32 n_moves = generateLegalMoves(&td->pos, move_list);
+    if(depth == 1) return n_moves;
+
+    PerftEntry *entry = job->table ? &job->table[td->pos.hash & job->table_mask] : NULL;
+    if(entry){
+        u64 data = atomic_load_explicit(&entry->data, memory_order_relaxed);
+        u64 hash = atomic_load_explicit(&entry->hash, memory_order_relaxed);
+        if((hash ^ data) == td->pos.hash && (i32)(data & 0xFF) == depth) return data >> 8;
+    }
+
+    u64 nodes = 0;
+    for(i32 i = 0; i < n_moves; i++){
+        make_move(td, move_list[i]);
+        nodes += perft_hashed(td, job, depth - 1);
+        unmake_move(td, move_list[i]);
+    }
+
+    if(entry){
+        u64 data = (nodes << 8) | (u64)depth;
+        atomic_store_explicit(&entry->data, data, memory_order_relaxed);
+        atomic_store_explicit(&entry->hash, td->pos.hash ^ data, memory_order_relaxed);
+    }
+    return nodes;
+}
+
+static void *perft_worker(void *arg){
+    PerftWorker *worker = arg;
+    PerftJob *job = worker->job;
+    ThreadData *td = worker->td;
+
+    while(TRUE){
+        u32 i = atomic_fetch_add_explicit(&job->next_task, 1, memory_order_relaxed);
+        if(i >= job->n_tasks) break;
+
+        PerftTask task = job->tasks[i];
+        Move root_move = job->root_moves[task.root];
+        u64 nodes;
+
+        make_move(td, root_move);
+        if(task.reply != NO_MOVE){
+            make_move(td, task.reply);
+            nodes = perft_hashed(td, job, job->depth - 2);
+            unmake_move(td, task.reply);
+        }
+        else nodes = perft_hashed(td, job, job->depth - 1);
+        unmake_move(td, root_move);
+
+        atomic_fetch_add_explicit(&job->root_nodes[task.root], nodes, memory_order_relaxed);
+    }
+    return NULL;
+}
+
+/*
+ * Splits the root moves into tasks, from PERFT_SPLIT_DEPTH on each reply to a
+ * root move is its own task so the work is still even with a few root moves
+ * Returns the number of tasks, job->tasks is left NULL if they could not be allocated
+ */
+static u32 build_tasks(PerftJob *job, u32 n_root){
+    u8 split = job->depth >= PERFT_SPLIT_DEPTH;
+    job->tasks = malloc(sizeof(PerftTask) * MAX(n_root * (split ? MAX_MOVES : 1), 1));
+    if(!job->tasks) return 0;
+
+    u32 n_tasks = 0;
+    for(u32 i = 0; i < n_root; i++){
+        if(!split){
+            job->tasks[n_tasks++] = (PerftTask){.root = i, .reply = NO_MOVE};
+            continue;
+        }
+        Position child = job->root_pos;
+        Move replies[MAX_MOVES];
+        _make_move(&child, job->root_moves[i]);
+        i32 n_replies = generateLegalMoves(&child, replies);
+        for(i32 j = 0; j < n_replies; j++){
+            job->tasks[n_tasks++] = (PerftTask){.root = i, .reply = replies[j]};
+        }
+    }
+    return n_tasks;
+}
+
+/*
+ * Counts the leaf nodes depth plies below pos using up to threads threads
+ * and a table of subtree counts, printing the count under each root move,
+ * the total and the speed when print is set
+ */
+u64 perft_run(Position pos, i32 depth, u32 threads, u8 print){
+    u64 start = tm_now();
+    depth = MAX(depth, 1);
+    threads = MAX(threads, 1);
+
+    // Aligned for the cache line aligned root position
+    PerftJob *job = aligned_malloc(alignof(PerftJob), sizeof(PerftJob));
+    if(!job){
+        printf("info string Warning: failed to allocate memory for perft\n");
+        return 0;
+    }
+    memset(job, 0, sizeof(PerftJob));
+    job->root_pos = pos;
+    job->depth = depth;
+
+    u32 n_root = generateLegalMoves(&pos, job->root_moves);
+    job->n_tasks = build_tasks(job, n_root);
+    if(!job->tasks){
+        printf("info string Warning: failed to allocate memory for perft\n");
+        aligned_free(job);
+        return 0;
+    }
+
+    u64 entries = ((u64)PERFT_HASH_MB << 20) / sizeof(PerftEntry);
+    job->table = calloc(entries, sizeof(PerftEntry));
+    job->table_mask = entries - 1;
+    if(!job->table) printf("info string Warning: failed to allocate the perft hash table, running without it\n");
+
+    threads = MIN(threads, MAX(job->n_tasks, 1));
+    pthread_t handles[threads];
+    PerftWorker workers[threads];
+    u32 started = 0;
+    for(u32 t = 0; t < threads; t++){
+        ThreadData *td = aligned_malloc(alignof(ThreadData), sizeof(ThreadData));
+        if(!td) break;
+        memset(td, 0, sizeof(ThreadData));
+        td->thread_num = t;
+        td->pos = pos;
+        workers[t] = (PerftWorker){.job = job, .td = td};
+        // The calling thread is worker 0
+        if(t && pthread_create(&handles[t], NULL, perft_worker, &workers[t])){
+            aligned_free(td);
+            break;
+        }
+        started++;
+    }
+    if(started) perft_worker(&workers[0]);
+    else printf("info string Warning: failed to start any perft threads\n");
+    for(u32 t = 1; t < started; t++) pthread_join(handles[t], NULL);
+    for(u32 t = 0; t < started; t++) aligned_free(workers[t].td);
+
+    u64 nodes = 0;
+    for(u32 i = 0; i < n_root; i++){
+        u64 count = job->root_nodes[i];
+        if(print){
+            printMoveShort(job->root_moves[i]);
+            printf(": %" PRIu64 "\n", count);
+        }
+        nodes += count;
+    }
+
+    if(print){
+        u64 elapsed = tm_now() - start;
+        printf("info string perft depth %d threads %u time %" PRIu64 " nps %" PRIu64 "\n",
+               depth, started, elapsed, nodes * 1000 / MAX(elapsed, 1));
+        printf("Nodes searched: %" PRIu64 "\n", nodes);
+        fflush(stdout);
+    }
+
+    free(job->table);
+    free(job->tasks);
+    aligned_free(job);
+    return nodes;
+}
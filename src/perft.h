@@ -0,0 +1,8 @@
+#pragma once
+#include "types.h"
+
+#define PERFT_HASH_MB      64 // Size of the subtree count table used by perft_run
+#define PERFT_SPLIT_DEPTH  3  // Shallowest perft split into (root move, reply) tasks
+
+u64 perft(ThreadData *td, i32 depth, u8 print);
+u64 perft_run(Position pos, i32 depth, u32 threads, u8 print);
@@ -3,6 +3,6 @@
 i32 helper_loop(ThreadData *td);
 i32 search_loop(ThreadData *td);
 void start_search(SearchParameters search);
-void search_timed_out(void);
+void search_out_of_time(void);
+void report_best_move(void);
 void stopSearch(void);
-void exit_search();
\ No newline at end of file
@@ -1,6 +1,7 @@
 #include "tree.h"
 #include "types.h"
 #include "tables.h"
+#include <string.h>
 //TODO: Both of these tables need to be modified to support threading.
 
 /*
@@ -38,3 +39,7 @@ u32 getHistoryScore(char pos_flags, Move move){
    if(GET_FLAGS(move) & CAPTURE) return 0;
    return historyTable[pos_flags & WHITE_TURN][GET_FROM(move)][GET_TO(move)];
 }
+
+void clearHistory(){
+   memset(historyTable, 0, sizeof(historyTable));
+}
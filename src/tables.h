@@ -7,4 +7,5 @@ void clearKillerMoves(KillerMoves* km);
 
 void storeHistoryMove(char pos_flags, Move move, char depth);
 u32 getHistoryScore(char pos_flags, Move move);
+void clearHistory();
 
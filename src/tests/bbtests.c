@@ -23,15 +23,53 @@
 #include "../globals.h"
 #include "../search.h"
 #include "../moveorder.h"
+#include "../perft.h"
 
-// #define SELECT_SORT_TEST
+#define SLIDER_TEST
+#define MOVE_PICKER_TEST
 // #define MOVE_GEN_TEST
 // #define MOVE_MAKE_TEST
 #define PERF_TEST
 #define SEE_TEST
 #define MOVE_SORT_TEST
+#define TT_TEST
 // #define PUZZLE_TEST
 
+#ifdef SLIDER_TEST
+/* Reference slider attacks, walks each ray until it hits a blocker */
+static u64 slowSliderAttacks(i32 sq, u64 occ, i32 bishop){
+    static const i32 dirs[2][4][2] = {{{1, 0}, {-1, 0}, {0, 1}, {0, -1}}, {{1, 1}, {1, -1}, {-1, 1}, {-1, -1}}};
+    u64 attacks = 0ULL;
+    for(i32 d = 0; d < 4; d++){
+        i32 r = sq / 8 + dirs[bishop][d][0], f = sq % 8 + dirs[bishop][d][1];
+        for(; r >= 0 && r < 8 && f >= 0 && f < 8; r += dirs[bishop][d][0], f += dirs[bishop][d][1]){
+            attacks |= 1ULL << (r * 8 + f);
+            if(occ & (1ULL << (r * 8 + f))) break;
+        }
+    }
+    return attacks;
+}
+
+/* Checks the generated slider tables against every blocker subset of every square */
+static i32 verifySliderTables(void){
+    for(i32 sq = 0; sq < 64; sq++){
+        for(i32 bishop = 0; bishop < 2; bishop++){
+            u64 mask = bishop ? mBishopTbl[sq].mask : mRookTbl[sq].mask;
+            u64 occ = 0ULL;
+            do{
+                u64 actual = bishop ? bishopAttacks(occ, sq) : rookAttacks(occ, sq);
+                if(actual != slowSliderAttacks(sq, occ, bishop)){
+                    printf("Incorrect %s attacks at square %d with blockers 0x%" PRIx64 "\n", bishop ? "bishop" : "rook", sq, occ);
+                    return -1;
+                }
+                occ = (occ - mask) & mask;
+            } while(occ);
+        }
+    }
+    return 0;
+}
+#endif
+
 i32 testBB(void) {
     #ifdef PYTHON
     python_init();
@@ -49,6 +87,17 @@ i32 testBB(void) {
     (void)moveList;
     (void)pos;
 
+    #ifdef SLIDER_TEST
+    printf("\n---------------------------------- SLIDER TESTING ------------------------------------\n\n");
+    if(verifySliderTables()) while(1);
+    #ifdef PEXT_BUILD
+    use_pext = !use_pext; // Check the other backend too
+    if(verifySliderTables()) while(1);
+    use_pext = !use_pext;
+    #endif
+    printf("Slider attack tests passed!\n");
+    #endif //SLIDER_TEST
+
     #ifdef MOVE_GEN_TEST
     printf("\n---------------------------------- MOVE GEN TESTING ----------------------------------\n\n");
     
@@ -121,39 +170,82 @@ i32 testBB(void) {
 
     #endif
 
-    #ifdef SELECT_SORT_TEST
+    #ifdef MOVE_PICKER_TEST
     #include "../tables.h"
-    printf("\n------------------------------ SELECT SORT TESTING --------------------------------\n\n");
-    ThreadData ss_td = {0};
-    ss_td.pos = fen_to_position("r2qk2r/pbp2ppp/1pn1pn2/3p4/3P1B2/P1PBPN2/2P2PPP/R2QK2R w KQkq - 1 9");
-    u32 evalIdx = 0;
-    
-    Move ss_move_list[MAX_MOVES] = {0};
-    i32  ss_move_vals[MAX_MOVES] = {0};
-    u32 ss_list_size = generateLegalMoves(&ss_td.pos, ss_move_list);
-    
-    storeKillerMove(&ss_td.km, 0, ss_move_list[8]);
-    Move ss_tt_move = ss_move_list[9];
-
-    // Testing move vals
-    for (u32 i = 0; i < ss_list_size; i++)  {
-        printf("move_list[%d] val = %d ; ", i, eval_move(ss_move_list[i], &ss_td.pos));
-        printMove(ss_move_list[i]);
-        printf("\n");
-    }
+    printf("\n------------------------------ MOVE PICKER TESTING --------------------------------\n\n");
+    srand(1);
+    ThreadData mp_td = {0};
+    MovePicker mp;
+    Move mp_move;
+    i32 mp_val;
+    for(i32 j = 0; j < 200; j++){
+        mp_td.pos = fen_to_position("r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - ");
+        size = generateLegalMoves(&mp_td.pos, moveList);
+        while(size != 0 && mp_td.pos.halfmove_clock < 50){
+            // Every legal move has to be accepted, anything else has to be rejected
+            for(i32 k = 0; k < size; k++){
+                if(!is_pseudo_legal(&mp_td.pos, moveList[k])){
+                    printf("Legal move rejected: ");
+                    printMove(moveList[k]);
+                    printPosition(mp_td.pos, TRUE);
+                    while(1);
+                }
+            }
+            for(i32 k = 0; k < 64; k++){
+                Move rand_move = (Move)rand();
+                char found = 0;
+                for(i32 l = 0; l < size; l++) if(moveList[l] == rand_move) found = 1;
+                if(is_pseudo_legal(&mp_td.pos, rand_move) != found){
+                    printf("Illegal move accepted: ");
+                    printMove(rand_move);
+                    printPosition(mp_td.pos, TRUE);
+                    while(1);
+                }
+            }
 
-    for (u32 i = 0; i < ss_list_size; i++)  {
-        evalIdx = select_sort(&ss_td, i, evalIdx, ss_move_list, ss_move_vals, ss_list_size, ss_tt_move, 0);
-    }
-    printf("\n------------------------------------------------------------------------\n");
+            // Out of check with no pins, captures then quiets are the legal moves in the same order
+            if(!(mp_td.pos.flags & IN_CHECK) && !(get_pinned(&mp_td.pos) & mp_td.pos.color[mp_td.pos.flags & TURN_MASK])){
+                Move splitList[MAX_MOVES];
+                i32 split_size = generateNoisyMoves(&mp_td.pos, splitList);
+                split_size += generateQuietMoves(&mp_td.pos, splitList + split_size);
+                i32 n_noisy = 0, n_quiet = 0;
+                for(i32 l = 0; l < size; l++) n_noisy += (GET_FLAGS(moveList[l]) & (CAPTURE | PROMOTION)) != 0;
+                for(i32 l = 0; l < size && split_size == size; l++){
+                    u8 noisy = (GET_FLAGS(moveList[l]) & (CAPTURE | PROMOTION)) != 0;
+                    Move expected = noisy ? splitList[l - n_quiet] : splitList[n_noisy + n_quiet];
+                    n_quiet += !noisy;
+                    if(moveList[l] != expected) split_size = -1;
+                }
+                if(split_size != size){
+                    printf("Captures and quiets do not match the legal moves\n");
+                    printPosition(mp_td.pos, TRUE);
+                    while(1);
+                }
+            }
 
-    for (u32 i = 0; i < ss_list_size; i++)  {
-        printf("move_list[%d] val = %d ; ", i, ss_move_vals[i]);
-        printMove(ss_move_list[i]);
-        printf("\n");
-    }
-    return
+            // The picker has to hand out each legal move exactly once
+            storeKillerMove(&mp_td.km, 0, moveList[rand() % size]);
+            init_move_picker(&mp, rand() % 2 ? moveList[rand() % size] : (Move)rand(), 0);
+            i32 picked = 0;
+            while((mp_move = next_move(&mp, &mp_td, &mp_val)) != NO_MOVE){
+                char found = 0;
+                for(i32 l = 0; l < size; l++) if(moveList[l] == mp_move) found = 1;
+                if(!found){
+                    printf("Move picker returned a move not in the move list\n");
+                    while(1);
+                }
+                picked++;
+            }
+            if(picked != size){
+                printf("Move picker returned %d moves, expected %d\n", picked, size);
+                while(1);
+            }
 
+            _make_move(&mp_td.pos, moveList[rand() % size]);
+            size = generateLegalMoves(&mp_td.pos, moveList);
+        }
+    }
+    printf("Move picker tests passed!\n");
     #endif
 
     #ifdef PERF_TEST
@@ -180,6 +272,15 @@ i32 testBB(void) {
                 while(1);
             }
         }
+        // The threaded and hashed perft has to agree with the reference one
+        i64 ref_moves = perft(&temp_td, perft_depth - 1, FALSE);
+        i64 run_moves = perft_run(temp_td.pos, perft_depth - 1, 4, FALSE);
+        if(ref_moves != run_moves){
+            printf("Incorrect number of moves found by perft_run for fen: \n %s \n", fen);
+            printf("Found %" PRIi64 " moves, expected %" PRIi64 " moves at depth %d \n", run_moves, ref_moves, perft_depth - 1);
+            fflush(stdout);
+            while(1);
+        }
         printf(".");
         fflush(stdout);
     }
@@ -219,7 +320,7 @@ i32 testBB(void) {
         set_global_position(ms_pos);
         SearchParameters sp = {0};
         sp.depth = MAX_DEPTH - 1;
-        sp.can_shorten = FALSE;
+        sp.infinite = TRUE;
 
         start_search(sp);
         sleep(MS_SEARCH_TIME);
@@ -308,7 +409,7 @@ i32 testBB(void) {
         set_global_position(puzzle_pos);
         SearchParameters sp = {0};
         sp.depth = MAX_DEPTH - 1;
-        sp.can_shorten = FALSE;
+        sp.infinite = TRUE;
 
         start_search(sp);
         sleep(PUZZLE_SEARCH_TIME);
@@ -394,6 +495,49 @@ i32 testBB(void) {
     printf("Static exchange tests passed!\n");
     #endif //SEE_TEST 
 
+    #ifdef TT_TEST
+    printf("\n---------------------------------- TT TESTING -------------------------------------\n\n");
+    tt_clear();
+    // Fill one bucket with deep entries from an old search
+    for(u64 i = 0; i < TT_BUCKET_SIZE; i++){
+        store_tt_entry((i + 1) << 32, 20, 100, PV_NODE, create_move(E2, E4, DOUBLE_PAWN_PUSH), -(i32)i);
+    }
+    for(u64 i = 0; i < TT_BUCKET_SIZE; i++){
+        i32 static_eval;
+        if(get_tt_entry((i + 1) << 32, &static_eval).fields.depth != 20 || static_eval != -(i32)i){
+            printf("TT entry %" PRIu64 " was not found in its bucket\n", i);
+            while(1);
+        }
+    }
+    // A shallower result keeps the entry but still fills in a missing static eval
+    store_tt_entry((1ULL << 32) | 1, 20, 100, PV_NODE, NO_MOVE, NO_STATIC_EVAL);
+    store_tt_entry((1ULL << 32) | 1, 5, 40, CUT_NODE, NO_MOVE, 7);
+    i32 kept_static_eval;
+    TTEntryData tt_kept_entry = get_tt_entry((1ULL << 32) | 1, &kept_static_eval);
+    if(tt_kept_entry.fields.depth != 20 || kept_static_eval != 7){
+        printf("TT lost the static eval or the deeper result of an entry\n");
+        while(1);
+    }
+    // Only the low bits of a key may differ from the bucket index, anything else is a miss
+    if(get_tt_entry((1ULL << 32) | (1ULL << 40), NULL).data){
+        printf("TT matched an entry with a different key\n");
+        while(1);
+    }
+    // A shallow entry from a new search should recycle an old slot
+    tt_new_search();
+    tt_new_search();
+    tt_new_search();
+    store_tt_entry((TT_BUCKET_SIZE + 1ULL) << 32, 1, -50, CUT_NODE, NO_MOVE, 40000);
+    i32 tt_test_static_eval;
+    TTEntryData tt_test_entry = get_tt_entry((TT_BUCKET_SIZE + 1ULL) << 32, &tt_test_static_eval);
+    if(tt_test_entry.fields.eval != -50 || tt_test_entry.fields.node_type != CUT_NODE || tt_test_static_eval != NO_STATIC_EVAL){
+        printf("TT failed to replace aged entry\n");
+        while(1);
+    }
+    tt_clear();
+    printf("Transposition table tests passed!\n");
+    #endif //TT_TEST
+
     #ifdef PYTHON
     python_close();
     #endif
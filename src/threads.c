@@ -11,119 +11,32 @@
 #include "globals.h"
 #include "search.h"
 #include "io.h"
+#include "evaluator.h"
+#include "movement.h"
 
 #include <pthread.h>
 #include <unistd.h>
 #include <errno.h>
+#include <stdint.h>
+#include <math.h>
 
-static pthread_t search_threads[NUM_THREADS];
-
-// Global variable to control the timer thread
-pthread_mutex_t timer_mutex = PTHREAD_MUTEX_INITIALIZER;
-pthread_cond_t timer_cond = PTHREAD_COND_INITIALIZER;
-static pthread_t timerThread;
-
-/*
- * Quits out of a thread
- */
-void quit_thread(){
-   pthread_exit(NULL);
-}
-
-/*
- * Starts a timer that prints out the best move and stops the search on completion
- */
-void* timerThreadFunction(void* duration_ms_ptr) {
-    #ifdef DEBUG
-    printf("info string Running timer thread function\n");
-    fflush(stdout);
-    #endif
-
-    i64 duration_ms = *(i64*)duration_ms_ptr;
-    free(duration_ms_ptr);
-
-    //Set up time to wait to
-    struct timespec ts;
-    clock_gettime(CLOCK_REALTIME, &ts);
-    ts.tv_sec  += duration_ms / 1000;
-    ts.tv_nsec += (duration_ms % 1000) * 1000000;
-
-    u8 timed_out; // Whether or not to print after completion
-
-    pthread_mutex_lock(&timer_mutex);
-    int result = pthread_cond_timedwait(&timer_cond, &timer_mutex, &ts);
-    
-    if (result == ETIMEDOUT) {
-        timed_out = TRUE;
-        #ifdef DEBUG
-        printf("info string Timer expired\n");
-        fflush(stdout);
-        #endif
-    } else {
-        timed_out = FALSE; // We dont want to print if manually stopped
-        #ifdef DEBUG
-        printf("info string Timer triggered early\n");
-        fflush(stdout);
-        #endif
-    }
-    pthread_mutex_unlock(&timer_mutex);
-    
-    
-    if(timed_out){ // Call the print function after waking up
-        search_timed_out();
-    }
-
-    #ifdef DEBUG
-    printf("info string timer thread function finished\n");
-    fflush(stdout);
-    #endif
-
-    return (void*)(i64)result;
-}
-
-i32 startTimerThread(i64 duration_ms) {
-    i64 *durationPtr = malloc(sizeof(i64));
-    #ifdef DEBUG
-    printf("info string Starting timer thread\n");
-    fflush(stdout);
-    #endif
-
-    if(!durationPtr){
-        printf("info string Warning failed to allocate space for duration pointer.\n");
-        return -1;
-    }
-    *durationPtr = duration_ms;
-    
-    if (pthread_create(&timerThread, NULL, timerThreadFunction, durationPtr)) {
-        perror("info string Failed to create timer thread\n");
-        return 1;
-    }
-    #ifdef DEBUG
-    printf("info string Timer thread started\n");
-    fflush(stdout);
-    #endif
-    return 0;
-}
-
-/*
- * Cancels the timer thread
- */
-void stopTimerThread() {
-    #ifdef DEBUG_PRINT
-    printf("info string Stopping timer thread\n");
-    fflush(stdout);
-    #endif
-
-    pthread_mutex_lock(&timer_mutex);
-    pthread_cond_signal(&timer_cond);
-    pthread_mutex_unlock(&timer_mutex);
-
-    #ifdef DEBUG_PRINT
-    printf("info string Timer thread stopped\n");
-    fflush(stdout);
-    #endif
-}
+// Search thread pool, created once and parked between searches
+static pthread_t search_threads[MAX_THREADS];
+static ThreadData *search_td[MAX_THREADS];  // Kept allocated between searches
+static PawnTable *search_pawn_table[MAX_THREADS];         // Each search thread's eval tables, kept between searches
+static MaterialTable *search_material_table[MAX_THREADS];
+static EvalTable *search_eval_table[MAX_THREADS];
+static u32 pool_size = 0;                   // Threads created so far
+static u32 pool_active = 0;                 // Threads taking part in the current search
+static u32 pool_running = 0;                // Threads still searching
+static u64 pool_generation = 0;             // Bumped to wake the pool for a new search
+static u8  pool_quit = FALSE;
+static Position pool_root;                  // Root position handed to the pool for the current search
+static _Atomic u32 search_thread_count = DEFAULT_THREADS;
 
+static pthread_mutex_t pool_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  pool_wake  = PTHREAD_COND_INITIALIZER; // Signals parked threads
+static pthread_cond_t  pool_idle  = PTHREAD_COND_INITIALIZER; // Signals the last thread finished
 
 void *input_thread_entry(void *arg) {
     (void)arg;
@@ -148,40 +61,118 @@ void *output_thread_entry(void *arg) {
 }
 
 /**
- * Creates the search thread and initializes
- * the search thread data structure
+ * Pool loop for a search thread, parks until a search is started
+ * and runs it on the thread's ThreadData
  */
 void *search_thread_entry(void *arg) {
-    u32 thread_num = *(u32*)arg;
-    free(arg);
-    ThreadData td = {0};
-    td.thread_num = thread_num;
-    td.is_helper_thread = thread_num >= NUM_MAIN_THREADS;
-    td.pos = copy_global_position();
+    u32 thread_num = (u32)(uintptr_t)arg;
+    ThreadData *td = search_td[thread_num];
+    u64 seen_generation = 0; // Threads are created for a search, so the first generation seen is always new
 
-    #ifdef DEBUG_PRINT
-    printf("info string Search Thread Starting\n");
-    fflush(stdout);
-    #endif
-    if(td.is_helper_thread) helper_loop(&td); 
-    else search_loop(&td);
+    pthread_mutex_lock(&pool_mutex);
+    while(TRUE){
+        while(!pool_quit && pool_generation == seen_generation) pthread_cond_wait(&pool_wake, &pool_mutex);
+        if(pool_quit) break;
+        seen_generation = pool_generation;
+        if(thread_num >= pool_active) continue;
+
+        memset(td, 0, sizeof(ThreadData));
+        td->thread_num = thread_num;
+        td->is_helper_thread = thread_num >= NUM_MAIN_THREADS;
+        td->pos = pool_root;
+        td->pawn_table = search_pawn_table[thread_num];
+        td->material_table = search_material_table[thread_num];
+        td->eval_table = search_eval_table[thread_num];
+        pthread_mutex_unlock(&pool_mutex);
+
+        #ifdef DEBUG_PRINT
+        printf("info string Search Thread Starting\n");
+        fflush(stdout);
+        #endif
+        if(td->is_helper_thread) helper_loop(td);
+        else search_loop(td);
+
+        pthread_mutex_lock(&pool_mutex);
+        if(--pool_running == 0) pthread_cond_broadcast(&pool_idle);
+    }
+    pthread_mutex_unlock(&pool_mutex);
     return NULL;
 }
 
+/*
+ * Creates parked threads until the pool holds count of them (pool_mutex held)
+ * Returns the number of threads available
+ */
+static u32 grow_pool(u32 count){
+    while(pool_size < count){
+        // Aligned so each thread's search counters keep to their own cache line
+        ThreadData *td = aligned_malloc(alignof(ThreadData), sizeof(ThreadData));
+        PawnTable *pawn_table = pawn_table_alloc();
+        MaterialTable *material_table = material_table_alloc();
+        EvalTable *eval_table = eval_table_alloc();
+        if(!td || !pawn_table || !material_table || !eval_table){
+            printf("info string Warning: failed to allocate memory in start search threads.\n");
+            aligned_free(td);
+            pawn_table_free(pawn_table);
+            material_table_free(material_table);
+            eval_table_free(eval_table);
+            break;
+        }
+        search_td[pool_size] = td;
+        search_pawn_table[pool_size] = pawn_table;
+        search_material_table[pool_size] = material_table;
+        search_eval_table[pool_size] = eval_table;
+        if(pthread_create(&search_threads[pool_size], NULL, search_thread_entry, (void*)(uintptr_t)pool_size)){
+            printf("info string Warning: failed to create search thread %d.\n", pool_size);
+            aligned_free(td);
+            pawn_table_free(pawn_table);
+            material_table_free(material_table);
+            eval_table_free(eval_table);
+            break;
+        }
+        pool_size++;
+    }
+    return MIN(pool_size, count);
+}
+
+/*
+ * Waits for running search threads, pool_mutex must be held
+ */
+static inline void wait_pool_idle(){
+    while(pool_running) pthread_cond_wait(&pool_idle, &pool_mutex);
+}
+
+/*
+ * Answers a search no thread could be started for with the first legal move
+ * so the GUI is not left waiting for a bestmove
+ */
+static void report_fallback_move(Position pos){
+    Move moves[MAX_MOVES];
+    Move pv[MAX_DEPTH] = {NO_MOVE};
+    printf("info string Warning: no search thread could be started, playing the first legal move\n");
+    if(generateLegalMoves(&pos, moves)) pv[0] = moves[0];
+    update_global_pv(1, pv, 0, (SearchStats){0});
+    report_best_move();
+}
+
 void start_search_threads(){
     #ifdef DEBUG_PRINT
     printf("info string starting search threads\n");
     #endif
-    run_get_best_move = TRUE;
-    for (i32 i = 0; i < NUM_THREADS; i++) {
-        u32* thread_num = malloc(sizeof(u32));
-        if(!thread_num){
-            printf("info string Warning: failed to allocate memory in start search threads.\n");
-            return;
-        }
-        *thread_num = i;
-        pthread_create(&search_threads[i], NULL, search_thread_entry, thread_num);
+    pthread_mutex_lock(&pool_mutex);
+    if(pool_running){ // Only one search at a time, end the previous one
+        run_get_best_move = FALSE;
+        wait_pool_idle();
     }
+    pool_active = grow_pool(search_thread_count);
+    pool_running = pool_active;
+    pool_root = copy_global_position();
+    run_get_best_move = TRUE;
+    pool_generation++;
+    pthread_cond_broadcast(&pool_wake);
+    Position root = pool_root;
+    pthread_mutex_unlock(&pool_mutex);
+    if(!pool_active) report_fallback_move(root);
 }
 
 void stopSearchThreads(){
@@ -191,6 +182,113 @@ void stopSearchThreads(){
     run_get_best_move = false;
 }
 
+/*
+ * Waits for the search threads of the last search to park
+ * Used before touching shared search state such as the transposition table
+ */
+void wait_search_threads(){
+    pthread_mutex_lock(&pool_mutex);
+    wait_pool_idle();
+    pthread_mutex_unlock(&pool_mutex);
+}
+
+/*
+ * Stops any search and joins the pool threads, called on shutdown
+ */
+void stop_thread_pool(){
+    stopSearchThreads();
+    pthread_mutex_lock(&pool_mutex);
+    wait_pool_idle();
+    pool_quit = TRUE;
+    pthread_cond_broadcast(&pool_wake);
+    pthread_mutex_unlock(&pool_mutex);
+    for(u32 i = 0; i < pool_size; i++){
+        pthread_join(search_threads[i], NULL);
+        aligned_free(search_td[i]);
+        pawn_table_free(search_pawn_table[i]);
+        material_table_free(search_material_table[i]);
+        eval_table_free(search_eval_table[i]);
+    }
+    pool_size = 0;
+
+}
+
+/*
+ * Sets how many search threads the next search launches, clamped to [1, MAX_THREADS]
+ * Threads past NUM_MAIN_THREADS run as Lazy SMP helpers
+ */
+void set_search_thread_count(i32 count){
+    search_thread_count = (u32)MAX(1, MIN(count, MAX_THREADS));
+}
+
+u32 get_search_thread_count(){
+    return search_thread_count;
+}
+
+static inline real64 stat_percent(u64 part, u64 whole){
+    return whole ? 100.0 * (real64)part / (real64)whole : 0.0;
+}
+
+/*
+ * Returns the nodes searched by all threads in the current or last search
+ */
+u64 get_search_nodes(){
+    u64 nodes = 0;
+    pthread_mutex_lock(&pool_mutex);
+    for(u32 i = 0; i < pool_active; i++){
+        _Atomic u64 *count = search_td[i]->counters.count;
+        nodes += atomic_load_explicit(&count[STAT_PVS_NODES], memory_order_relaxed)
+               + atomic_load_explicit(&count[STAT_ZWS_NODES], memory_order_relaxed)
+               + atomic_load_explicit(&count[STAT_QS_NODES],  memory_order_relaxed);
+    }
+    pthread_mutex_unlock(&pool_mutex);
+    return nodes;
+}
+
+/*
+ * Sums the search counters of the threads in the current or last search and
+ * prints them as an info string, safe to call while a search is running
+ */
+void report_search_stats(){
+    u64 total[SEARCH_COUNTER_COUNT] = {0};
+    u64 main_nodes = 0, main_iterations = 0;
+
+    pthread_mutex_lock(&pool_mutex);
+    u32 threads = pool_active;
+    for(u32 i = 0; i < threads; i++){
+        _Atomic u64 *count = search_td[i]->counters.count;
+        for(i32 j = 0; j < SEARCH_COUNTER_COUNT; j++){
+            total[j] += atomic_load_explicit(&count[j], memory_order_relaxed);
+        }
+        if(i == 0){
+            main_nodes = atomic_load_explicit(&count[STAT_PVS_NODES], memory_order_relaxed)
+                       + atomic_load_explicit(&count[STAT_ZWS_NODES], memory_order_relaxed)
+                       + atomic_load_explicit(&count[STAT_QS_NODES],  memory_order_relaxed);
+            main_iterations = atomic_load_explicit(&count[STAT_ITERATIONS], memory_order_relaxed);
+        }
+    }
+    pthread_mutex_unlock(&pool_mutex);
+
+    u64 nodes = total[STAT_PVS_NODES] + total[STAT_ZWS_NODES] + total[STAT_QS_NODES];
+    // Effective branching factor of the main thread, nodes = ebf^depth
+    real64 ebf = (main_nodes && main_iterations) ? pow((real64)main_nodes, 1.0 / (real64)main_iterations) : 0.0;
+
+    printf("info string stats threads %u nodes %" PRIu64 " pvs %.1f%% zws %.1f%% qs %.1f%%"
+           " tthit %.1f%% ttcut %.1f%% failhigh %" PRIu64 " firstmove %.1f%%"
+           " nullprune %" PRIu64 " futilprune %" PRIu64 " deltaprune %" PRIu64 " lmr %" PRIu64 " ebf %.2f\n",
+           threads, nodes,
+           stat_percent(total[STAT_PVS_NODES], nodes),
+           stat_percent(total[STAT_ZWS_NODES], nodes),
+           stat_percent(total[STAT_QS_NODES], nodes),
+           stat_percent(total[STAT_TT_HITS], total[STAT_TT_PROBES]),
+           stat_percent(total[STAT_TT_CUTS], total[STAT_TT_PROBES]),
+           total[STAT_FAIL_HIGHS],
+           stat_percent(total[STAT_FIRST_MOVE_CUTS], total[STAT_FAIL_HIGHS]),
+           total[STAT_NULL_PRUNES], total[STAT_FUTIL_PRUNES], total[STAT_DELTA_PRUNES],
+           total[STAT_LMR_REDUCTIONS], ebf);
+    fflush(stdout);
+}
+
 i32 launch_threads(void){
     pthread_t input_thread, output_thread;
     if (pthread_create(&input_thread, NULL, input_thread_entry, NULL)) {
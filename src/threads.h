@@ -1,13 +1,16 @@
 #pragma once
 #include "types.h"
 
-#define MIN_HELPER_DEPTH MAX_DEPTH // At what depth to launch helper threads
-#define NUM_THREADS      1 // Total number of threads
-#define NUM_MAIN_THREADS 1 // How main of these are main threads (remaining will be helpers)
+#define MAX_THREADS      256 // Most search threads the Threads option allows
+#define DEFAULT_THREADS  1   // Total number of search threads at start up
+#define NUM_MAIN_THREADS 1   // How main of these are main threads (remaining will be helpers)
 
-i32 startTimerThread(i64 durationInSeconds);
-void stopTimerThread();
 void start_search_threads();
 void stopSearchThreads();
-void quit_thread();
+void wait_search_threads();
+void stop_thread_pool();
+void set_search_thread_count(i32 count);
+u32 get_search_thread_count();
+void report_search_stats();
+u64 get_search_nodes();
 i32 launch_threads(void);
\ No newline at end of file
@@ -0,0 +1,89 @@
+#include "timeman.h"
+#include "params.h"
+#include "util.h"
+#include <stdatomic.h>
+#include <time.h>
+
+static _Atomic u64 tm_start;          // Time the search started (ms, monotonic)
+static _Atomic u64 tm_optimum;        // Soft budget, checked between iterations
+static _Atomic u64 tm_maximum;        // Hard budget, checked by the search threads
+static _Atomic u8  tm_limited;        // Whether the search has a time limit at all
+static _Atomic i32 tm_move_overhead = DEFAULT_MOVE_OVERHEAD;
+
+/*
+ * Returns milliseconds on the monotonic clock, unaffected by changes to the wall clock
+ */
+u64 tm_now(){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (u64)ts.tv_sec * 1000 + (u64)ts.tv_nsec / 1000000;
+}
+
+u64 tm_elapsed(){
+    return tm_now() - tm_start;
+}
+
+void tm_set_move_overhead(i32 overhead_ms){
+    tm_move_overhead = MAX(0, MIN(overhead_ms, MAX_MOVE_OVERHEAD));
+}
+
+/*
+ * Sets the optimum and maximum budgets for the search from the go parameters
+ * Called from the IO Thread before the search threads are woken
+ */
+void tm_start_search(SearchParameters *params, i32 turn){
+    tm_start = tm_now();
+    i64 overhead = tm_move_overhead;
+
+    if(params->movetime){
+        i64 budget = MAX(1, (i64)params->movetime - overhead);
+        tm_optimum = budget;
+        tm_maximum = budget;
+        tm_limited = TRUE;
+        return;
+    }
+    if(params->infinite || (!params->time[turn] && !params->inc[turn])){
+        tm_limited = FALSE;
+        return;
+    }
+
+    i64 time = params->time[turn];
+    i64 inc  = params->inc[turn];
+    i64 moves_to_go = params->movestogo ? MIN(params->movestogo, TM_MOVE_HORIZON) : TM_MOVE_HORIZON;
+
+    // Spread the clock over the horizon, counting the increments still to come
+    i64 time_left = MAX(1, time + inc * (moves_to_go - 1) - overhead * moves_to_go);
+    i64 optimum = time_left / moves_to_go;
+    i64 maximum = MIN(optimum * TM_MAX_SCALE, (i64)(time * TM_MAX_SHARE) - overhead);
+    if(params->movestogo == 1) maximum = MIN(maximum, time - overhead); // Last move before the time control
+
+    tm_maximum = MAX(1, maximum);
+    tm_optimum = MAX(1, MIN(optimum, maximum));
+    tm_limited = TRUE;
+}
+
+u8 tm_is_limited(){
+    return tm_limited;
+}
+
+/*
+ * Returns true once the hard budget is spent, the search must stop
+ */
+u8 tm_hard_limit_hit(){
+    return tm_limited && tm_elapsed() >= tm_maximum;
+}
+
+/*
+ * Returns true if another iteration is not worth starting.
+ * The optimum budget shrinks when the best move has stayed the same for several
+ * depths and when it took most of the root nodes, and grows when the last
+ * iteration failed low
+ */
+u8 tm_soft_limit_hit(i32 stability, real64 best_move_share, u8 extend){
+    if(!tm_limited) return FALSE;
+    real64 stability_scale = MAX(TM_STABILITY_MIN, TM_STABILITY_BASE - TM_STABILITY_STEP * stability);
+    real64 share_scale = TM_NODE_SHARE_BASE - MIN(1.0, MAX(0.0, best_move_share));
+    real64 budget = (real64)tm_optimum * stability_scale * share_scale;
+    if(extend) budget *= SEARCH_EXTENSION_LEVEL;
+    return tm_elapsed() >= MIN((u64)budget, tm_maximum);
+}
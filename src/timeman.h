@@ -0,0 +1,13 @@
+#pragma once
+#include "types.h"
+
+#define DEFAULT_MOVE_OVERHEAD 10   // ms kept back each move for communication lag
+#define MAX_MOVE_OVERHEAD     5000
+
+void tm_start_search(SearchParameters *params, i32 turn);
+void tm_set_move_overhead(i32 overhead_ms);
+u64 tm_now();
+u64 tm_elapsed();
+u8 tm_is_limited();
+u8 tm_hard_limit_hit();
+u8 tm_soft_limit_hit(i32 stability, real64 best_move_share, u8 extend);
@@ -0,0 +1,277 @@
+/*
+ * Microbenchmarks for the hot primitives of the engine
+ *   craig-benchmicro.engine [-r repetitions] [-w warmup] epd...
+ * Every primitive is run over all positions of the epd files once per repetition,
+ * the cost per call of each repetition is measured with rdtsc (nanoseconds where
+ * it is not available) and the median and percentiles are printed as JSON
+ */
+#include "../types.h"
+#include "../util.h"
+#include "../movement.h"
+#include "../evaluator.h"
+#include "../moveorder.h"
+#include "../transposition.h"
+#include "../hash.h"
+#include "../bitboard/bbutils.h"
+#include "../bitboard/magic.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define TIMER_UNIT "cycles"
+static inline u64 read_timer(){ return __rdtsc(); }
+#else
+#define TIMER_UNIT "ns"
+static inline u64 read_timer(){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (u64)ts.tv_sec * 1000000000 + (u64)ts.tv_nsec;
+}
+#endif
+
+#define MICRO_MAX_POSITIONS 4096
+#define MICRO_MAX_REPS      1000
+#define MICRO_TT_KEYS       (MICRO_MAX_POSITIONS * 8)
+
+static Position *corpus;
+static u32 n_positions = 0;
+static Move (*corpus_moves)[MAX_MOVES];
+static u16 *corpus_move_count;
+static u64 *tt_keys; // Position and child hashes, spread over the whole table
+static u32 n_tt_keys = 0;
+static ThreadData *td;
+static PawnTable *pawn_table;
+static MaterialTable *material_table;
+
+static volatile u64 sink; // Keeps the results of the primitives alive
+
+/*
+ * Loads the board, turn, castling and en passant fields of each line,
+ * which is all perftsuite.epd and the puzzle files have in common
+ */
+static void load_epd(const char* path){
+    FILE* file = fopen(path, "r");
+    if(file == NULL){
+        perror(path);
+        return;
+    }
+    char line[512];
+    while(n_positions < MICRO_MAX_POSITIONS && fgets(line, sizeof(line), file)){
+        char fen[512] = "";
+        char* saveptr;
+        char* field = strtok_r(line, " \t\r\n", &saveptr);
+        for(i32 i = 0; i < 4 && field != NULL; i++){
+            strcat(fen, field);
+            strcat(fen, " ");
+            field = strtok_r(NULL, " \t\r\n", &saveptr);
+        }
+        if(strlen(fen) < 8) continue;
+        strcat(fen, "0 1");
+        corpus[n_positions++] = fen_to_position(fen);
+    }
+    fclose(file);
+}
+
+/*
+ * Each benchmark runs its primitive over the whole corpus once and returns the number of calls
+ */
+static u64 bench_make_unmake(){
+    u64 calls = 0;
+    for(u32 i = 0; i < n_positions; i++){
+        td->pos = corpus[i];
+        for(u32 j = 0; j < corpus_move_count[i]; j++){
+            make_move(td, corpus_moves[i][j]);
+            unmake_move(td, corpus_moves[i][j]);
+        }
+        calls += corpus_move_count[i];
+    }
+    sink += td->pos.hash;
+    return calls;
+}
+
+static u64 bench_legal_moves(){
+    Move moves[MAX_MOVES];
+    u64 total = 0;
+    for(u32 i = 0; i < n_positions; i++) total += generateLegalMoves(&corpus[i], moves);
+    sink += total;
+    return n_positions;
+}
+
+static u64 bench_threat_moves(){
+    Move moves[MAX_MOVES];
+    u64 total = 0;
+    for(u32 i = 0; i < n_positions; i++) total += generateThreatMoves(&corpus[i], moves);
+    sink += total;
+    return n_positions;
+}
+
+static u64 bench_eval(){
+    i64 total = 0;
+    for(u32 i = 0; i < n_positions; i++) total += eval_position(&corpus[i], pawn_table, material_table);
+    sink += total;
+    return n_positions;
+}
+
+static u64 bench_see(){
+    u64 calls = 0;
+    i64 total = 0;
+    for(u32 i = 0; i < n_positions; i++){
+        Position *pos = &corpus[i];
+        for(u32 j = 0; j < corpus_move_count[i]; j++){
+            Move move = corpus_moves[i][j];
+            if(!(GET_FLAGS(move) & CAPTURE) || GET_FLAGS(move) == EP_CAPTURE) continue;
+            u32 from = GET_FROM(move), to = GET_TO(move);
+            total += see(pos, to, pos->board[to], from, pos->board[from]);
+            calls++;
+        }
+    }
+    sink += total;
+    return calls;
+}
+
+static u64 bench_tt_store(){
+    for(u32 i = 0; i < n_tt_keys; i++) store_tt_entry(tt_keys[i], (char)(i & 15), (i32)(i & 255), PV_NODE, (Move)i, (i32)(i & 1023) - 512);
+    return n_tt_keys;
+}
+
+static u64 bench_tt_probe(){
+    u64 total = 0;
+    for(u32 i = 0; i < n_tt_keys; i++) total += get_tt_entry(tt_keys[i], NULL).data;
+    sink += total;
+    return n_tt_keys;
+}
+
+static u64 bench_rook_attacks(){
+    u64 total = 0;
+    for(u32 i = 0; i < n_positions; i++){
+        u64 occ = corpus[i].color[0] | corpus[i].color[1];
+        for(i32 sq = 0; sq < 64; sq++) total ^= rookAttacks(occ, sq);
+    }
+    sink += total;
+    return (u64)n_positions * 64;
+}
+
+static u64 bench_bishop_attacks(){
+    u64 total = 0;
+    for(u32 i = 0; i < n_positions; i++){
+        u64 occ = corpus[i].color[0] | corpus[i].color[1];
+        for(i32 sq = 0; sq < 64; sq++) total ^= bishopAttacks(occ, sq);
+    }
+    sink += total;
+    return (u64)n_positions * 64;
+}
+
+typedef struct {
+    const char* name;
+    u64 (*run)(void);
+} MicroBench;
+
+static const MicroBench benches[] = {
+    {"make_unmake_move",      bench_make_unmake},
+    {"generateLegalMoves",    bench_legal_moves},
+    {"generateThreatMoves",   bench_threat_moves},
+    {"eval_position",         bench_eval},
+    {"see",                   bench_see},
+    {"store_tt_entry",        bench_tt_store},
+    {"get_tt_entry",          bench_tt_probe},
+    {"rookAttacks",           bench_rook_attacks},
+    {"bishopAttacks",         bench_bishop_attacks},
+};
+#define MICRO_BENCH_COUNT (i32)(sizeof(benches) / sizeof(benches[0]))
+
+static i32 compare_real(const void* a, const void* b){
+    real64 x = *(const real64*)a, y = *(const real64*)b;
+    return (x > y) - (x < y);
+}
+
+static real64 percentile(const real64* sorted, i32 n, real64 p){
+    return sorted[MIN(n - 1, (i32)(p * (n - 1) + 0.5))];
+}
+
+i32 main(i32 argc, char** argv){
+    i32 reps = 25, warmup = 3;
+    const char* files[64];
+    i32 n_files = 0;
+    for(i32 i = 1; i < argc; i++){
+        if(strcmp(argv[i], "-r") == 0 && i + 1 < argc) reps = atoi(argv[++i]);
+        else if(strcmp(argv[i], "-w") == 0 && i + 1 < argc) warmup = atoi(argv[++i]);
+        else if(n_files < 64) files[n_files++] = argv[i];
+    }
+    reps = MAX(1, MIN(reps, MICRO_MAX_REPS));
+    warmup = MAX(0, warmup);
+    if(n_files == 0){
+        files[n_files++] = "../perftsuite.epd";
+        files[n_files++] = "../puzzles/ERET.epd";
+    }
+
+    // Startup output goes to stderr so stdout only holds the JSON
+    i32 saved_stdout = dup(STDOUT_FILENO);
+    dup2(STDERR_FILENO, STDOUT_FILENO);
+    selectSliderBackend();
+    initZobrist();
+    i32 tt_failed = init_tt(TT_DEFAULT_SIZE_MB);
+    fflush(stdout);
+    dup2(saved_stdout, STDOUT_FILENO);
+    close(saved_stdout);
+    if(tt_failed) return 1;
+
+    corpus            = aligned_malloc(alignof(Position), sizeof(Position) * MICRO_MAX_POSITIONS);
+    corpus_moves      = malloc(sizeof(Move) * MAX_MOVES * MICRO_MAX_POSITIONS);
+    corpus_move_count = malloc(sizeof(u16) * MICRO_MAX_POSITIONS);
+    tt_keys           = malloc(sizeof(u64) * MICRO_TT_KEYS);
+    td                = aligned_malloc(alignof(ThreadData), sizeof(ThreadData));
+    pawn_table        = pawn_table_alloc();
+    material_table    = material_table_alloc();
+    if(!corpus || !corpus_moves || !corpus_move_count || !tt_keys || !td || !pawn_table || !material_table){
+        fprintf(stderr, "Failed to allocate the corpus\n");
+        return 1;
+    }
+    memset(td, 0, sizeof(ThreadData));
+
+    for(i32 i = 0; i < n_files; i++) load_epd(files[i]);
+    if(n_positions == 0){
+        fprintf(stderr, "No positions loaded\n");
+        return 1;
+    }
+    for(u32 i = 0; i < n_positions; i++){
+        corpus_move_count[i] = generateLegalMoves(&corpus[i], corpus_moves[i]);
+        if(n_tt_keys < MICRO_TT_KEYS) tt_keys[n_tt_keys++] = corpus[i].hash;
+        for(u32 j = 0; j < corpus_move_count[i] && n_tt_keys < MICRO_TT_KEYS; j++){
+            tt_keys[n_tt_keys++] = hash_after_move(&corpus[i], corpus_moves[i][j]);
+        }
+    }
+
+    printf("{\n  \"positions\": %u,\n  \"unit\": \"%s\",\n  \"repetitions\": %d,\n  \"warmup\": %d,\n  \"benchmarks\": [\n",
+           n_positions, TIMER_UNIT, reps, warmup);
+    real64 per_call[MICRO_MAX_REPS];
+    for(i32 b = 0; b < MICRO_BENCH_COUNT; b++){
+        u64 calls = 0;
+        for(i32 r = 0; r < warmup; r++) benches[b].run();
+        for(i32 r = 0; r < reps; r++){
+            u64 start = read_timer();
+            calls = benches[b].run();
+            u64 elapsed = read_timer() - start;
+            per_call[r] = calls ? (real64)elapsed / (real64)calls : 0.0;
+        }
+        qsort(per_call, reps, sizeof(real64), compare_real);
+        printf("    {\"name\": \"%s\", \"calls\": %" PRIu64 ", \"min\": %.2f, \"p10\": %.2f, \"median\": %.2f, \"p90\": %.2f, \"max\": %.2f}%s\n",
+               benches[b].name, calls, per_call[0], percentile(per_call, reps, 0.1), percentile(per_call, reps, 0.5),
+               percentile(per_call, reps, 0.9), per_call[reps - 1], b + 1 < MICRO_BENCH_COUNT ? "," : "");
+        fflush(stdout);
+    }
+    printf("  ]\n}\n");
+
+    material_table_free(material_table);
+    pawn_table_free(pawn_table);
+    aligned_free(td);
+    free(tt_keys);
+    free(corpus_move_count);
+    free(corpus_moves);
+    aligned_free(corpus);
+    tt_free();
+    return 0;
+}
@@ -0,0 +1,559 @@
+//
+//  gentables.c
+//
+//  Build-time generator for the engine's lookup tables. It writes a C source
+//  defining every table as static const data, so the engine does no table
+//  setup at startup. Run by the Makefile: ./gentables > bitboard/tables_gen.c
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "../types.h"
+#include "../util.h"
+#include "../bitboard/magic.h"
+
+// Same shifts as bbutils.h, which declares the generated tables as const
+static u64 northOne(u64 bb) { return (bb & ~0xFF00000000000000ULL) << 8;  }
+static u64 northTwo(u64 bb) { return (bb & ~0xFFFF000000000000ULL) << 16; }
+static u64 noEaOne (u64 bb) { return (bb & ~0xFF80808080808080ULL) << 9; }
+static u64 noWeOne (u64 bb) { return (bb & ~0xFF01010101010101ULL) << 7; }
+
+static u64 southOne(u64 bb) { return (bb & ~0x00000000000000FFULL) >> 8; }
+static u64 southTwo(u64 bb) { return (bb & ~0x000000000000FFFFULL) >> 16; }
+static u64 soEaOne (u64 bb) { return (bb & ~0x80808080808080FFULL) >> 7; }
+static u64 soWeOne (u64 bb) { return (bb & ~0x01010101010101FFULL) >> 9; }
+
+static u64 eastTwo(u64 bb) { return (bb & ~0xC0C0C0C0C0C0C0C0ULL) << 2; }
+static u64 westTwo(u64 bb) { return (bb & ~0x0303030303030303ULL) >> 2; }
+
+static u64 kingMoves[64];
+static u64 knightMoves[64];
+static u64 pawnMoves[64][8];
+
+static u64 betweenMask[64][64];
+static u64 rankMask[64], fileMask[64], NESWMask[64], NWSEMask[64];
+
+static u64 PassedPawnMask[2][64];
+static u64 KingAreaMask[64];
+
+static u64 magicAttackTable[ATTACK_TABLE_SIZE];
+static u64 pextAttackTable[ATTACK_TABLE_SIZE];
+static i32 attackTableOffsets[128]; // Rooks then bishops
+
+static const u64 rook_magics[64] = {
+    0x80002080400016ULL,
+    0xc0004010002000ULL,
+    0x880100008822000ULL,
+    0x100090020041000ULL,
+    0x8200200200040810ULL,
+    0x4100020400010008ULL,
+    0x200020004410088ULL,
+    0x4080088002244300ULL,
+    0x109800c80400025ULL,
+    0x402000401000ULL,
+    0x4110801000200080ULL,
+    0x8800804801000ULL,
+    0x4181001008010004ULL,
+    0x180800400800200ULL,
+    0x2100c100040200ULL,
+    0x820801840801100ULL,
+    0xa100848000400020ULL,
+    0x44b00040004c2004ULL,
+    0x3868020001000ULL,
+    0x402020010200840ULL,
+    0x40828004000800ULL,
+    0x808004000200ULL,
+    0x1080010100040200ULL,
+    0x20004118641ULL,
+    0x1080004040002000ULL,
+    0xc810014140002002ULL,
+    0x88a0100180200088ULL,
+    0x8000240900100100ULL,
+    0x2a0040080080081ULL,
+    0x421002900020400ULL,
+    0x400020400080110ULL,
+    0x2002040200218047ULL,
+    0x40804000800020ULL,
+    0x8200044401004ULL,
+    0x100200388801000ULL,
+    0x640080080801004ULL,
+    0x44000800808004ULL,
+    0x802040080800200ULL,
+    0x129004000148ULL,
+    0x200009122000044ULL,
+    0x804000218000ULL,
+    0x6000c02010014002ULL,
+    0x402001010010ULL,
+    0x82002008120040ULL,
+    0x82002008120004ULL,
+    0x414040002008080ULL,
+    0x800080102040090ULL,
+    0x58000094004a0001ULL,
+    0x2000800040002080ULL,
+    0x8000200140008280ULL,
+    0x2011002004401100ULL,
+    0xa80801000080080ULL,
+    0xa08000408110100ULL,
+    0x4112001400800280ULL,
+    0x840100822210400ULL,
+    0x10008420410200ULL,
+    0x2800150210441ULL,
+    0x1204522180400105ULL,
+    0x50402001000811ULL,
+    0x1450210008041001ULL,
+    0x1000204080011ULL,
+    0x710008020c0003ULL,
+    0x22000088010402ULL,
+    0x40001880410c0022ULL
+};
+
+static const u64 bishop_magics[64] = {
+    0x812210011a040040ULL,
+    0x801210e160230ULL,
+    0x12080049010200ULL,
+    0x400404148000082aULL,
+    0x441104196004140ULL,
+    0x8982080289120424ULL,
+    0x38100a805400020ULL,
+    0x6001004a46201004ULL,
+    0x821002a80803a0ULL,
+    0x4082021042008502ULL,
+    0x8000118404004100ULL,
+    0x1002244048810840ULL,
+    0x900220210002430ULL,
+    0x18010422410410ULL,
+    0x400404908184019ULL,
+    0x1808004100a82080ULL,
+    0xc0000810014200ULL,
+    0x2008640410088220ULL,
+    0x2001004001021ULL,
+    0xc8000082024008ULL,
+    0x8084022083a00000ULL,
+    0x200804100a001ULL,
+    0x1504000201014900ULL,
+    0xa0020aa20802ULL,
+    0x20088005510400ULL,
+    0x484e001ca081300ULL,
+    0x8032022021040400ULL,
+    0x48080000220060ULL,
+    0x920020006405001ULL,
+    0xc000420001012114ULL,
+    0x840000a20800ULL,
+    0x9010203d04801ULL,
+    0x140202a00090a000ULL,
+    0x20008a100418b040ULL,
+    0x90108204500400ULL,
+    0x4020080880080ULL,
+    0x11110400060020ULL,
+    0x8100100249040ULL,
+    0x610020222209080ULL,
+    0x8022040602901ULL,
+    0xc242301a8800e000ULL,
+    0x200842420022200ULL,
+    0x805001082011001ULL,
+    0x104200800808ULL,
+    0x2001400102104100ULL,
+    0x4004009822000840ULL,
+    0x5280825040a0155ULL,
+    0x121140410802040ULL,
+    0x12020120080000ULL,
+    0x41140104028000ULL,
+    0x8292048a211080ULL,
+    0x8050000d08482480ULL,
+    0x402a0c0850241004ULL,
+    0x10400821210298ULL,
+    0x840028404008201ULL,
+    0x802084104008010ULL,
+    0x2100840490842000ULL,
+    0xc014404200900801ULL,
+    0x1041002842009000ULL,
+    0x21000008842400ULL,
+    0x10800009502400ULL,
+    0x42002120a02ULL,
+    0x2400200244010400ULL,
+    0x10200121020401c8ULL
+};
+
+static const i32 RBits[64] = {
+  12, 11, 11, 11, 11, 11, 11, 12,
+  11, 10, 10, 10, 10, 10, 10, 11,
+  11, 10, 10, 10, 10, 10, 10, 11,
+  11, 10, 10, 10, 10, 10, 10, 11,
+  11, 10, 10, 10, 10, 10, 10, 11,
+  11, 10, 10, 10, 10, 10, 10, 11,
+  11, 10, 10, 10, 10, 10, 10, 11,
+  12, 11, 11, 11, 11, 11, 11, 12
+};
+
+static const i32 BBits[64] = {
+  6, 5, 5, 5, 5, 5, 5, 6,
+  5, 5, 5, 5, 5, 5, 5, 5,
+  5, 5, 7, 7, 7, 7, 5, 5,
+  5, 5, 7, 9, 9, 7, 5, 5,
+  5, 5, 7, 9, 9, 7, 5, 5,
+  5, 5, 7, 7, 7, 7, 5, 5,
+  5, 5, 5, 5, 5, 5, 5, 5,
+  6, 5, 5, 5, 5, 5, 5, 6
+};
+
+/*
+ * Move masks
+ */
+static void generateKingMoveMasks(void) {
+    for (i32 square = 0; square < 64; square++) {
+        i32 rank = square / 8;
+        i32 file = square % 8;
+
+        kingMoves[square] = 0ULL;
+        if (rank > 0) {
+            kingMoves[square] |= 1ULL << (square - 8);
+            if (file > 0) kingMoves[square] |= 1ULL << (square - 9);
+            if (file < 7) kingMoves[square] |= 1ULL << (square - 7);
+        }
+        if (rank < 7) {
+            kingMoves[square] |= 1ULL << (square + 8);
+            if (file > 0) kingMoves[square] |= 1ULL << (square + 7); // Down-Left
+            if (file < 7) kingMoves[square] |= 1ULL << (square + 9); // Down-Right
+        }
+        if (file > 0) kingMoves[square] |= 1ULL << (square - 1); // Left
+        if (file < 7) kingMoves[square] |= 1ULL << (square + 1); // Right
+    }
+}
+
+static void setKnightMove(i32 square, i32 r, i32 f) {
+    if (r >= 0 && r < 8 && f >= 0 && f < 8)
+        knightMoves[square] |= 1ULL << (r * 8 + f);
+}
+
+static void generateKnightMoveMasks(void) {
+    for (i32 square = 0; square < 64; square++) {
+        i32 rank = square / 8;
+        i32 file = square % 8;
+
+        knightMoves[square] = 0ULL;
+
+        setKnightMove(square, rank - 2, file - 1);
+        setKnightMove(square, rank - 2, file + 1);
+        setKnightMove(square, rank - 1, file - 2);
+        setKnightMove(square, rank - 1, file + 2);
+        setKnightMove(square, rank + 1, file - 2);
+        setKnightMove(square, rank + 1, file + 2);
+        setKnightMove(square, rank + 2, file - 1);
+        setKnightMove(square, rank + 2, file + 1);
+    }
+}
+
+static void generatePawnMoveMasks(void){
+    for (i32 square = 0; square < 64; square++) {
+        i32 rank = square / 8;
+        i32 file = square % 8;
+
+        u64 position = 1ULL << square;
+
+        // For White Pawns
+        pawnMoves[square][0] = (rank < 7) ?  northOne(position) : 0ULL;
+        pawnMoves[square][1] = (rank == 1) ? northTwo(position) : 0ULL;
+        pawnMoves[square][2] = (file > 0 && rank < 7) ? noWeOne(position) : 0ULL;
+        pawnMoves[square][3] = (file < 7 && rank < 7) ? noEaOne(position) : 0ULL;
+
+        // For Black Pawns
+        pawnMoves[square][4] = (rank > 0) ?  southOne(position) : 0ULL;
+        pawnMoves[square][5] = (rank == 6) ? southTwo(position) : 0ULL;
+        pawnMoves[square][6] = (file > 0 && rank > 0) ? soWeOne(position) : 0ULL;
+        pawnMoves[square][7] = (file < 7 && rank > 0) ? soEaOne(position) : 0ULL;
+    }
+}
+
+/*
+ * Line masks
+ */
+static void generateBetweenMasks(void) {
+    for (i32 sq1 = 0; sq1 < 64; sq1++) {
+        i32 rank1 = sq1 / 8;
+        i32 file1 = sq1 % 8;
+
+        for (i32 sq2 = 0; sq2 < 64; sq2++) {
+            i32 rank2 = sq2 / 8;
+            i32 file2 = sq2 % 8;
+
+            if (sq1 == sq2) {
+                betweenMask[sq1][sq2] = 0;
+                continue;
+            }
+
+            u64 mask = 0;
+            
+            if (rank1 == rank2) {
+                for (i32 f = 1; f < abs(file2 - file1); f++) {
+                    i32 file = file1 + f * ((file2 > file1) ? 1 : -1);
+                    mask |= 1ULL << (rank1 * 8 + file);
+                }
+            } else if (file1 == file2) { 
+                for (i32 r = 1; r < abs(rank2 - rank1); r++) {
+                    i32 rank = rank1 + r * ((rank2 > rank1) ? 1 : -1);
+                    mask |= 1ULL << (rank * 8 + file1);
+                }
+            } else if (abs(rank1 - rank2) == abs(file1 - file2)) { 
+                for (i32 i = 1; i < abs(rank2 - rank1); i++) {
+                    i32 rank = rank1 + i * ((rank2 > rank1) ? 1 : -1);
+                    i32 file = file1 + i * ((file2 > file1) ? 1 : -1);
+                    mask |= 1ULL << (rank * 8 + file);
+                }
+            }
+
+            betweenMask[sq1][sq2] = mask;
+        }
+    }
+}
+
+static void generateRankMasks(void) {
+    for (i32 sq = 0; sq < 64; ++sq) {
+        i32 rank = sq / 8;
+        rankMask[sq] = 0xFFULL << (rank * 8);
+    }
+}
+
+static void generateFileMasks(void) {
+    for (i32 sq = 0; sq < 64; ++sq) {
+        i32 file = sq % 8;
+        fileMask[sq] = 0x0101010101010101ULL << file;
+    }
+}
+
+static void generateDiagonalMasks(void) {
+    for (i32 sq = 0; sq < 64; ++sq) {
+        i32 rank = sq / 8;
+        i32 file = sq % 8;
+        NESWMask[sq] = 0;
+        NWSEMask[sq] = 0;
+
+        // Northeast-Southwest Diagonal
+        for (i32 r = rank, f = file; r < 8 && f < 8; ++r, ++f)
+            NESWMask[sq] |= (1ULL << (r * 8 + f));
+        for (i32 r = rank, f = file; r >= 0 && f >= 0; --r, --f)
+            NESWMask[sq] |= (1ULL << (r * 8 + f));
+
+        // Northwest-Southeast Diagonal
+        for (i32 r = rank, f = file; r < 8 && f >= 0; ++r, --f)
+            NWSEMask[sq] |= (1ULL << (r * 8 + f));
+        for (i32 r = rank, f = file; r >= 0 && f < 8; --r, ++f)
+            NWSEMask[sq] |= (1ULL << (r * 8 + f));
+    }
+}
+
+/*
+ * Evaluation masks
+ */
+static void generateEvalMasks(void){
+    // Passed Pawn Mask
+    //     0 0 0
+    //     0 0 0
+    //       p 
+    for(Turn turn = 0; turn < 2; turn++){
+        for(Square sq = A1; sq < H8; sq++){
+            PassedPawnMask[turn][sq] = 0;
+            i32 file = sq % 8;
+            i32 rank = sq / 8;
+            for(i32 i = MAX(0, file-1); i <= MIN(7, file+1); i++){
+                u32  promo_sq = turn ? A8 + i : A1 + i;
+                u32 bottom_sq = (rank*8) + i;
+                PassedPawnMask[turn][sq] |= betweenMask[bottom_sq][promo_sq];
+            }
+        }
+    }
+
+    // King Area Mask
+    //      0
+    //    0 0 0
+    //  0 0 0 0 0
+    //    0 0 0
+    //      0
+    for(Square sq = A1; sq < H8; sq++){
+        u64 mask = 1ULL << sq;
+        mask |= kingMoves[sq];
+        mask |= northTwo(1ULL << sq);
+        mask |= southTwo(1ULL << sq);
+        mask |= westTwo(1ULL << sq);
+        mask |= eastTwo(1ULL << sq);
+        KingAreaMask[sq] = mask;
+    }
+}
+
+/*
+ * Slider attack tables
+ */
+static i32 count_1s(u64 b) {
+  return __builtin_popcountll(b);
+}
+
+// Deposits the bits of index into the set bits of m, the inverse of a PEXT by m
+static u64 index_to_uint64(i32 index, i32 bits, u64 m) {
+  u64 result = 0ULL;
+  for(i32 i = 0; i < bits; i++) {
+    i32 j = __builtin_ctzll(m);
+    m &= m - 1;
+    if(index & (1ULL << i)) result |= (1ULL << j);
+  }
+  return result;
+}
+
+static u64 rmask(i32 sq) {
+  u64 result = 0ULL;
+  i32 rk = sq/8, fl = sq%8, r, f;
+  for(r = rk+1; r <= 6; r++) result |= (1ULL << (fl + r*8));
+  for(r = rk-1; r >= 1; r--) result |= (1ULL << (fl + r*8));
+  for(f = fl+1; f <= 6; f++) result |= (1ULL << (f + rk*8));
+  for(f = fl-1; f >= 1; f--) result |= (1ULL << (f + rk*8));
+  return result;
+}
+
+static u64 bmask(i32 sq) {
+  u64 result = 0ULL;
+  i32 rk = sq/8, fl = sq%8, r, f;
+  for(r=rk+1, f=fl+1; r<=6 && f<=6; r++, f++) result |= (1ULL << (f + r*8));
+  for(r=rk+1, f=fl-1; r<=6 && f>=1; r++, f--) result |= (1ULL << (f + r*8));
+  for(r=rk-1, f=fl+1; r>=1 && f<=6; r--, f++) result |= (1ULL << (f + r*8));
+  for(r=rk-1, f=fl-1; r>=1 && f>=1; r--, f--) result |= (1ULL << (f + r*8));
+  return result;
+}
+
+static u64 ratt(i32 sq, u64 block) {
+  u64 result = 0ULL;
+  i32 rk = sq/8, fl = sq%8, r, f;
+  for(r = rk+1; r <= 7; r++) {
+    result |= (1ULL << (fl + r*8));
+    if(block & (1ULL << (fl + r*8))) break;
+  }
+  for(r = rk-1; r >= 0; r--) {
+    result |= (1ULL << (fl + r*8));
+    if(block & (1ULL << (fl + r*8))) break;
+  }
+  for(f = fl+1; f <= 7; f++) {
+    result |= (1ULL << (f + rk*8));
+    if(block & (1ULL << (f + rk*8))) break;
+  }
+  for(f = fl-1; f >= 0; f--) {
+    result |= (1ULL << (f + rk*8));
+    if(block & (1ULL << (f + rk*8))) break;
+  }
+  return result;
+}
+
+static u64 batt(i32 sq, u64 block) {
+  u64 result = 0ULL;
+  i32 rk = sq/8, fl = sq%8, r, f;
+  for(r = rk+1, f = fl+1; r <= 7 && f <= 7; r++, f++) {
+    result |= (1ULL << (f + r*8));
+    if(block & (1ULL << (f + r * 8))) break;
+  }
+  for(r = rk+1, f = fl-1; r <= 7 && f >= 0; r++, f--) {
+    result |= (1ULL << (f + r*8));
+    if(block & (1ULL << (f + r * 8))) break;
+  }
+  for(r = rk-1, f = fl+1; r >= 0 && f <= 7; r--, f++) {
+    result |= (1ULL << (f + r*8));
+    if(block & (1ULL << (f + r * 8))) break;
+  }
+  for(r = rk-1, f = fl-1; r >= 0 && f >= 0; r--, f--) {
+    result |= (1ULL << (f + r*8));
+    if(block & (1ULL << (f + r * 8))) break;
+  }
+  return result;
+}
+
+static void generateAttackTables(void){
+    i32 offset = 0;
+    for(i32 slider = 0; slider < 2; slider++){
+        for(i32 sq = 0; sq < 64; sq++){
+            u64 mask  = slider ? bmask(sq) : rmask(sq);
+            u64 magic = slider ? bishop_magics[sq] : rook_magics[sq];
+            i32 bits  = slider ? BBits[sq] : RBits[sq];
+            attackTableOffsets[slider * 64 + sq] = offset;
+
+            for(i32 blockers = 0; blockers < (1 << count_1s(mask)); blockers++){
+                u64 blocker_bits = index_to_uint64(blockers, count_1s(mask), mask);
+                u64 attacks = slider ? batt(sq, blocker_bits) : ratt(sq, blocker_bits);
+                u64 magic_idx = (blocker_bits * magic) >> (64 - bits);
+                if(magicAttackTable[offset + magic_idx] && magicAttackTable[offset + magic_idx] != attacks){
+                    fprintf(stderr, "Magic collision for %s at square %d\n", slider ? "bishop" : "rook", sq);
+                    exit(1);
+                }
+                magicAttackTable[offset + magic_idx] = attacks;
+                pextAttackTable[offset + blockers]   = attacks;
+            }
+            offset += 1 << count_1s(mask);
+        }
+    }
+    if(offset != ATTACK_TABLE_SIZE){
+        fprintf(stderr, "Attack table size %d does not match ATTACK_TABLE_SIZE\n", offset);
+        exit(1);
+    }
+}
+
+/*
+ * Output
+ */
+// Prints rows * cols values, nesting each row in braces when rows > 1
+static void printArray(const char* decl, const u64* values, i32 rows, i32 cols){
+    const char* indent = rows > 1 ? "\n        " : "\n    ";
+    printf("%s = {", decl);
+    for(i32 r = 0; r < rows; r++){
+        if(rows > 1) printf("\n    {");
+        for(i32 i = 0; i < cols; i++){
+            printf("%s0x%016" PRIx64 "ULL,", (i % 4) ? " " : indent, values[r * cols + i]);
+        }
+        if(rows > 1) printf("\n    },");
+    }
+    printf("\n};\n\n");
+}
+
+static void printSliderEntries(const char* decl, const char* table, i32 first, i32 is_pext){
+    printf("%s = {\n", decl);
+    for(i32 sq = 0; sq < 64; sq++){
+        i32 slider = first / 64;
+        u64 mask   = slider ? bmask(sq) : rmask(sq);
+        u64 magic  = is_pext ? 0ULL : (slider ? bishop_magics[sq] : rook_magics[sq]);
+        i32 shift  = is_pext ? 0 : 64 - (slider ? BBits[sq] : RBits[sq]);
+        printf("    {%s + %6d, 0x%016" PRIx64 "ULL, 0x%016" PRIx64 "ULL, %d},\n", table, attackTableOffsets[first + sq], mask, magic, shift);
+    }
+    printf("};\n\n");
+}
+
+i32 main(void){
+    generateKingMoveMasks();
+    generateKnightMoveMasks();
+    generatePawnMoveMasks();
+    generateBetweenMasks();
+    generateRankMasks();
+    generateFileMasks();
+    generateDiagonalMasks();
+    generateEvalMasks();
+    generateAttackTables();
+
+    printf("// Generated by tools/gentables.c, do not edit\n\n");
+    printf("#include \"bitboard.h\"\n");
+    printf("#include \"magic.h\"\n");
+    printf("#include \"../masks.h\"\n\n");
+
+    printArray("const u64 kingMoves[64]",         kingMoves,             1,  64);
+    printArray("const u64 knightMoves[64]",       knightMoves,           1,  64);
+    printArray("const u64 pawnMoves[64][8]",      &pawnMoves[0][0],      64, 8);
+    printArray("const u64 betweenMask[64][64]",   &betweenMask[0][0],    64, 64);
+    printArray("const u64 rankMask[64]",          rankMask,              1,  64);
+    printArray("const u64 fileMask[64]",          fileMask,              1,  64);
+    printArray("const u64 NESWMask[64]",          NESWMask,              1,  64);
+    printArray("const u64 NWSEMask[64]",          NWSEMask,              1,  64);
+    printArray("const u64 PassedPawnMask[2][64]", &PassedPawnMask[0][0], 2,  64);
+    printArray("const u64 KingAreaMask[64]",      KingAreaMask,          1,  64);
+
+    printArray("static const u64 magicAttackTable[ATTACK_TABLE_SIZE]", magicAttackTable, 1, ATTACK_TABLE_SIZE);
+    printSliderEntries("const SMagic mRookTbl[64]",   "magicAttackTable", 0,  FALSE);
+    printSliderEntries("const SMagic mBishopTbl[64]", "magicAttackTable", 64, FALSE);
+
+    printf("#ifdef PEXT_BUILD\n");
+    printArray("static const u64 pextAttackTable[ATTACK_TABLE_SIZE]", pextAttackTable, 1, ATTACK_TABLE_SIZE);
+    printSliderEntries("const SMagic mRookPextTbl[64]",   "pextAttackTable", 0,  TRUE);
+    printSliderEntries("const SMagic mBishopPextTbl[64]", "pextAttackTable", 64, TRUE);
+    printf("#endif\n");
+    return 0;
+}
@@ -0,0 +1,134 @@
+/*
+ * Perft suite runner, checks every ;Dn count of an epd file up to a depth
+ *   craig-perftsuite.engine [epd] [depth] [jobs] [threads]
+ * jobs positions are run at the same time, each perft with threads threads.
+ * Prints one line per position and a summary line, all as "key value" pairs,
+ * and exits with 1 if any count is wrong
+ */
+#include "../types.h"
+#include "../util.h"
+#include "../perft.h"
+#include "../transposition.h"
+#include "../hash.h"
+#include "../bitboard/bbutils.h"
+#include "../bitboard/magic.h"
+#include <ctype.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+#define SUITE_MAX_POSITIONS 1024
+#define SUITE_LINE_SIZE     512
+
+typedef struct {
+    char fen[SUITE_LINE_SIZE];
+    char counts[SUITE_LINE_SIZE]; // Everything after the first ';'
+} SuitePosition;
+
+static SuitePosition positions[SUITE_MAX_POSITIONS];
+static u32 n_positions = 0;
+static i32 max_depth = 6;
+static u32 perft_threads = 1;
+
+static _Atomic u32 next_position = 0;
+static _Atomic u32 failed = 0;
+static _Atomic u64 total_nodes = 0;
+
+static u64 now_us(){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (u64)ts.tv_sec * 1000000 + (u64)ts.tv_nsec / 1000;
+}
+
+static i32 load_suite(const char* path){
+    FILE* file = fopen(path, "r");
+    if(file == NULL){
+        perror(path);
+        return -1;
+    }
+    char line[SUITE_LINE_SIZE];
+    while(n_positions < SUITE_MAX_POSITIONS && fgets(line, sizeof(line), file)){
+        char* counts = strchr(line, ';');
+        if(counts == NULL) continue;
+        *counts++ = '\0';
+        for(char* end = counts - 2; end >= line && isspace((unsigned char)*end); end--) *end = '\0';
+        counts[strcspn(counts, "\r\n")] = '\0';
+        snprintf(positions[n_positions].fen,    SUITE_LINE_SIZE, "%s", line);
+        snprintf(positions[n_positions].counts, SUITE_LINE_SIZE, "%s", counts);
+        n_positions++;
+    }
+    fclose(file);
+    return 0;
+}
+
+/*
+ * Runs every expected count of the position up to max_depth
+ */
+static void run_position(u32 idx){
+    SuitePosition* sp = &positions[idx];
+    Position pos = fen_to_position(sp->fen);
+    u64 nodes = 0, start = now_us();
+    i32 depth_reached = 0;
+    u8 pass = TRUE;
+
+    for(i32 depth = 1; depth <= max_depth; depth++){
+        i64 expected = get_perft_fen_depth(sp->counts, depth);
+        if(expected == -1) continue;
+        u64 found = perft_run(pos, depth, perft_threads, FALSE);
+        nodes += found;
+        depth_reached = depth;
+        if((i64)found != expected){
+            printf("mismatch position %u depth %d nodes %" PRIu64 " expected %" PRIi64 " fen %s\n",
+                   idx + 1, depth, found, expected, sp->fen);
+            pass = FALSE;
+        }
+    }
+
+    u64 elapsed = MAX(now_us() - start, 1);
+    printf("position %u depth %d nodes %" PRIu64 " time_us %" PRIu64 " nps %" PRIu64 " result %s fen %s\n",
+           idx + 1, depth_reached, nodes, elapsed, nodes * 1000000 / elapsed, pass ? "pass" : "fail", sp->fen);
+    fflush(stdout);
+
+    atomic_fetch_add(&total_nodes, nodes);
+    if(!pass) atomic_fetch_add(&failed, 1);
+}
+
+static void* suite_worker(void* arg){
+    (void)arg;
+    u32 idx;
+    while((idx = atomic_fetch_add(&next_position, 1)) < n_positions) run_position(idx);
+    return NULL;
+}
+
+i32 main(i32 argc, char** argv){
+    const char* path = argc > 1 ? argv[1] : "../perftsuite.epd";
+    if(argc > 2) max_depth = atoi(argv[2]);
+    u32 jobs = argc > 3 ? (u32)MAX(atoi(argv[3]), 1) : 1;
+    if(argc > 4) perft_threads = (u32)MAX(atoi(argv[4]), 1);
+
+    selectSliderBackend();
+    initZobrist();
+    if(init_tt(TT_MIN_SIZE_MB)) return 1; // make_move prefetches from the TT
+    if(load_suite(path)) return 1;
+
+    jobs = MIN(jobs, MAX(n_positions, 1));
+    pthread_t workers[jobs];
+    u64 start = now_us();
+    u32 started = 0;
+    for(u32 i = 1; i < jobs; i++){
+        if(pthread_create(&workers[i], NULL, suite_worker, NULL)) break;
+        started++;
+    }
+    suite_worker(NULL);
+    for(u32 i = 1; i <= started; i++) pthread_join(workers[i], NULL);
+    u64 elapsed = MAX(now_us() - start, 1);
+
+    printf("summary positions %u failed %u depth %d jobs %u threads %u nodes %" PRIu64 " time_us %" PRIu64 " nps %" PRIu64 "\n",
+           n_positions, (u32)failed, max_depth, started + 1, perft_threads, (u64)total_nodes, elapsed,
+           (u64)total_nodes * 1000000 / elapsed);
+    tt_free();
+    return failed ? 1 : 0;
+}
@@ -1,94 +1,290 @@
 #include "transposition.h"
 #include "types.h"
+#include "util.h"
 #include <stdatomic.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
 
+#include <pthread.h>
+
 #if defined(__linux__)
     #include <sys/mman.h>
 #endif
 
-TTEntry* table = NULL;
+TTBucket* table = NULL;
 u64 key_mask = 0;
 
+static u8 tt_generation = 0; // Age stamped on entries stored during the current search
+static u64 table_bytes = 0;  // Size of the current allocation, needed to unmap it
+
+static const char* tt_backing = "";
+
+/*
+ * Unmaps a table allocated by init_tt
+ */
+static void tt_unmap(TTBucket *mem, u64 bytes){
+#if defined(__linux__) && !defined(__ANDROID__)
+    munmap(mem, bytes);
+#elif defined(_WIN32) || defined(_WIN64)
+    (void)bytes;
+    _aligned_free(mem);
+#else
+    (void)bytes;
+    free(mem);
+#endif
+}
+
+/*
+ * Allocates a table of size_mb and swaps it in for the current one
+ * On failure the current table is kept and -1 is returned
+ */
 i32 init_tt(i32 size_mb){
     const uint64_t MB = 1ull << 20;
-    if(table) tt_free();
 
-    // Calculate the table size that is less than or equal to the requested size in MB
+    size_mb = MAX(TT_MIN_SIZE_MB, MIN(size_mb, TT_MAX_SIZE_MB));
+
+    // Calculate the bucket count that is less than or equal to the requested size in MB
     u64 table_size = 1;
-    while ((table_size) * sizeof(TTEntry) <= size_mb * MB / 2) table_size = table_size << 1;
-    key_mask = table_size - 1;
+    while ((table_size) * sizeof(TTBucket) <= size_mb * MB / 2) table_size = table_size << 1;
+    u64 new_bytes = table_size * sizeof(TTBucket);
+    TTBucket *new_table = NULL;
+    const char* new_backing = "normal pages";
 
-    // On linux systems we want to specify the page for better perfomance
+    // On linux systems we want to back the table with huge pages for fewer TLB misses.
+    // Explicit huge pages need to be reserved by the admin, so fall back to asking for
+    // transparent huge pages and finally to normal pages.
 #if defined(__linux__) && !defined(__ANDROID__)
-    if(size_mb >= 2){
-        table = aligned_alloc(2 * MB, table_size * sizeof(TTEntry));
-        madvise(table, table_size * sizeof(TTEntry), MADV_HUGEPAGE);
+    #ifdef MAP_HUGETLB
+    if(new_bytes >= TT_HUGE_PAGE_SIZE){
+        void *mem = mmap(NULL, new_bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if(mem != MAP_FAILED){
+            new_table = mem;
+            new_backing = "explicit huge pages";
+        }
+    }
+    #endif
+    if(!new_table){
+        void *mem = mmap(NULL, new_bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if(mem != MAP_FAILED){
+            new_table = mem;
+            #ifdef MADV_HUGEPAGE
+            if(new_bytes >= TT_HUGE_PAGE_SIZE && !madvise(new_table, new_bytes, MADV_HUGEPAGE)){
+                new_backing = "transparent huge pages";
+            }
+            #endif
+        }
     }
-    else table = (TTEntry*)calloc(table_size, sizeof(TTEntry));
+#elif defined(_WIN32) || defined(_WIN64)
+    new_table = _aligned_malloc(new_bytes, sizeof(TTBucket));
 #else
-    table = (TTEntry*)calloc(table_size, sizeof(TTEntry));
+    new_table = aligned_alloc(sizeof(TTBucket), new_bytes);
 #endif
-    
-    if(!table){
-        printf("info string Failure to allocate Transposition table");
+
+    if(!new_table){
+        printf("info string Failure to allocate Transposition table\n");
         return -1;
     }
-    
+
+    // Only let go of the old table once the new one exists
+    tt_free();
+    table = new_table;
+    table_bytes = new_bytes;
+    key_mask = table_size - 1;
+    tt_backing = new_backing;
+
     tt_clear();
 
-    long long tt_size = table_size * sizeof(TTEntry);
-    printf("info string TTEntry Size: %d, Transposition table size: %lld Mb\n", (int)sizeof(TTEntry), tt_size/MB);
+    printf("info string TTEntry Size: %d, Bucket Size: %d, Transposition table size: %lld Mb, backed by %s\n",
+           (int)sizeof(TTEntry), (int)sizeof(TTBucket), (long long)(table_bytes / MB), tt_backing);
     return 0;
 }
 
 i32 tt_free(){
-    free(table);
+    if(!table) return 0;
+    tt_unmap(table, table_bytes);
+    table = NULL;
+    table_bytes = 0;
+    key_mask = 0;
     return 0;
 }
 
+/*
+ * Returns the size of the current table in MB
+ */
+i32 tt_size_mb(){
+    return (i32)(table_bytes >> 20);
+}
+
+typedef struct {
+    u8 *start;
+    u64 len;
+} TTClearChunk;
+
+static void* tt_clear_chunk(void *arg){
+    TTClearChunk *chunk = arg;
+    memset(chunk->start, 0, chunk->len);
+    return NULL;
+}
+
+/*
+ * Returns how many threads to split clearing the table between
+ */
+static i32 tt_clear_thread_count(){
+    i32 cpus = cpu_count();
+    i32 by_size = (i32)(table_bytes / TT_CLEAR_CHUNK_SIZE);
+    return MAX(1, MIN(MIN(cpus, by_size), TT_MAX_CLEAR_THREADS));
+}
+
+/*
+ * Zeroes the table, large tables are split between threads
+ * which also spreads the first touch of the pages across cores
+ */
 void tt_clear(){
-    memset(table, 0, (key_mask+1)*sizeof(TTEntry));
+    if(!table) return;
+    i32 thread_count = tt_clear_thread_count();
+    pthread_t threads[TT_MAX_CLEAR_THREADS];
+    TTClearChunk chunks[TT_MAX_CLEAR_THREADS];
+
+    u64 chunk_len = table_bytes / thread_count; // Table size is a power of two so this stays bucket aligned
+    i32 launched = 0;
+    for(i32 i = 0; i < thread_count; i++){
+        chunks[i].start = (u8*)table + i * chunk_len;
+        chunks[i].len = i == thread_count - 1 ? table_bytes - i * chunk_len : chunk_len;
+        if(i == thread_count - 1 || pthread_create(&threads[launched], NULL, tt_clear_chunk, &chunks[i])){
+            tt_clear_chunk(&chunks[i]); // Last chunk (or a failed launch) is cleared on this thread
+        } else launched++;
+    }
+    for(i32 i = 0; i < launched; i++) pthread_join(threads[i], NULL);
+    tt_generation = 0;
 }
 
-TTEntryData get_tt_entry(u64 hash){
+/*
+ * Advances the generation, called once at the start of each search
+ * so entries from previous searches become cheaper to replace
+ */
+void tt_new_search(){
+    tt_generation = (tt_generation + 1) % TT_AGE_CYCLE;
+}
+
+/*
+ * Returns how many searches ago the entry was stored
+ */
+static inline i32 tt_entry_age(TTEntryData tt_data){
+    return (tt_generation - tt_data.fields.age) & (TT_AGE_CYCLE - 1);
+}
+
+/*
+ * Returns the value of keeping an entry, the lowest valued entry in a bucket gets replaced
+ */
+static inline i32 tt_entry_value(TTEntryData tt_data){
+    i32 value = tt_data.fields.depth - TT_AGE_WEIGHT * tt_entry_age(tt_data);
+    if(tt_data.fields.node_type == PV_NODE) value += TT_PV_BONUS;
+    return value;
+}
+
+/*
+ * Returns the permille of the table filled by the current search (for uci hashfull)
+ */
+i32 tt_hashfull(){
+    i32 count = 0;
+    i32 sample = MIN(1000 / TT_BUCKET_SIZE, (i32)(key_mask + 1));
+    for(i32 i = 0; i < sample; i++){
+        for(i32 j = 0; j < TT_BUCKET_SIZE; j++){
+            TTEntryData tt_data;
+            tt_data.data = atomic_load(&table[i].entry[j].data);
+            if(tt_data.data && tt_entry_age(tt_data) == 0) count++;
+        }
+    }
+    return count * 1000 / (sample * TT_BUCKET_SIZE);
+}
+
+#define TT_STATIC_EVAL_MASK ((1ULL << TT_STATIC_EVAL_BITS) - 1)
+
+static inline u8 tt_entry_matches(u64 hash, u64 data, u64 check){
+    return ((hash ^ data ^ check) & ~TT_STATIC_EVAL_MASK) == 0;
+}
+
+static inline i32 tt_static_eval(u64 check){
+    return (i16)(check & TT_STATIC_EVAL_MASK);
+}
+
+/*
+ * Returns the entry stored for hash, 0 when there is none
+ * static_eval, if not NULL, is set to the static eval stored with it or NO_STATIC_EVAL
+ */
+TTEntryData get_tt_entry(u64 hash, i32 *static_eval){
     TTEntryData tt_data;
-    TTEntry tt_entry;
-    for(i32 i = 0; i < TT_ROTATION; i++){
-        u64 key = (hash + i) & key_mask;
-        tt_entry.data = atomic_load(&table[key].data);
-        tt_entry.hash = atomic_load(&table[key].hash);
-        if((tt_entry.data ^ tt_entry.hash) == hash){
-            tt_data.data = tt_entry.data;
+    TTBucket *bucket = &table[hash & key_mask];
+    for(i32 i = 0; i < TT_BUCKET_SIZE; i++){
+        u64 data  = atomic_load(&bucket->entry[i].data);
+        u64 check = atomic_load(&bucket->entry[i].check);
+        if(data && tt_entry_matches(hash, data, check)){
+            if(static_eval) *static_eval = tt_static_eval(check);
+            tt_data.data = data;
             return tt_data;
-        }   
+        }
     }
+    if(static_eval) *static_eval = NO_STATIC_EVAL;
     tt_data.data = 0;
     return tt_data;
 }
 
-void store_tt_entry(u64 hash, char depth, i32 eval, char node_type, Move move){
+/*
+ * Stores a search result, static_eval is kept only when it fits the entry's 16 bits
+ * and a result stored without one keeps the static eval the entry already has
+ */
+void store_tt_entry(u64 hash, char depth, i32 eval, char node_type, Move move, i32 static_eval){
+    TTBucket *bucket = &table[hash & key_mask];
+    TTEntry *replace = &bucket->entry[0];
     TTEntryData tt_data;
-    for(i32 i = 0; i < TT_ROTATION; i++){
-        u64 key = (hash + i) & key_mask;
-        tt_data.data = atomic_load(&table[key].data);
-        if(node_type != PV_NODE && (tt_data.fields.node_type == PV_NODE)){
-            continue;
+    i32 replace_value = INT32_MAX;
+    u8 found = FALSE;
+    u64 found_check = 0;
+
+    if(static_eval <= INT16_MIN || static_eval > INT16_MAX) static_eval = NO_STATIC_EVAL;
+
+    for(i32 i = 0; i < TT_BUCKET_SIZE; i++){
+        TTEntry *entry = &bucket->entry[i];
+        u64 data  = atomic_load(&entry->data);
+        u64 check = atomic_load(&entry->check);
+
+        // Same position or an empty slot, always use it
+        if(!data || tt_entry_matches(hash, data, check)){
+            replace = entry;
+            tt_data.data = data;
+            found = data != 0;
+            found_check = check;
+            break;
         }
-        if(depth < tt_data.fields.depth){
-            continue;
+
+        tt_data.data = data;
+        i32 value = tt_entry_value(tt_data);
+        if(value < replace_value){
+            replace_value = value;
+            replace = entry;
         }
-        tt_data.fields.eval = eval;
-        tt_data.fields.depth = depth;
-        tt_data.fields.move = move;
-        tt_data.fields.node_type = node_type;
-        hash ^= tt_data.data;
-        atomic_store(&table[key].data, tt_data.data);
-        atomic_store(&table[key].hash, hash);
-        return;
     }
-}
 
-    
+    if(found){
+        if(static_eval == NO_STATIC_EVAL) static_eval = tt_static_eval(found_check);
+        // Keep a deeper result from this search unless the new one is exact,
+        // only adding the static eval when it has none
+        if(tt_entry_age(tt_data) == 0 && node_type != PV_NODE && depth < tt_data.fields.depth){
+            if(static_eval != tt_static_eval(found_check)){
+                atomic_store(&replace->check, ((hash ^ tt_data.data) & ~TT_STATIC_EVAL_MASK) | (u16)static_eval);
+            }
+            return;
+        }
+        // Dont lose the best move when the new result has none
+        if(move == NO_MOVE) move = tt_data.fields.move;
+    }
+
+    tt_data.fields.eval = eval;
+    tt_data.fields.depth = depth;
+    tt_data.fields.move = move;
+    tt_data.fields.node_type = node_type;
+    tt_data.fields.age = tt_generation;
+    atomic_store(&replace->data, tt_data.data);
+    atomic_store(&replace->check, ((hash ^ tt_data.data) & ~TT_STATIC_EVAL_MASK) | (u16)static_eval);
+}
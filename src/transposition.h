@@ -11,23 +11,48 @@ enum {
     CUT_NODE = 2,
     ALL_NODE = 3,
 
-    TT_ROTATION = 3,
+    TT_BUCKET_SIZE = 4,  // Entries sharing one cache line
+    TT_AGE_BITS    = 6,  // Bits used to store the search generation
+    TT_AGE_CYCLE   = 1 << TT_AGE_BITS,
+    TT_AGE_WEIGHT  = 8,  // Depth an entry loses in value for every search it is old
+    TT_PV_BONUS    = 2,  // Depth an exact entry gains in value when picking a replacement
+
+    TT_DEFAULT_SIZE_MB = 16,
+    TT_MIN_SIZE_MB     = 4,  // Smallest table with 1 << TT_STATIC_EVAL_BITS buckets, see TTEntry
+    TT_MAX_SIZE_MB     = 65536,
+
+    TT_HUGE_PAGE_SIZE    = 2 << 20,  // Smallest table worth backing with huge pages
+    TT_CLEAR_CHUNK_SIZE  = 32 << 20, // Each clearing thread gets at least this many bytes
+    TT_MAX_CLEAR_THREADS = 64,
+
+    TT_STATIC_EVAL_BITS = 16, // Low bits of the check word holding the static eval
 };
 
+#define NO_STATIC_EVAL INT16_MIN // Static eval of an entry stored without one
+
 #pragma pack(1)
 typedef struct {
     u8 depth;
     Move move;
-    u8 node_type;
+    u8 node_type : 2;
+    u8 age : TT_AGE_BITS; // Generation of the search that stored the entry
     i32 eval;
 } TTEntryFields;
 #pragma pack()
 
+/*
+ * check holds hash ^ data above the static eval, an entry torn by another thread fails to verify
+ * The low bits of the hash it leaves out are the bucket index, so the whole key is still checked
+ */
 typedef struct {
     alignas(8) _Atomic u64 data;
-    alignas(8) _Atomic u64 hash;
+    alignas(8) _Atomic u64 check;
 } TTEntry;
 
+typedef struct {
+    alignas(64) TTEntry entry[TT_BUCKET_SIZE];
+} TTBucket;
+
 typedef union {
     u64 data;
     TTEntryFields fields;
@@ -35,11 +60,30 @@ typedef union {
 
 _Static_assert(sizeof(TTEntryData)   == 8, "Size of TTEntryData is not 64 bits");
 _Static_assert(sizeof(TTEntryFields) == 8, "Size of TTEntryFields is not 64 bits");
+_Static_assert(sizeof(TTBucket)     == 64, "Size of TTBucket is not a cache line");
+
+extern TTBucket* table;
+extern u64 key_mask;
+
+/*
+ * Starts loading the bucket for hash into cache, issued before making a move
+ * so the memory latency overlaps with the make move work
+ */
+static inline void tt_prefetch(u64 hash){
+#if defined(__GNUC__) || defined(__clang__)
+    __builtin_prefetch(&table[hash & key_mask]);
+#else
+    (void)hash;
+#endif
+}
 
 i32 init_tt(i32 size_mb);
 i32 tt_free();
+i32 tt_size_mb();
 void tt_clear();
-void store_tt_entry(u64 hash, char depth, i32 eval, char node_type, Move move);
+void tt_new_search();
+i32 tt_hashfull();
+void store_tt_entry(u64 hash, char depth, i32 eval, char node_type, Move move, i32 static_eval);
 
-TTEntryData get_tt_entry(u64 hash);
-#endif
\ No newline at end of file
+TTEntryData get_tt_entry(u64 hash, i32 *static_eval);
+#endif
@@ -17,6 +17,7 @@
 #include "tables.h"
 #include "bitboard/bbutils.h"
 #include "params.h"
+#include "timeman.h"
 
 
 typedef enum searchs{
@@ -170,61 +171,37 @@ static double calculateEBF(){
 }
 #endif
 
-#define TT_MOVE_BONUS       3000000 // Bonus for move being in the TT
-#define CAPTURE_MOVE_BONUS  2000000 // Bonus for move being a capture
-#define KILLER_MOVE_BONUS   1000000 // Bonus for move being killer move
-
-u32 select_sort(ThreadData *td, u32 i, u32 evalIdx, Move *moveList, i32 *moveVals, u32 size, Move ttMove, u32 ply) {
-   u32 maxIdx = i;
-
-   if(moveList[i] == ttMove){
-      moveVals[i] = TT_MOVE_BONUS;
-      return evalIdx; // Return if the next move is the TTMove
-   }
-
-   if(i <= evalIdx){
-      moveVals[i] = eval_move(moveList[i], &td->pos);
-      if(GET_FLAGS(moveList[i]) > DOUBLE_PAWN_PUSH){
-         moveVals[i] += CAPTURE_MOVE_BONUS;
-      } else if(isKillerMove(&td->km, moveList[i], ply)){
-         moveVals[i] += KILLER_MOVE_BONUS;
-      }
-      evalIdx = i+1;
-   }
-
-   for (u32 j = i + 1; j < size; j++) {
-      if(moveList[j] == ttMove){ // If the move is in the TT sort immediately
-         maxIdx = j;
-         moveVals[j] = TT_MOVE_BONUS;
-         break;
-      }
-
-      if(j <= evalIdx){ // If the move hasn't been evaluated yet calculate score
-         moveVals[j] = eval_move(moveList[j], &td->pos);
-         if(GET_FLAGS(moveList[j]) > DOUBLE_PAWN_PUSH){
-            moveVals[j] += CAPTURE_MOVE_BONUS;
-         } else if(isKillerMove(&td->km, moveList[j], ply)){
-            moveVals[j] += KILLER_MOVE_BONUS;
-         }
-         evalIdx = j+1;
-      }
-
-      if (moveVals[j] > moveVals[maxIdx]) {
-         maxIdx = j;
-      }
+/*
+ * Checks the stop flag every STOP_POLL_NODES nodes rather than on every node,
+ * the main thread also checks the clock against the hard time limit.
+ * The node limit is checked on every node so a search stops on exactly the same node each run,
+ * like the time limit it only applies once a best move has been found.
+ * Once stopped each node returns 0 and the callers unwind without storing results
+ */
+static inline u8 search_stopped(ThreadData *td){
+   if(td->stopped) return TRUE;
+   if(td->node_limit && td->stats.search_nodes >= td->node_limit && best_move_found){
+      td->stopped = TRUE;
+      return TRUE;
    }
+   if(++td->stop_poll < STOP_POLL_NODES) return FALSE;
+   td->stop_poll = 0;
+   if(!td->is_helper_thread && best_move_found && tm_hard_limit_hit()) search_out_of_time();
+   td->stopped = !run_get_best_move;
+   return td->stopped;
+}
 
-   if (maxIdx != i) { // Swap the moves
-      i32 tempVal = moveVals[i];
-      moveVals[i] = moveVals[maxIdx];
-      moveVals[maxIdx] = tempVal;
-
-      Move tempMove = moveList[i];
-      moveList[i] = moveList[maxIdx];
-      moveList[maxIdx] = tempMove;
-   }
+/*
+ * Adds to one of the thread's search counters, only the owning thread writes them
+ * so a relaxed load and store is enough and compiles to a plain add
+ */
+static inline void add_stat(ThreadData *td, SearchCounter counter, u64 n){
+   _Atomic u64 *count = &td->counters.count[counter];
+   atomic_store_explicit(count, atomic_load_explicit(count, memory_order_relaxed) + n, memory_order_relaxed);
+}
 
-   return evalIdx;
+static inline void count_stat(ThreadData *td, SearchCounter counter){
+   add_stat(td, counter, 1);
 }
 
 /*
@@ -250,22 +227,13 @@ static inline void q_select_sort(i32 i, Move *moveList, i32 *moveVals, i32 size)
    }
 }
 
-/*
- * Select sort for the helper search with slightly different ordering
- */
-static inline u32 helper_select_sort(ThreadData *td, u32 i, u32 evalIdx, Move *moveList, i32 *moveVals, u32 size, Move ttMove, u32 ply) {
-   i32 thread_dif = (td->thread_num % 2) ? -1 : 1;
-   moveVals[i] += ((i32)i * HELPER_MOVE_DISORDER) + (thread_dif * (i32)td->thread_num * HELPER_THREAD_DISORDER);
-   select_sort(td, i, evalIdx, moveList, moveVals, size, ttMove, ply);
-   return evalIdx;
-}
 
 /*
  * On a TT hit in the mainline fills the pv array with the PV for printing
  */
 static inline void pvFill(Position pos, Move* pv_array, u8 depth){
    u8 ply = 0;
-   TTEntryData ttEntry = get_tt_entry(pos.hash);
+   TTEntryData ttEntry = get_tt_entry(pos.hash, NULL);
    while(ttEntry.data && ttEntry.fields.depth > 0 && ply < depth){
       pv_array[ply] = ttEntry.fields.move;
       #ifdef DEBUG
@@ -273,7 +241,7 @@ static inline void pvFill(Position pos, Move* pv_array, u8 depth){
       #endif
       _make_move(&pos, ttEntry.fields.move);
       ply++;
-      ttEntry = get_tt_entry(pos.hash);
+      ttEntry = get_tt_entry(pos.hash, NULL);
    }
    while(ply < depth){
       pv_array[ply] = NO_MOVE;
@@ -314,7 +282,7 @@ i32 search_tree(ThreadData *td){
       eval = pv_search(td, q-asp_lower, q+asp_upper, td->depth, 0);
       td->pos = prev_pos;
       while(eval <= q-asp_lower || eval >= q+asp_upper || td->pv_array[0] == NO_MOVE){
-         if(abs(eval) == CHECKMATE_VALUE) break;
+         if(td->stopped || abs(eval) == CHECKMATE_VALUE) break;
          if(eval <= q-asp_lower){
             asp_upper = ASP_EDGE;
             asp_lower = (asp_lower + ASP_EDGE) * 2;
@@ -344,6 +312,7 @@ i32 search_tree(ThreadData *td){
       }
    }
    pvFill(td->pos, td->pv_array, td->depth);
+   if(!td->stopped) count_stat(td, STAT_ITERATIONS);
 
    #ifdef DEBUG
    if(debug_print_search){
@@ -363,12 +332,13 @@ i32 search_tree(ThreadData *td){
  * Search tree function called from a helper thread with slightly different bounds and move sorting
  */
 i32 helper_search_tree(ThreadData *td, u32 depth, i32 eval){
+   startStats(&td->stats);
    i32 asp_lower, asp_upper;
    asp_upper = asp_lower = HELPER_ASP_EDGE;
    i32 q = eval;
    eval = helper_pv_search(td, q-asp_lower, q+asp_upper, depth, 0);
    while(eval <= q-asp_lower || eval >= q+asp_upper || td->pv_array[0] == NO_MOVE){
-      if(abs(eval) == CHECKMATE_VALUE) break;
+      if(td->stopped || abs(eval) == CHECKMATE_VALUE) break;
       if(eval <= q-asp_lower){
          asp_upper = HELPER_ASP_EDGE;
          asp_lower = (asp_lower + HELPER_ASP_EDGE) * 2;
@@ -384,6 +354,9 @@ i32 helper_search_tree(ThreadData *td, u32 depth, i32 eval){
       q = eval;
       eval = helper_pv_search(td, q-asp_lower, q+asp_upper, depth, 0);
    }
+   pvFill(td->pos, td->pv_array, depth);
+   if(!td->stopped) count_stat(td, STAT_ITERATIONS);
+   stopStats(&td->stats);
    return eval;
 }
 
@@ -434,9 +407,11 @@ static inline u8 getLMRDepth(u8 curDepth, u8 moveIdx, u8 moveCount, Move move, i
 i32 pv_search(ThreadData *td, i32 alpha, i32 beta, i8 depth, u8 ply) {
    //printf("Depth = %d, Ply = %d, Depth+ply = %d\n", depth, ply, depth+ply);
    Position *pos = &td->pos;
-   if(!run_get_best_move) exit_search();
+   if(search_stopped(td)) return 0;
 
    td->stats.node_count++;
+   td->stats.search_nodes++;
+   count_stat(td, STAT_PVS_NODES);
    #ifdef DEBUG
    debug[PVS][NODE_COUNT]++;
    #endif
@@ -444,38 +419,24 @@ i32 pv_search(ThreadData *td, i32 alpha, i32 beta, i8 depth, u8 ply) {
 
    if(ply != 0 && (pos->halfmove_clock >= 100 || isInsufficient(pos) || isRepetition(td))) return 0;
 
-   Move moveList[MAX_MOVES];
-   i32 moveVals[MAX_MOVES];
-   u32 size = generateLegalMoves(pos, moveList);
-   for(u32 i = 0; i < size; i++){
-      moveVals[i] = 0;
-   }
-
-   //Store the list of moves and their evaluations at the start
-   #ifdef DEBUG
-   //Store the values at the starting time
+   //Handle Draw, Mate, or single move at the root, other nodes find out once the moves run out
    if(ply == 0){
-      debug_size[0] = size;
-      memcpy(debug_moveList[0], moveList, size*sizeof(i32));
-      memcpy(debug_moveVals[0], moveVals, size*sizeof(i32));
-   }
-   #endif
-
-
-   //Handle Draw, Mate, or single move
-   if(size == 0){
-      if(td->time_pref && ply == 0) td->time_pref = HALT_TIME;
-      if(pos->flags & IN_CHECK) return -(CHECKMATE_VALUE - ply);
-      else return 0;
-   }
-   else if(size == 1 && td->time_pref && ply == 0){
-      td->time_pref = HALT_TIME;
+      Move rootList[MAX_MOVES];
+      u32 root_size = generateLegalMoves(pos, rootList);
+      if(root_size <= 1) td->time_pref = HALT_TIME;
+      if(root_size == 0){
+         if(pos->flags & IN_CHECK) return -(CHECKMATE_VALUE - ply);
+         else return 0;
+      }
    }
 
    //Test the TT table
-   TTEntryData ttEntry = get_tt_entry(pos->hash);
+   i32 static_eval;
+   TTEntryData ttEntry = get_tt_entry(pos->hash, &static_eval);
    Move ttMove = NO_MOVE;
+   count_stat(td, STAT_TT_PROBES);
    if (ttEntry.data) {
+      count_stat(td, STAT_TT_HITS);
       #ifdef DEBUG
       debug[PVS][NODE_TT_HIT]++;
       #endif
@@ -486,6 +447,7 @@ i32 pv_search(ThreadData *td, i32 alpha, i32 beta, i8 depth, u8 ply) {
                #ifdef DEBUG
                debug[PVS][NODE_TT_PVS_RET]++;
                #endif
+               count_stat(td, STAT_TT_CUTS);
                td->pv_array[ply] = ttEntry.fields.move;
                return ttEntry.fields.eval;
             case CUT_NODE: // Lower bound
@@ -493,6 +455,7 @@ i32 pv_search(ThreadData *td, i32 alpha, i32 beta, i8 depth, u8 ply) {
                   #ifdef DEBUG
                   debug[PVS][NODE_TT_BETA_RET]++;
                   #endif
+                  count_stat(td, STAT_TT_CUTS);
                   return beta;
                }
                break;
@@ -501,6 +464,7 @@ i32 pv_search(ThreadData *td, i32 alpha, i32 beta, i8 depth, u8 ply) {
                   #ifdef DEBUG
                   debug[PVS][NODE_TT_ALPHA_RET]++;
                   #endif
+                  count_stat(td, STAT_TT_CUTS);
                   return alpha;
                }
                break;
@@ -511,10 +475,13 @@ i32 pv_search(ThreadData *td, i32 alpha, i32 beta, i8 depth, u8 ply) {
    }
 
    if( depth <= 0 ) {
+      if(static_eval != NO_STATIC_EVAL) eval_cache_store(td, static_eval); // Saves q_search evaluating it
       i32 q_eval = q_search(td, alpha, beta, ply, 0);
-      if     (q_eval < alpha) store_tt_entry(pos->hash, 0, q_eval, ALL_NODE, NO_MOVE);
-      else if(q_eval >= beta) store_tt_entry(pos->hash, 0, q_eval, CUT_NODE, NO_MOVE);
-      else                    store_tt_entry(pos->hash, 0, q_eval,  PV_NODE, NO_MOVE);
+      if(td->stopped) return 0;
+      if(static_eval == NO_STATIC_EVAL) static_eval = eval_cached(td);
+      if     (q_eval < alpha) store_tt_entry(pos->hash, 0, q_eval, ALL_NODE, NO_MOVE, static_eval);
+      else if(q_eval >= beta) store_tt_entry(pos->hash, 0, q_eval, CUT_NODE, NO_MOVE, static_eval);
+      else                    store_tt_entry(pos->hash, 0, q_eval,  PV_NODE, NO_MOVE, static_eval);
       return q_eval;
    }
 
@@ -523,45 +490,40 @@ i32 pv_search(ThreadData *td, i32 alpha, i32 beta, i8 depth, u8 ply) {
    if(abs(beta-1) >= CHECKMATE_VALUE/2) prunable = FALSE;
    if(pos->stage == END_GAME) prunable = FALSE;
 
-   //Store the list of moves and their evaluations at the start
    #ifdef DEBUG
-   //Store the values at the starting time
-   if(ply == 0){
-      debug_size[1] = size;
-      memcpy(debug_moveList[1], moveList, size*sizeof(i32));
-      memcpy(debug_moveVals[1], moveVals, size*sizeof(i32));
-   }
-   #endif
-
-   #ifdef DEBUG
-   if(size > 0) debug[PVS][NODE_LOOP_CHILDREN]++;
+   debug[PVS][NODE_LOOP_CHILDREN]++;
    #endif
 
+   MovePicker mp;
+   init_move_picker(&mp, ttMove, ply);
+   Move move;
+   i32 moveVal;
    Move bestMove = NO_MOVE;
    i32 bestScore = MIN_EVAL;
    u8 exact = FALSE;
-   u32 evalIdx = 0; // Used for select sort
    #ifdef DEBUG
    Position prev_pos = td->pos;
    #endif
-   for (u32 i = 0; i < size; i++)  {
+   u32 i;
+   for (i = 0; (move = next_move(&mp, td, &moveVal)) != NO_MOVE; i++)  {
       #ifdef DEBUG
       assert(prev_pos.hash == pos->hash);
       #endif
-      evalIdx = select_sort(td, i, evalIdx, moveList, moveVals, size, ttMove, ply);
-      make_move(td, moveList[i]);
+      u64 nodes_before = td->stats.node_count;
+      make_move(td, move);
       // Update Prunability PVS
       u8 prunable_move = prunable;
-      if(i <= PV_PRUNE_MOVE_IDX || pos->flags & IN_CHECK || (GET_FLAGS(moveList[i]) > DOUBLE_PAWN_PUSH) || pos->stage == END_GAME ) prunable_move = FALSE;
+      if(i <= PV_PRUNE_MOVE_IDX || pos->flags & IN_CHECK || (GET_FLAGS(move) > DOUBLE_PAWN_PUSH) || pos->stage == END_GAME ) prunable_move = FALSE;
 
       if( prunable_move && depth == 1 && abs(alpha) < (CHECKMATE_VALUE/2) && abs(beta) < (CHECKMATE_VALUE/2)){ // Futility Pruning
-         if(td->undo_stack.undo[td->undo_stack.idx].material_eval + moveVals[i] < alpha - PV_FUTIL_MARGIN){ 
-            unmake_move(td, moveList[i]);
+         if(td->undo_stack.undo[td->undo_stack.idx].material_eval + moveVal < alpha - PV_FUTIL_MARGIN){ 
+            unmake_move(td, move);
+            count_stat(td, STAT_FUTIL_PRUNES);
             #ifdef DEBUG
             debug[PVS][NODE_PRUNED_FUTIL]++;
             if(!compare_positions(&td->pos, &prev_pos)){
                printf("Error in pv search futil prune, unmake move did not properly return the position: ");
-               printMove(moveList[i]);
+               printMove(move);
                printf("\n\nCorrect Position:\n");
                printPosition(prev_pos, TRUE);
                printf("\n\nFound Position:\n");
@@ -579,7 +541,7 @@ i32 pv_search(ThreadData *td, i32 alpha, i32 beta, i8 depth, u8 ply) {
          #ifdef DEBUG
          if(debug_print_search && ply == 0){
             printf("PV(%d, %d) Search on:  ", -beta, -alpha);
-            printMove(moveList[i]);
+            printMove(move);
             printf(" Score: %d\n", score);
          }
          #endif
@@ -590,7 +552,7 @@ i32 pv_search(ThreadData *td, i32 alpha, i32 beta, i8 depth, u8 ply) {
          #ifdef DEBUG
          if(debug_print_search && ply == 0){
             printf("ZW Search (%d) on:  ", -alpha);
-            printMove(moveList[i]);
+            printMove(move);
             printf(" Score: %d\n", score);
          }
          #endif
@@ -599,18 +561,20 @@ i32 pv_search(ThreadData *td, i32 alpha, i32 beta, i8 depth, u8 ply) {
                #ifdef DEBUG
                if(debug_print_search && ply == 0){
                   printf("New PV(%d, %d) Search on:  ", -beta, -alpha);
-                  printMove(moveList[i]);
+                  printMove(move);
                   printf(" Score: %d\n", score);
                }
                #endif
          }
       }
 
-      unmake_move(td, moveList[i]);
+      unmake_move(td, move);
+      if(td->stopped) return 0; // Search was stopped, the score is not valid
+      if(ply == 0 && (i == 0 || score > alpha)) td->best_move_nodes = td->stats.node_count - nodes_before; // For time management
       #ifdef DEBUG
       if(!compare_positions(&td->pos, &prev_pos)){
          printf("Error in pv search, unmake move did not properly return the position: ");
-         printMove(moveList[i]);
+         printMove(move);
          printf("\n\nCorrect Position:\n");
          printPosition(prev_pos, TRUE);
          printf("\n\nFound Position:\n");
@@ -620,17 +584,19 @@ i32 pv_search(ThreadData *td, i32 alpha, i32 beta, i8 depth, u8 ply) {
       #endif
       
       if( score >= beta ) { //Beta cutoff
-         store_tt_entry(pos->hash, depth, score, CUT_NODE, moveList[i]);
-         storeKillerMove(&td->km, ply, moveList[i]);
-         //storeHistoryMove(pos->flags, moveList[i], depth);
+         count_stat(td, STAT_FAIL_HIGHS);
+         if(i == 0) count_stat(td, STAT_FIRST_MOVE_CUTS);
+         store_tt_entry(pos->hash, depth, score, CUT_NODE, move, static_eval);
+         storeKillerMove(&td->km, ply, move);
+         //storeHistoryMove(pos->flags, move, depth);
       
          #ifdef DEBUG
          //printf("Returning beta cutoff: %d >= %d\n", score, beta);
          debug[PVS][NODE_BETA_CUT]++;
          if(ply == 0){
-            debug_size[3] = size;
-            memcpy(debug_moveList[3], moveList, size*sizeof(i32));
-            memcpy(debug_moveVals[3], moveVals, size*sizeof(i32));
+            debug_size[3] = mp.size;
+            memcpy(debug_moveList[3], mp.moves, mp.size*sizeof(Move));
+            memcpy(debug_moveVals[3], mp.vals, mp.size*sizeof(i32));
          }
          #endif
          return beta;
@@ -638,27 +604,34 @@ i32 pv_search(ThreadData *td, i32 alpha, i32 beta, i8 depth, u8 ply) {
       if( score > alpha ) {  //Improved alpha
          alpha = score;
          exact = TRUE;
-         td->pv_array[ply] = moveList[i];
+         td->pv_array[ply] = move;
       }
       if( score > bestScore ){ //Improved best move
-         bestMove = moveList[i];
+         bestMove = move;
          bestScore = score;
       }
    }
+
+   //Handle Draw or Mate
+   if(i == 0){
+      if(pos->flags & IN_CHECK) return -(CHECKMATE_VALUE - ply);
+      else return 0;
+   }
+
    if (exact) {
       // PV Node (exact value)
-      store_tt_entry(pos->hash, depth, alpha, PV_NODE, td->pv_array[ply]);
+      store_tt_entry(pos->hash, depth, alpha, PV_NODE, td->pv_array[ply], static_eval);
    } else {
       // ALL Node (upper bound)
-      store_tt_entry(pos->hash, depth, bestScore, ALL_NODE, bestMove);
+      store_tt_entry(pos->hash, depth, bestScore, ALL_NODE, bestMove, static_eval);
    }
    #ifdef DEBUG
    debug[PVS][NODE_ALPHA_RET]++;
 
    if(ply == 0){
-      debug_size[4] = size;
-      memcpy(debug_moveList[4], moveList, size*sizeof(i32));
-      memcpy(debug_moveVals[4], moveVals, size*sizeof(i32));
+      debug_size[4] = mp.size;
+      memcpy(debug_moveList[4], mp.moves, mp.size*sizeof(Move));
+      memcpy(debug_moveVals[4], mp.vals, mp.size*sizeof(i32));
    }
    #endif
    return alpha;
@@ -666,25 +639,20 @@ i32 pv_search(ThreadData *td, i32 alpha, i32 beta, i8 depth, u8 ply) {
 
 i32 helper_pv_search(ThreadData* td, i32 alpha, i32 beta, i8 depth, u8 ply) {
    Position* pos = &td->pos;
-   if(!run_get_best_move) exit_search();
+   if(search_stopped(td)) return 0;
+   td->stats.node_count++;
+   td->stats.search_nodes++;
+   count_stat(td, STAT_PVS_NODES);
    td->pv_array[ply] = NO_MOVE;
    if(ply != 0 && (pos->halfmove_clock >= 100 || isInsufficient(pos) || isRepetition(td))) return 0;
 
-   Move moveList[MAX_MOVES];
-   i32 moveVals[MAX_MOVES] = {0};
-
-   i32 size = generateLegalMoves(pos, moveList);
-
-   //Handle Draw or Mate
-   if(size == 0){
-      if(pos->flags & IN_CHECK) return -(CHECKMATE_VALUE - ply);
-      else return 0;
-   }
-
    //Test the TT table
-   TTEntryData ttEntry = get_tt_entry(pos->hash);
+   i32 static_eval;
+   TTEntryData ttEntry = get_tt_entry(pos->hash, &static_eval);
    Move ttMove = NO_MOVE;
+   count_stat(td, STAT_TT_PROBES);
    if (ttEntry.data) {
+      count_stat(td, STAT_TT_HITS);
       #ifdef DEBUG
       debug[PVS][NODE_TT_HIT]++;
       #endif
@@ -692,15 +660,18 @@ i32 helper_pv_search(ThreadData* td, i32 alpha, i32 beta, i8 depth, u8 ply) {
       if(ttEntry.fields.depth >= depth){
          switch (ttEntry.fields.node_type) {
             case PV_NODE: // Exact value
+               count_stat(td, STAT_TT_CUTS);
                td->pv_array[ply] = ttEntry.fields.move;
                return ttEntry.fields.eval;
             case CUT_NODE: // Lower bound
                if (ttEntry.fields.eval >= beta){
+                  count_stat(td, STAT_TT_CUTS);
                   return beta;
                }
                break;
             case ALL_NODE: // Upper bound
                if (ttEntry.fields.eval < alpha){
+                  count_stat(td, STAT_TT_CUTS);
                   return alpha;
                }
                break;
@@ -710,24 +681,32 @@ i32 helper_pv_search(ThreadData* td, i32 alpha, i32 beta, i8 depth, u8 ply) {
       }
    }
    if( depth <= 0 ) {
+      if(static_eval != NO_STATIC_EVAL) eval_cache_store(td, static_eval); // Saves q_search evaluating it
       i32 q_eval = q_search(td, alpha, beta, ply, 0);
-      if     (q_eval < alpha) store_tt_entry(pos->hash, 0, q_eval, ALL_NODE, NO_MOVE);
-      else if(q_eval >= beta) store_tt_entry(pos->hash, 0, q_eval, CUT_NODE, NO_MOVE);
-      else                    store_tt_entry(pos->hash, 0, q_eval,  PV_NODE, NO_MOVE);
+      if(td->stopped) return 0;
+      if(static_eval == NO_STATIC_EVAL) static_eval = eval_cached(td);
+      if     (q_eval < alpha) store_tt_entry(pos->hash, 0, q_eval, ALL_NODE, NO_MOVE, static_eval);
+      else if(q_eval >= beta) store_tt_entry(pos->hash, 0, q_eval, CUT_NODE, NO_MOVE, static_eval);
+      else                    store_tt_entry(pos->hash, 0, q_eval,  PV_NODE, NO_MOVE, static_eval);
       return q_eval;
    }
    
+   MovePicker mp;
+   init_move_picker(&mp, ttMove, ply);
+   Move move;
+   i32 moveVal;
    Move bestMove = NO_MOVE;
    i32 bestScore = MIN_EVAL;
    u8 exact = FALSE;
-   u32 evalIdx = 0; // Used for select sort
+   #ifdef DEBUG
    Position prevPos = *pos;
-   for (i32 i = 0; i < size; i++)  {
+   #endif
+   u32 i;
+   for (i = 0; (move = next_move(&mp, td, &moveVal)) != NO_MOVE; i++)  {
       #ifdef DEBUG
       assert(prevPos.hash == pos->hash);
       #endif
-      evalIdx = helper_select_sort(td, i, evalIdx, moveList, moveVals, size, ttMove, ply);
-      make_move(td, moveList[i]);
+      make_move(td, move);
       i32 score;
       if ( i == 0 ) {
          score = -helper_pv_search(td, -beta, -alpha, depth - 1, ply + 1);
@@ -737,26 +716,36 @@ i32 helper_pv_search(ThreadData* td, i32 alpha, i32 beta, i8 depth, u8 ply) {
             score = -helper_pv_search(td, -beta, -alpha, depth - 1, ply + 1);
          }
       }
-      *pos = prevPos;
+      unmake_move(td, move);
+      if(td->stopped) return 0; // Search was stopped, the score is not valid
       if( score >= beta ) {
-         store_tt_entry(pos->hash, depth, score, CUT_NODE, moveList[i]);
-         storeKillerMove(&td->km, ply, moveList[i]);
+         count_stat(td, STAT_FAIL_HIGHS);
+         if(i == 0) count_stat(td, STAT_FIRST_MOVE_CUTS);
+         store_tt_entry(pos->hash, depth, score, CUT_NODE, move, static_eval);
+         storeKillerMove(&td->km, ply, move);
          return beta;
       }
       if( score > alpha ) {
          alpha = score;
          exact = TRUE;
-         td->pv_array[ply] = moveList[i];
+         td->pv_array[ply] = move;
       }
       if( score > bestScore ){
-         bestMove = moveList[i];
+         bestMove = move;
          bestScore = score;
       }
    }
+
+   //Handle Draw or Mate
+   if(i == 0){
+      if(pos->flags & IN_CHECK) return -(CHECKMATE_VALUE - ply);
+      else return 0;
+   }
+
    if (exact) {
-      store_tt_entry(pos->hash, depth, alpha, PV_NODE, td->pv_array[ply]);
+      store_tt_entry(pos->hash, depth, alpha, PV_NODE, td->pv_array[ply], static_eval);
    } else {
-      store_tt_entry(pos->hash, depth, bestScore, ALL_NODE, bestMove);
+      store_tt_entry(pos->hash, depth, bestScore, ALL_NODE, bestMove, static_eval);
    }
    return alpha;
 }
@@ -769,29 +758,25 @@ i32 helper_pv_search(ThreadData* td, i32 alpha, i32 beta, i8 depth, u8 ply) {
 */
 i32 zw_search( ThreadData* td, i32 beta, i8 depth, u8 ply, u8 isNull) {
    Position *pos = &td->pos;
-   if(!run_get_best_move) exit_search();
+   if(search_stopped(td)) return 0;
    // alpha == beta - 1
    // this is either a cut- or all-node
 
    td->stats.node_count++;
+   td->stats.search_nodes++;
+   count_stat(td, STAT_ZWS_NODES);
    #ifdef DEBUG
    debug[ZWS][NODE_COUNT]++;
    #endif
 
    if(pos->halfmove_clock >= 100 || isInsufficient(pos) || isRepetition(td)) return 0;
 
-   Move moveList[MAX_MOVES];
-   i32 moveVals[MAX_MOVES];
-   u32 size = generateLegalMoves(pos, moveList);
-   //Handle Draw or Mate
-   if(size == 0){
-      if(pos->flags & IN_CHECK) return -(CHECKMATE_VALUE - ply);
-      else return 0;
-   }
-
-   TTEntryData ttEntry = get_tt_entry(pos->hash);
+   i32 static_eval;
+   TTEntryData ttEntry = get_tt_entry(pos->hash, &static_eval);
    Move ttMove = NO_MOVE;
+   count_stat(td, STAT_TT_PROBES);
    if (ttEntry.data) {
+      count_stat(td, STAT_TT_HITS);
       #ifdef DEBUG
       debug[ZWS][NODE_TT_HIT]++;
       #endif
@@ -802,6 +787,7 @@ i32 zw_search( ThreadData* td, i32 beta, i8 depth, u8 ply, u8 isNull) {
                #ifdef DEBUG
                debug[ZWS][NODE_TT_PVS_RET]++;
                #endif
+               count_stat(td, STAT_TT_CUTS);
                return ttEntry.fields.eval;
                break;
             case CUT_NODE: // Lower bound
@@ -809,6 +795,7 @@ i32 zw_search( ThreadData* td, i32 beta, i8 depth, u8 ply, u8 isNull) {
                   #ifdef DEBUG
                   debug[ZWS][NODE_TT_BETA_RET]++;
                   #endif
+                  count_stat(td, STAT_TT_CUTS);
                   return beta;
                }
                break;
@@ -817,6 +804,7 @@ i32 zw_search( ThreadData* td, i32 beta, i8 depth, u8 ply, u8 isNull) {
                   #ifdef DEBUG
                   debug[ZWS][NODE_TT_ALPHA_RET]++;
                   #endif
+                  count_stat(td, STAT_TT_CUTS);
                   return beta-1;
                }
                break;
@@ -828,9 +816,12 @@ i32 zw_search( ThreadData* td, i32 beta, i8 depth, u8 ply, u8 isNull) {
    }
 
    if( depth <= 0 ){
+      if(static_eval != NO_STATIC_EVAL) eval_cache_store(td, static_eval); // Saves q_search evaluating it
       i32 q_eval = q_search(td, beta-1, beta, ply, 0);
-      if     (q_eval < beta-1) store_tt_entry(pos->hash, 0, q_eval, ALL_NODE, NO_MOVE);
-      else if(q_eval >= beta)  store_tt_entry(pos->hash, 0, q_eval, CUT_NODE, NO_MOVE);
+      if(td->stopped) return 0;
+      if(static_eval == NO_STATIC_EVAL) static_eval = eval_cached(td);
+      if     (q_eval < beta-1) store_tt_entry(pos->hash, 0, q_eval, ALL_NODE, NO_MOVE, static_eval);
+      else if(q_eval >= beta)  store_tt_entry(pos->hash, 0, q_eval, CUT_NODE, NO_MOVE, static_eval);
       return q_eval;
    }
 
@@ -842,7 +833,10 @@ i32 zw_search( ThreadData* td, i32 beta, i8 depth, u8 ply, u8 isNull) {
    if(prunable && !isNull 
                && depth > NULL_PRUNE_R + 1 
                && pos->material_eval >= (beta - NMR_MARGIN)){
-      if(pruneNullMoves(td, beta, depth, ply) >= beta){
+      i32 null_score = pruneNullMoves(td, beta, depth, ply);
+      if(td->stopped) return 0;
+      if(null_score >= beta){
+         count_stat(td, STAT_NULL_PRUNES);
          #ifdef DEBUG
          debug[ZWS][NODE_PRUNED_NULL]++;
          #endif
@@ -851,31 +845,35 @@ i32 zw_search( ThreadData* td, i32 beta, i8 depth, u8 ply, u8 isNull) {
    }
 
    #ifdef DEBUG
-   if(size > 0) debug[ZWS][NODE_LOOP_CHILDREN]++;
+   debug[ZWS][NODE_LOOP_CHILDREN]++;
    Position prev_pos = td->pos;
    #endif
 
-   u32 evalIdx = 0;
-   for (u32 i = 0; i < size; i++)  {
+   MovePicker mp;
+   init_move_picker(&mp, ttMove, ply);
+   Move move;
+   i32 moveVal;
+   u32 i;
+   for (i = 0; (move = next_move(&mp, td, &moveVal)) != NO_MOVE; i++)  {
       #ifdef DEBUG
       assert(prev_pos.hash == pos->hash);
       #endif
       
-      evalIdx = select_sort(td, i, evalIdx, moveList, moveVals, size, ttMove, ply);
-      make_move(td, moveList[i]);
+      make_move(td, move);
 
       // Set Move prunability prunability ZWS
       u8 prunable_move = prunable;
-      if(i <= PRUNE_MOVE_IDX || pos->flags & IN_CHECK || (GET_FLAGS(moveList[i]) > DOUBLE_PAWN_PUSH) || pos->stage == END_GAME) prunable_move = FALSE;
+      if(i <= PRUNE_MOVE_IDX || pos->flags & IN_CHECK || (GET_FLAGS(move) > DOUBLE_PAWN_PUSH) || pos->stage == END_GAME) prunable_move = FALSE;
 
       if( prunable_move && depth == 1 && abs(beta) < (CHECKMATE_VALUE/2) ){ // Futility Pruning
-         if((td->undo_stack.undo[td->undo_stack.idx].material_eval + moveVals[i]) < ((beta-1) - ZW_FUTIL_MARGIN)){ 
-            unmake_move(td, moveList[i]);
+         if((td->undo_stack.undo[td->undo_stack.idx].material_eval + moveVal) < ((beta-1) - ZW_FUTIL_MARGIN)){ 
+            unmake_move(td, move);
+            count_stat(td, STAT_FUTIL_PRUNES);
             #ifdef DEBUG
             debug[ZWS][NODE_PRUNED_FUTIL]++;
             if(!compare_positions(&td->pos, &prev_pos)){
                printf("Error in zw search futil prune, unmake move did not properly return the position: ");
-               printMove(moveList[i]);
+               printMove(move);
                printf("\n\nCorrect Position:\n");
                printPosition(prev_pos, TRUE);
                printf("\n\nFound Position:\n");
@@ -887,17 +885,19 @@ i32 zw_search( ThreadData* td, i32 beta, i8 depth, u8 ply, u8 isNull) {
          }
       }
       
-      char search_depth = getLMRDepth(depth, i, size, moveList[i], prunable_move);
+      char search_depth = getLMRDepth(depth, i, mp.size + (mp.tt_move != NO_MOVE), move, prunable_move);
+      add_stat(td, STAT_LMR_REDUCTIONS, MAX(((depth - 1) - search_depth), 0));
       #ifdef DEBUG
       debug[ZWS][NODE_LMR_REDUCTIONS] += MAX(((depth - 1) - search_depth), 0);
       //printf("zws further search score %d\n", score);
       #endif
       i32 score = -zw_search(td, 1-beta, search_depth, ply + 1, FALSE);
-      unmake_move(td, moveList[i]);
+      unmake_move(td, move);
+      if(td->stopped) return 0; // Search was stopped, the score is not valid
       #ifdef DEBUG
       if(!compare_positions(&td->pos, &prev_pos)){
          printf("Error in zw search, unmake move did not properly return the position: ");
-         printMove(moveList[i]);
+         printMove(move);
          printf("\n\nCorrect Position:\n");
          printPosition(prev_pos, TRUE);
          printf("\n\nFound Position:\n");
@@ -907,9 +907,11 @@ i32 zw_search( ThreadData* td, i32 beta, i8 depth, u8 ply, u8 isNull) {
       #endif
 
       if( score >= beta ){ // Beta Cutoff
-         store_tt_entry(pos->hash, depth, score, CUT_NODE, moveList[i]);
-         storeKillerMove(&td->km, ply, moveList[i]);
-         //storeHistoryMove(pos->flags, moveList[i], depth);
+         count_stat(td, STAT_FAIL_HIGHS);
+         if(i == 0) count_stat(td, STAT_FIRST_MOVE_CUTS);
+         store_tt_entry(pos->hash, depth, score, CUT_NODE, move, static_eval);
+         storeKillerMove(&td->km, ply, move);
+         //storeHistoryMove(pos->flags, move, depth);
          #ifdef DEBUG
          debug[ZWS][NODE_BETA_CUT]++;
          //printf("zws fail hard beta cut %d\n", beta);
@@ -918,6 +920,12 @@ i32 zw_search( ThreadData* td, i32 beta, i8 depth, u8 ply, u8 isNull) {
       }
    }
 
+   //Handle Draw or Mate
+   if(i == 0){
+      if(pos->flags & IN_CHECK) return -(CHECKMATE_VALUE - ply);
+      else return 0;
+   }
+
    //printf("zws fail %d\n", beta-1);
    #ifdef DEBUG
    debug[ZWS][NODE_ALPHA_RET]++;
@@ -928,8 +936,10 @@ i32 zw_search( ThreadData* td, i32 beta, i8 depth, u8 ply, u8 isNull) {
 //quiescence search
 i32 q_search(ThreadData *td, i32 alpha, i32 beta, u8 ply, u8 q_ply) {
    Position *pos = &td->pos;
-   if(!run_get_best_move) exit_search();
+   if(search_stopped(td)) return 0;
    td->stats.node_count++;
+   td->stats.search_nodes++;
+   count_stat(td, STAT_QS_NODES);
    #ifdef DEBUG
    debug[QS][NODE_COUNT]++;
    //printf("Pos->Eval in q search: %d\n", pos->eval);
@@ -941,7 +951,7 @@ i32 q_search(ThreadData *td, i32 alpha, i32 beta, u8 ply, u8 q_ply) {
    if(pos->halfmove_clock >= 100 || isInsufficient(pos) || isRepetition(td)) return 0;
 
    // Check to see if the player can opt to not move and be better
-   i32 stand_pat = eval_position(pos); 
+   i32 stand_pat = eval_cached(td); // Transpositions and re-searches hit the eval cache
    if(!(pos->flags & IN_CHECK) && stand_pat >= beta){
       return beta;
    }
@@ -953,6 +963,7 @@ i32 q_search(ThreadData *td, i32 alpha, i32 beta, u8 ply, u8 q_ply) {
    i32 early_delta = EarlyDeltaValue;
    if (canPromotePawn(pos)) early_delta += PromotionBuffer;
    if (!(pos->flags & IN_CHECK) && stand_pat + early_delta < alpha && pos->stage != END_GAME) {
+      count_stat(td, STAT_DELTA_PRUNES);
       #ifdef DEBUG
       debug[QS][NODE_PRUNED_FUTIL]++;
       #endif
@@ -995,6 +1006,7 @@ i32 q_search(ThreadData *td, i32 alpha, i32 beta, u8 ply, u8 q_ply) {
       i32 delta = DeltaValue;
       if (GET_FLAGS(moveList[i]) & PROMOTION) delta += PromotionBuffer;
       if (!(pos->flags & IN_CHECK) && stand_pat + delta + moveVals[i] < alpha && pos->stage != END_GAME) {
+         count_stat(td, STAT_DELTA_PRUNES);
          #ifdef DEBUG
          debug[QS][NODE_PRUNED_FUTIL]++;
          #endif
@@ -1004,6 +1016,7 @@ i32 q_search(ThreadData *td, i32 alpha, i32 beta, u8 ply, u8 q_ply) {
       make_move(td, moveList[i]);
       i32 score = -q_search(td, -beta, -alpha, ply + 1, q_ply + 1);
       unmake_move(td, moveList[i]);
+      if(td->stopped) return 0; // Search was stopped, the score is not valid
       #ifdef DEBUG
       if(!compare_positions(&td->pos, &prev_pos)){
          printf("Error, unmake move did not properly return the position: ");
@@ -3,6 +3,8 @@
 #include <stddef.h>
 #include <inttypes.h>
 #include <time.h>
+#include <stdatomic.h>
+#include <stdalign.h>
 
 typedef uint8_t   u8;
 typedef uint16_t u16;
@@ -26,6 +28,20 @@ typedef real64 d64;
 #define TRUE 1
 #define FALSE 0
 
+/*
+ * Middlegame and endgame values packed into one integer, so a tapered term is one add
+ * Scores go well past 16 bits each at this scale, so the halves are 32 bits wide
+ */
+typedef i64 Score;
+#define S(mg, eg) ((Score)(eg) * 0x100000000LL + (Score)(mg))
+
+static inline i32 mg_score(Score s){ return (i32)(u32)(u64)s; }
+static inline i32 eg_score(Score s){ return (i32)(u32)(((u64)s + 0x80000000ULL) >> 32); }
+static inline i32 phase_score(Score s, i32 phase){ return phase ? eg_score(s) : mg_score(s); } // Indexed like PHASE_MG / PHASE_EG
+
+// For functions templated on a constant color, each call site gets its own copy
+#define FORCE_INLINE static inline __attribute__((always_inline))
+
 #ifndef MAX_DEPTH
 #define MAX_DEPTH 256
 #endif
@@ -152,6 +168,12 @@ typedef enum {
     TURN_MASK      = 0x01
 } PositionFlag;
 
+typedef enum {
+    BLACK_ATTACKS_CACHED = 0x01,
+    WHITE_ATTACKS_CACHED = 0x02,
+    PINNED_CACHED        = 0x04
+} CachedField;
+
 typedef enum{
     BLACK_TURN = 0,
     WHITE_TURN = 1,
@@ -160,10 +182,29 @@ typedef enum{
 } Turn;
 
 typedef enum {
-    WHITE_PAWN, WHITE_KNIGHT, WHITE_BISHOP, WHITE_ROOK, WHITE_QUEEN, WHITE_KING,
-    BLACK_PAWN, BLACK_KNIGHT, BLACK_BISHOP, BLACK_ROOK, BLACK_QUEEN, BLACK_KING
+    PAWN, KNIGHT, BISHOP, ROOK, QUEEN, KING
+} PieceType;
+
+// Piece indices are type * 2 + color, so pieces[] lines up with the per type bitboards in Position
+typedef enum {
+    BLACK_PAWN,   WHITE_PAWN,
+    BLACK_KNIGHT, WHITE_KNIGHT,
+    BLACK_BISHOP, WHITE_BISHOP,
+    BLACK_ROOK,   WHITE_ROOK,
+    BLACK_QUEEN,  WHITE_QUEEN,
+    BLACK_KING,   WHITE_KING,
+    PIECE_COUNT,
+    NO_PIECE = PIECE_COUNT
 } PieceIndex;
 
+#define PIECE_INDEX(type, color) ((type) * 2 + (color))
+#define PIECE_TYPE(piece)        ((piece) >> 1)
+#define PIECE_COLOR(piece)       ((piece) & 1)
+
+// The material key holds the count of every piece index in 4 bits
+#define MATERIAL_SHIFT(piece)      ((piece) * 4)
+#define MATERIAL_COUNT(key, piece) (((key) >> MATERIAL_SHIFT(piece)) & 0xF)
+
 static const i32 pieceToIndex[128] = {
     ['P'] = WHITE_PAWN,
     ['N'] = WHITE_KNIGHT,
@@ -179,6 +220,14 @@ static const i32 pieceToIndex[128] = {
     ['k'] = BLACK_KING
 };
 
+static const char indexToPiece[PIECE_COUNT + 1] = {
+    [WHITE_PAWN] = 'P', [WHITE_KNIGHT] = 'N', [WHITE_BISHOP] = 'B',
+    [WHITE_ROOK] = 'R', [WHITE_QUEEN]  = 'Q', [WHITE_KING]   = 'K',
+    [BLACK_PAWN] = 'p', [BLACK_KNIGHT] = 'n', [BLACK_BISHOP] = 'b',
+    [BLACK_ROOK] = 'r', [BLACK_QUEEN]  = 'q', [BLACK_KING]   = 'k',
+    [NO_PIECE]   = 0
+};
+
 typedef struct {
     u64 hash[HASHSTACK_SIZE]; //A stack of hashes of player positions
     i32 cur_idx;
@@ -192,43 +241,55 @@ typedef enum {
 } Stage;
 
 typedef struct {            //Each size of 2 array contains {Black, White}
-    u64 pawn[2];     
-    u64 bishop[2];
-    u64 knight[2];
-    u64 rook[2];
-    u64 queen[2];
-    u64 king[2];
-
-    u64 attack_mask[2]; // {Attacked by Black, Attacked by White}
-
-    u64 color[2];  // {White Pieces, Black Pieces}
+    // Fields used on every move come first so they share the first cache lines
+    union {
+        alignas(64) u64 pieces[PIECE_COUNT]; //Indexed by PieceIndex
+        struct {
+            u64 pawn[2];
+            u64 knight[2];
+            u64 bishop[2];
+            u64 rook[2];
+            u64 queen[2];
+            u64 king[2];
+        };
+    };
+
+    u64 color[2];  // {Black Pieces, White Pieces}
+
+    u64 checkers; //Pieces giving check to the side to move
+    u64 hash;     //Hash of the position
+    u64 pawn_hash; //Hash of the pawns alone, keys the pawn hash table
+    u64 material_key; //Count of each piece, see MATERIAL_COUNT, keys the material table
+
+    u8 board[64]; //PieceIndex on each square, NO_PIECE when empty
 
     u64 en_passant;  //En Passant squares
     u8 flags;  //Castle aval as bit flags, in order : w_long_castle | w_short_castle | b_long_castle | b_short_castle | turn | in_check | in_double_check
     //1 means avaliable / white's turn
+    u8 cached;    //Lazily generated fields which are up to date, as CachedField bit flags
 
-    char charBoard[64];  //Character Board
-
-    u64 pinned; //Absolutely pinned pieces
+    i32 material_eval; //Material of the side to move minus the other side
 
-    u64 hash; //Hash of the position
-
-    i32 material_eval;
+    i32 material;    //Material of white minus black, kept up to date by make and unmake move
+    Score psq;       //Packed material and PST score of white minus black
+    i32 phase;       //Game phase value of the pieces on the board
+    u8 piece_count;  //Pieces on the board, kings included
 
     Stage stage; //The stage of the game
 
     i32 halfmove_clock;
     i32 fullmove_number;
+
+    u64 attack_mask[2]; // {Attacked by Black, Attacked by White}, use get_attack_mask
+    u64 pinned;         //Absolutely pinned pieces of the side to move, use get_pinned
 } Position;
 
 typedef struct {
-    u64 attack_mask[2];
+    u64 checkers;
 
     u64 en_passant;
     u8 flags;  
-    u8 captured;
-
-    u64 pinned;
+    u8 captured; //PieceIndex of the captured piece, NO_PIECE if none
 
     i32 material_eval;
 
@@ -265,9 +326,35 @@ typedef struct{
     struct timespec start_time;
     struct timespec end_time;
     double elap_time;
-    u64 node_count;
+    u64 node_count;   // Nodes in the current iteration
+    u64 search_nodes; // Nodes since the search started, checked against the node limit
 } SearchStats;
 
+typedef enum {
+    STAT_PVS_NODES,
+    STAT_ZWS_NODES,
+    STAT_QS_NODES,
+    STAT_TT_PROBES,
+    STAT_TT_HITS,
+    STAT_TT_CUTS,        // Nodes returned straight from a TT bound
+    STAT_FAIL_HIGHS,     // Nodes that failed high in the move loop
+    STAT_FIRST_MOVE_CUTS,// Fail highs on the first move searched
+    STAT_NULL_PRUNES,
+    STAT_FUTIL_PRUNES,
+    STAT_DELTA_PRUNES,
+    STAT_LMR_REDUCTIONS, // Plies taken off by late move reductions
+    STAT_ITERATIONS,     // Completed iterative deepening iterations
+    SEARCH_COUNTER_COUNT
+} SearchCounter;
+
+/*
+ * Search counters kept in every build, only written by their own thread.
+ * They sit on their own cache line so the writes never share a line with other data
+ */
+typedef struct {
+    alignas(64) _Atomic u64 count[SEARCH_COUNTER_COUNT];
+} SearchCounters;
+
 typedef struct{
     Move* pv_array;
     Move best_move;
@@ -282,19 +369,27 @@ typedef struct{
 } KillerMoves;
 
 typedef struct{
-    u32 max_time;
-    u32 rec_time;
-    u8  can_shorten;
+    u32 time[2];   // Remaining clock in ms, indexed by Turn
+    u32 inc[2];    // Increment in ms, indexed by Turn
+    u32 movestogo;
+    u32 movetime;
+    u8  infinite;  // Search until stopped, never report on its own
     u32 depth;
+    u64 nodes;     // Node budget of each search thread, 0 for no limit
 } SearchParameters;
 
 typedef enum {
     NORMAL_TIME,
     EXTEND_TIME,
-    REDUCE_TIME,
     HALT_TIME
 } TimePreference;
 
+// Forward definitions
+typedef struct EvalData EvalData;
+typedef struct PawnTable PawnTable;
+typedef struct MaterialTable MaterialTable;
+typedef struct EvalTable EvalTable;
+
 typedef struct{
     i32 thread_num;
     u8 is_helper_thread;
@@ -309,7 +404,12 @@ typedef struct{
     i32 avg_eval;
     TimePreference time_pref;
     SearchStats stats;
+    u64 best_move_nodes; // Nodes spent under the current best root move this iteration
+    u8  stopped;   // Set once the search is stopped, every node then returns straight away
+    u32 stop_poll; // Nodes since the stop flag was last checked
+    u64 node_limit; // Nodes the thread may search, 0 for no limit
+    PawnTable *pawn_table;         // Owned by the thread pool, NULL evaluates without caching
+    MaterialTable *material_table; // Owned by the thread pool, NULL evaluates without caching
+    EvalTable *eval_table;         // Owned by the thread pool, NULL evaluates without caching
+    SearchCounters counters;
 } ThreadData;
-
-// Forward definitions
-typedef struct EvalData EvalData;
@@ -1,8 +1,10 @@
 #include "util.h"
 #include "bitboard/bbutils.h"
+#include "bitboard/bitboard.h"
 #include "movement.h"
 #include "types.h"
 #include "params.h"
+#include "transposition.h"
 #include <stdio.h>
 #include <time.h>
 #include <math.h>
@@ -10,6 +12,12 @@
 #include <string.h>
 #include <unistd.h>
 #include <fcntl.h>
+#if defined(_WIN32) || defined(_WIN64)
+#include <malloc.h>
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#endif
 
 #ifdef PYTHON
 static i32 fifo_fd_in, fifo_fd_out;
@@ -81,10 +89,10 @@ void printMove(Move move){
 }
 
 /*
- * Prints the provided move as the best move in the UCI format
+ * Writes the move in UCI long algebraic notation (with promotion piece) to str
+ * str must hold at least 6 characters, returns the length written
  */
-void printBestMove(Move move){
-    char str[6];
+i32 moveToString(Move move, char *str){
     str[0] = (GET_FROM(move) % 8) + 'a';
     str[1] = (GET_FROM(move) / 8) + '1';
     str[2] = (GET_TO(move) % 8) + 'a';
@@ -95,35 +103,82 @@ void printBestMove(Move move){
         case QUEEN_PROMO_CAPTURE:
         case QUEEN_PROMOTION:
             str[4] = 'q';
-            str[5] = '\0';
             break;
         case ROOK_PROMO_CAPTURE:
         case ROOK_PROMOTION:
             str[4] = 'r';
-            str[5] = '\0';
             break;
         case BISHOP_PROMO_CAPTURE:
         case BISHOP_PROMOTION:
             str[4] = 'b';
-            str[5] = '\0';
             break;
         case KNIGHT_PROMO_CAPTURE:
         case KNIGHT_PROMOTION:
             str[4] = 'n';
-            str[5] = '\0';
             break;
         default:
-            break;
+            return 4;
     }
+    str[5] = '\0';
+    return 5;
+}
+
+/*
+ * Allocates size bytes aligned to alignment, released with aligned_free
+ * The windows C runtime has no aligned_alloc
+ */
+void* aligned_malloc(size_t alignment, size_t size){
+    #if defined(_WIN32) || defined(_WIN64)
+    return _aligned_malloc(size, alignment);
+    #else
+    return aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment); // Size must be a multiple of the alignment
+    #endif
+}
+
+/*
+ * Returns the number of online cpus, 1 when it cannot be found
+ */
+i32 cpu_count(void){
+    i32 cpus = 1;
+    #if defined(_WIN32) || defined(_WIN64)
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    cpus = (i32)info.dwNumberOfProcessors;
+    #elif defined(_SC_NPROCESSORS_ONLN)
+    cpus = (i32)sysconf(_SC_NPROCESSORS_ONLN);
+    #endif
+    return MAX(cpus, 1);
+}
 
+void aligned_free(void* ptr){
     #if defined(_WIN32) || defined(_WIN64)
-    printf("bestmove %s\r\n", str);
+    _aligned_free(ptr);
     #else
-    printf("bestmove %s\n", str);
+    free(ptr);
     #endif
+}
+
+/*
+ * Formats the bestmove message into buf, returns the length written
+ */
+i32 formatBestMove(char *buf, i32 size, Move move){
+    char str[6];
+    moveToString(move, str);
+    #if defined(_WIN32) || defined(_WIN64)
+    return snprintf(buf, size, "bestmove %s\r\n", str);
+    #else
+    return snprintf(buf, size, "bestmove %s\n", str);
+    #endif
+}
 
+/*
+ * Prints the provided move as the best move in the UCI format
+ */
+void printBestMove(Move move){
+    char buf[32];
+    formatBestMove(buf, sizeof(buf), move);
+    fputs(buf, stdout);
     fflush(stdout);
-    return;
 }
 
 void printMoveShort(Move move){
@@ -319,7 +374,7 @@ Move move_from_str_alg(char* str, Position *pos){
         i32 from_square = GET_FROM(m);
         i32 to_square = GET_TO(m);
         u16 flags = GET_FLAGS(m);
-        char moving_piece = pos->charBoard[from_square];
+        char moving_piece = indexToPiece[pos->board[from_square]];
         if (toupper(moving_piece) != piece_char) {
             continue;
         }
@@ -382,67 +437,8 @@ Move move_from_str_alg(char* str, Position *pos){
 
 
 
-u64 perft(ThreadData *td, i32 depth, u8 print){
-  Move move_list[MAX_MOVES];
-  i32 n_moves, i;
-  u64 nodes = 0;
-
-  n_moves = generateLegalMoves(&td->pos, move_list);
-
-  if (depth <= 1) 
-    return n_moves;
-
-  for (i = 0; i < n_moves; i++) {
-    #ifdef DEBUG
-    Position prev_pos = td->pos;
-    i32 prev_hash_cur_idx = td->hash_stack.cur_idx;
-    i32 prev_hash_reset_idx = td->hash_stack.reset_idx;
-    #endif
-    make_move(td, move_list[i]);
-
-    #ifdef PYTHON
-    checkMoveCount(pos);
-    #endif
-    u64 count = perft(td, depth - 1, FALSE);
-    if(print){
-        printMoveShort(move_list[i]);
-        printf(": %" PRIu64 "\n", count);
-    }
-    unmake_move(td, move_list[i]);
-
-    #ifdef DEBUG
-    if(!compare_positions(&td->pos, &prev_pos)){
-        printf("Error in perft, unmake move did not properly return the position: ");
-        printMove(move_list[i]);
-        printf("\n\nCorrect Position:\n");
-        printPosition(prev_pos, TRUE);
-        printf("\n\nFound Position:\n");
-        printPosition(td->pos, TRUE);
-        while(1);
-    }
-    if(prev_hash_cur_idx != td->hash_stack.cur_idx){
-        printf("Hash stack cur_idx doesnt match previous hash stack!\n");
-        while(1);
-    }
-    if(prev_hash_reset_idx != td->hash_stack.reset_idx){
-        printf("Hash stack reset_idx doesnt match previous hash stack!\n");
-        while(1);
-    }
-    td->pos = prev_pos;
-    #endif
-    
-
-    
-    nodes += count;
-  }
-  if(print){
-    printf("Nodes searched: %" PRIu64 "\n", nodes);
-  }
-  return nodes;
-}
-
 char getPiece(Position pos, i32 square){
-    return pos.charBoard[square];
+    return indexToPiece[pos.board[square]];
 }
 
 Move moveStrToType(Position* pos, char* str){
@@ -496,80 +492,55 @@ void printPV(Move *pv_array, i32 depth) {
     }
 }
 
-void printPVInfo(SearchData data){
-    printf("info ");
-    printf("depth %d ", data.depth);
+/*
+ * Formats the info line for a finished depth into buf, returns the length written
+ * buf should hold OUTPUT_BUFFER_SIZE characters to fit a full PV
+ */
+i32 formatPVInfo(char *buf, i32 size, SearchData data){
+    i32 len = snprintf(buf, size, "info depth %d ", data.depth);
 
     i32 score = data.eval;
     if(abs(score) < CHECKMATE_VALUE - MAX_MOVES){
-        printf("score cp %d ", score/10);
+        len += snprintf(buf + len, size - len, "score cp %d ", score/10);
     }
     else{
         i32 mate = CHECKMATE_VALUE - abs(score);
         mate = (mate + 1) / 2;
         if(score < 0) mate = -mate;
-        printf("score mate %d ", mate);
+        len += snprintf(buf + len, size - len, "score mate %d ", mate);
     }
 
-    printf("time %d ", (int)(data.stats.elap_time * 1000));
-    printf("nodes %lld ", (long long)data.stats.node_count);
-    printf("nps %lld ", (long long)((double)data.stats.node_count / data.stats.elap_time));
-    printf("pv ");
-    printPV(data.pv_array, data.depth);
-    printf("\n");
+    len += snprintf(buf + len, size - len, "time %d nodes %lld nps %lld hashfull %d pv",
+                    (int)(data.stats.elap_time * 1000),
+                    (long long)data.stats.node_count,
+                    (long long)((double)data.stats.node_count / data.stats.elap_time),
+                    tt_hashfull());
+
+    for (u32 i = 0; i < data.depth && i < MAX_DEPTH; i++) {
+        if(data.pv_array[i] == NO_MOVE) continue;
+        if(len + 8 >= size) break;
+        buf[len++] = ' ';
+        len += moveToString(data.pv_array[i], buf + len);
+    }
+    buf[len++] = '\n';
+    buf[len] = '\0';
+    return len;
+}
+
+void printPVInfo(SearchData data){
+    char buf[OUTPUT_BUFFER_SIZE];
+    formatPVInfo(buf, sizeof(buf), data);
+    fputs(buf, stdout);
     fflush(stdout);
 }
 
 Stage calculateStage(Position *pos){
     Stage stage = MID_GAME;
     if(pos->fullmove_number < OPN_GAME_MOVES) stage = OPN_GAME; 
-    if(count_bits(pos->color[0] | pos->color[1]) <= END_GAME_PIECES) stage = END_GAME;
+    if(pos->piece_count <= END_GAME_PIECES) stage = END_GAME;
     return stage;
 }
 
-u64 millis(){
-    struct timespec _t;
-    clock_gettime(CLOCK_REALTIME, &_t);
-    return _t.tv_sec*1000 + lround(_t.tv_nsec/1e6);
-}
-
-/*
- * Returns the recommended search time
- */
-u32 calculate_rec_search_time(u32 wtime, u32 winc, u32 btime, u32 binc, u32 moves_remain, u8 turn){
-    u32 time = 0;
-    u32 advantage = 0;
-    if(wtime == 0 && winc == 0 && btime == 0 && binc == 0) return 0;
-    if(turn){
-        time = wtime + winc;
-        advantage = wtime - btime;
-    } else{
-        time = btime + binc;
-        advantage = btime - wtime;
-    }
-    if(moves_remain) return (time / moves_remain);
-    if(time <= 10) return 1;
-    if(time <= 100) return 20;
-    if(time <= 1000) return 200;
-    if(advantage >  0) return ((time) / 10);
-    return (time / 20);
-}
-
-/*
- * Returns the maximum search time
- */
-u32 calculate_max_search_time(u32 wtime, u32 winc, u32 btime, u32 binc, u32 moves_remain, u8 turn){
-    u32 time = 0;
-    if(wtime == 0 && winc == 0 && btime == 0 && binc == 0) return 0;
-    if(turn){
-        time = wtime + winc;
-    } else{
-        time = btime + binc;
-    }
-    if(moves_remain) return (time / moves_remain);
-    return (time / 5) + 1;
-}
-
 /**
  * Returns true if the positions are equal
  */
@@ -600,7 +571,7 @@ i8 compare_positions(Position *pos1, Position *pos2) {
             printf("Mismatch at king[%d]: %" PRIu64 " != %" PRIu64 "\n", i, pos1->king[i], pos2->king[i]);
             return_value = FALSE;
         }
-        if (pos1->attack_mask[i] != pos2->attack_mask[i]) {
+        if (get_attack_mask(pos1, i) != get_attack_mask(pos2, i)) {
             printf("Mismatch at attack_mask[%d]: %" PRIu64 " != %" PRIu64 "\n", i, pos1->attack_mask[i], pos2->attack_mask[i]);
             return_value = FALSE;
         }
@@ -617,18 +588,46 @@ i8 compare_positions(Position *pos1, Position *pos2) {
         printf("Mismatch at flags: %d != %d\n", pos1->flags, pos2->flags);
         return_value = FALSE;
     }
-    if (pos1->pinned != pos2->pinned) {
+    if (get_pinned(pos1) != get_pinned(pos2)) {
         printf("Mismatch at pinned: %" PRIu64 " != %" PRIu64 "\n", pos1->pinned, pos2->pinned);
         return_value = FALSE;
     }
+    if (pos1->checkers != pos2->checkers) {
+        printf("Mismatch at checkers: %" PRIu64 " != %" PRIu64 "\n", pos1->checkers, pos2->checkers);
+        return_value = FALSE;
+    }
     if (pos1->hash != pos2->hash) {
         printf("Mismatch at hash: %" PRIu64 "!= %" PRIu64 "\n", pos1->hash, pos2->hash);
         return_value = FALSE;
     }
+    if (pos1->pawn_hash != pos2->pawn_hash) {
+        printf("Mismatch at pawn_hash: %" PRIu64 "!= %" PRIu64 "\n", pos1->pawn_hash, pos2->pawn_hash);
+        return_value = FALSE;
+    }
     if (pos1->material_eval != pos2->material_eval) {
         printf("Mismatch at material_eval: %d != %d\n", pos1->material_eval, pos2->material_eval);
         return_value = FALSE;
     }
+    if (pos1->material != pos2->material) {
+        printf("Mismatch at material: %d != %d\n", pos1->material, pos2->material);
+        return_value = FALSE;
+    }
+    if (pos1->psq != pos2->psq) {
+        printf("Mismatch at psq: S(%d, %d) != S(%d, %d)\n", mg_score(pos1->psq), eg_score(pos1->psq), mg_score(pos2->psq), eg_score(pos2->psq));
+        return_value = FALSE;
+    }
+    if (pos1->phase != pos2->phase) {
+        printf("Mismatch at phase: %d != %d\n", pos1->phase, pos2->phase);
+        return_value = FALSE;
+    }
+    if (pos1->material_key != pos2->material_key) {
+        printf("Mismatch at material_key: %" PRIu64 " != %" PRIu64 "\n", pos1->material_key, pos2->material_key);
+        return_value = FALSE;
+    }
+    if (pos1->piece_count != pos2->piece_count) {
+        printf("Mismatch at piece_count: %d != %d\n", pos1->piece_count, pos2->piece_count);
+        return_value = FALSE;
+    }
     if (pos1->stage != pos2->stage) {
         printf("Mismatch at stage: %d != %d\n", pos1->stage, pos2->stage);
         return_value = FALSE;
@@ -641,8 +640,8 @@ i8 compare_positions(Position *pos1, Position *pos2) {
         printf("Mismatch at fullmove_number: %d != %d\n", pos1->fullmove_number, pos2->fullmove_number);
         return_value = FALSE;
     }
-    if (memcmp(pos1->charBoard, pos2->charBoard, 64 * sizeof(char)) != 0) {
-        printf("Mismatch at charBoard\n");
+    if (memcmp(pos1->board, pos2->board, sizeof(pos1->board)) != 0) {
+        printf("Mismatch at board\n");
         return_value = FALSE;
     }
 
@@ -681,7 +680,7 @@ void play_self(){
     while(generateLegalMoves(&td.pos, move_list) && td.pos.halfmove_clock < 20){
         SearchParameters sp = {0};
         sp.depth = MAX_DEPTH - 1;
-        sp.can_shorten = FALSE;
+        sp.infinite = TRUE;
         start_search(sp);
         sleep(1);
         stopSearch();
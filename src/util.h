@@ -5,11 +5,13 @@
 #define MIN(x, y) (((x) < (y)) ? (x) : (y))
 
 #include "types.h"
+
+#define OUTPUT_BUFFER_SIZE 4096 // Fits an info line with a full PV
+
 void printMove(Move move);
 void printBestMove(Move move);
 void printMoveShort(Move move);
 void printMoveSpaced(Move move);
-u64 perft(ThreadData *td, i32 depth, u8 print);
 i32 checkMoveCount(Position pos);
 i32 python_init();
 i32 python_close();
@@ -20,16 +22,20 @@ Move move_from_str_alg(char* str, Position *pos);
 
 Move moveStrToType(Position* pos, char* str);
 Stage calculateStage(Position* pos);
-u32 calculate_rec_search_time(u32 wtime, u32 winc, u32 btime, u32 binc, u32 moves_remain, u8 turn);
-u32 calculate_max_search_time(u32 wtime, u32 winc, u32 btime, u32 binc, u32 moves_remain, u8 turn);
+
+void* aligned_malloc(size_t alignment, size_t size);
+void aligned_free(void* ptr);
+i32 cpu_count(void);
 
 i8 compare_positions(Position *pos1, Position *pos2);
 Position get_random_position();
 
 void printPV(Move *pv_array, i32 depth);
 void printPVInfo(SearchData data);
+i32 moveToString(Move move, char *str);
+i32 formatBestMove(char *buf, i32 size, Move move);
+i32 formatPVInfo(char *buf, i32 size, SearchData data);
 
-u64 millis();
 
 static inline i32 getlsb(uint64_t bb) {
     return __builtin_ctzll(bb);
@@ -69,24 +75,24 @@ static inline u8 canPromotePawn(Position *pos){
    return (pos->pawn[turn] & row) != 0;
 }
 
+/*
+* Returns whether a material key has Insufficient material / Drawn
+* That is kings and at most one minor piece for each side
+*/
+static inline u8 isInsufficientMaterial(u64 key){
+   const u64 kings  = (1ULL << MATERIAL_SHIFT(WHITE_KING)) | (1ULL << MATERIAL_SHIFT(BLACK_KING));
+   const u64 minors = (0xFULL << MATERIAL_SHIFT(WHITE_KNIGHT)) | (0xFULL << MATERIAL_SHIFT(BLACK_KNIGHT))
+                    | (0xFULL << MATERIAL_SHIFT(WHITE_BISHOP)) | (0xFULL << MATERIAL_SHIFT(BLACK_BISHOP));
+   if((key & ~minors) != kings) return FALSE;
+   return MATERIAL_COUNT(key, WHITE_KNIGHT) + MATERIAL_COUNT(key, WHITE_BISHOP) <= 1
+       && MATERIAL_COUNT(key, BLACK_KNIGHT) + MATERIAL_COUNT(key, BLACK_BISHOP) <= 1;
+}
+
 /*
 * Returns whether the position has Insufficient material / Drawn
 */
 static inline u8 isInsufficient(Position* pos){
-   if(pos->stage != END_GAME) return FALSE;
-   u32 piece_count_w = count_bits(pos->color[0]);
-   u32 piece_count_b = count_bits(pos->color[1]);
-   if(piece_count_w == 1 && piece_count_b == 1) return TRUE;
-   if(piece_count_w <= 2 && piece_count_b == 1){
-      if((pos->knight[0] | pos->bishop[0])) return TRUE; 
-   }
-   if(piece_count_w == 1 && piece_count_b <= 2){
-      if((pos->knight[1] | pos->bishop[1])) return TRUE;
-   }
-   if(piece_count_w <= 2 && piece_count_b <= 2){
-      if((pos->knight[0] | pos->bishop[0]) && (pos->knight[1] | pos->bishop[1])) return TRUE;
-   }
-   return FALSE;
+   return isInsufficientMaterial(pos->material_key);
 }
 
 /*
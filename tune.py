@@ -42,6 +42,32 @@ def write_2d_array(f, key, array_dict):
         f.write('    },\n')
     f.write('};\n\n')
 
+def format_scores(mg, eg, indent):
+    cells = [f'S({m}, {e})' for m, e in zip(mg, eg)]
+    return ''.join(f'{indent}{", ".join(cells[i:i + 8])},\n' for i in range(0, len(cells), 8))
+
+def write_score(f, key, pair):
+    # A [mg, eg] pair becomes one packed Score
+    f.write(f'static const Score {key} = S({pair[0]}, {pair[1]});\n')
+
+def write_score_array(f, key, phase_dict):
+    # {PHASE_MG: [...], PHASE_EG: [...]} becomes one Score per entry
+    mg, eg = phase_dict['PHASE_MG'], phase_dict['PHASE_EG']
+    f.write(f'static const Score {key}[{len(mg)}] = {{\n')
+    f.write(format_scores(mg, eg, '    '))
+    f.write('};\n\n')
+
+def write_score_table(f, key, phase_dict):
+    # {PHASE_MG: {piece: [...]}, PHASE_EG: {piece: [...]}} becomes a Score table per piece
+    mg, eg = phase_dict['PHASE_MG'], phase_dict['PHASE_EG']
+    length = len(next(iter(mg.values())))
+    f.write(f'static const Score {key}[{len(mg)}][{length}] = {{\n')
+    for piece in mg:
+        f.write(f'    [{piece}] = {{\n')
+        f.write(format_scores(mg[piece], eg[piece], '        '))
+        f.write('    },\n')
+    f.write('};\n\n')
+
 def write_params_header(params, filename='params.h'):
     with open(filename, 'w') as f:
         f.write('#pragma once\n\n')
@@ -54,9 +80,18 @@ def write_params_header(params, filename='params.h'):
             if isinstance(value, (int, float)):
                 # Handle scalar values
                 write_scalar(f, key, value)
+            elif isinstance(value, list) and len(value) == 2:
+                # Handle mg / eg pairs
+                write_score(f, key, value)
             elif isinstance(value, list):
                 # Handle 1D arrays
                 write_array(f, key, value)
+            elif isinstance(value, dict) and set(value) == {'PHASE_MG', 'PHASE_EG'}:
+                # Handle tables with a mg and an eg value per entry
+                if all(isinstance(v, list) for v in value.values()):
+                    write_score_array(f, key, value)
+                elif all(isinstance(v, dict) for v in value.values()):
+                    write_score_table(f, key, value)
             elif isinstance(value, dict):
                 # Determine if it's a 2D array (e.g., PSTPawn)
                 if all(isinstance(v, list) for v in value.values()):